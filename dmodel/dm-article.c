@@ -2,6 +2,7 @@
 
 #include "dm-article.h"
 #include "dm-macros.h"
+#include "dm-base-private.h"
 #include "dm-utils-private.h"
 #include "dm-content-private.h"
 
@@ -62,6 +63,10 @@ dm_article_get_property (GObject *object,
   DmArticle *self = DM_ARTICLE (object);
   DmArticlePrivate *priv = dm_article_get_instance_private (self);
 
+  if (prop_id == PROP_AUTHORS || prop_id == PROP_TEMPORAL_COVERAGE ||
+      prop_id == PROP_OUTGOING_LINKS || prop_id == PROP_TABLE_OF_CONTENTS)
+    dm_content_resolve_pending_fields (DM_CONTENT (self));
+
   switch (prop_id)
     {
     case PROP_SOURCE:
@@ -291,51 +296,31 @@ dm_article_init (G_GNUC_UNUSED DmArticle *self)
 {
 }
 
-static void
-dm_article_add_json_to_params (JsonNode *node,
-                               GArray *params)
+static gpointer
+dm_article_get_private (gpointer self)
 {
-  if (!JSON_NODE_HOLDS_OBJECT (node))
-    {
-      g_critical ("Trying to instantiate a DmArticle from a non json object.");
-      return;
-    }
-
-  dm_content_add_json_to_params (node, params);
-
-  JsonObject *object = json_node_get_object (node);
-  GObjectClass *klass = g_type_class_ref (DM_TYPE_ARTICLE);
-
-  dm_utils_append_gparam_from_json_node (json_object_get_member (object, "source"),
-                                         g_object_class_find_property (klass, "source"),
-                                         params);
-  dm_utils_append_gparam_from_json_node (json_object_get_member (object, "sourceName"),
-                                         g_object_class_find_property (klass, "source-name"),
-                                         params);
-  dm_utils_append_gparam_from_json_node (json_object_get_member (object, "published"),
-                                         g_object_class_find_property (klass, "published"),
-                                         params);
-  dm_utils_append_gparam_from_json_node (json_object_get_member (object, "wordCount"),
-                                         g_object_class_find_property (klass, "word-count"),
-                                         params);
-  dm_utils_append_gparam_from_json_node (json_object_get_member (object, "isServerTemplated"),
-                                         g_object_class_find_property (klass, "is-server-templated"),
-                                         params);
-  dm_utils_append_gparam_from_json_node (json_object_get_member (object, "authors"),
-                                         g_object_class_find_property (klass, "authors"),
-                                         params);
-  dm_utils_append_gparam_from_json_node (json_object_get_member (object, "temporalCoverage"),
-                                         g_object_class_find_property (klass, "temporal-coverage"),
-                                         params);
-  dm_utils_append_gparam_from_json_node (json_object_get_member (object, "outgoingLinks"),
-                                         g_object_class_find_property (klass, "outgoing-links"),
-                                         params);
-  dm_utils_append_gparam_from_json_node (json_object_get_member (object, "tableOfContents"),
-                                         g_object_class_find_property (klass, "table-of-contents"),
-                                         params);
-  g_type_class_unref (klass);
+  return dm_article_get_instance_private (self);
 }
 
+static const DmJsonField article_fields[] = {
+  DM_JSON_FIELD ("source", "source", STRING, DmArticlePrivate, source),
+  DM_JSON_FIELD ("sourceName", "source-name", STRING, DmArticlePrivate, source_name),
+  DM_JSON_FIELD ("published", "published", STRING, DmArticlePrivate, published),
+  DM_JSON_FIELD ("wordCount", "word-count", UINT, DmArticlePrivate, word_count),
+  DM_JSON_FIELD ("isServerTemplated", "is-server-templated", BOOLEAN, DmArticlePrivate, is_server_templated),
+  DM_JSON_LAZY_FIELD ("authors", "authors", STRV, DmArticlePrivate, authors),
+  DM_JSON_LAZY_FIELD ("temporalCoverage", "temporal-coverage", STRV, DmArticlePrivate, temporal_coverage),
+  DM_JSON_LAZY_FIELD ("outgoingLinks", "outgoing-links", STRV, DmArticlePrivate, outgoing_links),
+  DM_JSON_LAZY_FIELD ("tableOfContents", "table-of-contents", DICT_ARRAY, DmArticlePrivate, table_of_contents),
+};
+
+const DmJsonFieldTable dm_article_json_fields = {
+  &dm_content_json_fields,
+  dm_article_get_private,
+  article_fields,
+  G_N_ELEMENTS (article_fields),
+};
+
 /**
  * dm_article_get_authors:
  * @self: the model
@@ -349,6 +334,8 @@ dm_article_get_authors (DmArticle *self)
 {
   g_return_val_if_fail (DM_IS_ARTICLE (self), NULL);
 
+  dm_content_resolve_pending_fields (DM_CONTENT (self));
+
   DmArticlePrivate *priv = dm_article_get_instance_private (self);
   return priv->authors;
 }
@@ -367,6 +354,8 @@ dm_article_get_temporal_coverage (DmArticle *self)
 {
   g_return_val_if_fail (DM_IS_ARTICLE (self), NULL);
 
+  dm_content_resolve_pending_fields (DM_CONTENT (self));
+
   DmArticlePrivate *priv = dm_article_get_instance_private (self);
   return priv->temporal_coverage;
 }
@@ -384,6 +373,8 @@ dm_article_get_outgoing_links (DmArticle *self)
 {
   g_return_val_if_fail (DM_IS_ARTICLE (self), NULL);
 
+  dm_content_resolve_pending_fields (DM_CONTENT (self));
+
   DmArticlePrivate *priv = dm_article_get_instance_private (self);
   return priv->outgoing_links;
 }
@@ -401,6 +392,8 @@ dm_article_get_table_of_contents (DmArticle *self)
 {
   g_return_val_if_fail (DM_IS_ARTICLE (self), NULL);
 
+  dm_content_resolve_pending_fields (DM_CONTENT (self));
+
   DmArticlePrivate *priv = dm_article_get_instance_private (self);
   return priv->table_of_contents;
 }
@@ -538,13 +531,6 @@ dm_article_new_from_json_node (JsonNode *node)
 {
   g_autoptr(EosProfileProbe) probe = EOS_PROFILE_PROBE ("/dmodel/object/article");
 
-G_GNUC_BEGIN_IGNORE_DEPRECATIONS
-  GArray *params = g_array_new (FALSE, TRUE, sizeof (GParameter));
-  dm_article_add_json_to_params (node, params);
-  DmArticle *model = g_object_newv (DM_TYPE_ARTICLE, params->len,
-                                    (GParameter *)params->data);
-  dm_utils_free_gparam_array (params);
-G_GNUC_END_IGNORE_DEPRECATIONS
-
-  return DM_CONTENT (model);
+  return dm_utils_new_model_from_json_node (DM_TYPE_ARTICLE,
+                                            &dm_article_json_fields, node);
 }
@@ -2,6 +2,7 @@
 
 #include "dm-audio.h"
 
+#include "dm-base-private.h"
 #include "dm-utils-private.h"
 #include "dm-content-private.h"
 
@@ -126,37 +127,23 @@ dm_audio_init (G_GNUC_UNUSED DmAudio *self)
 {
 }
 
-/**
- * dm_audio_add_json_to_params: (skip)
- * @node: a json node
- * @params: a caller owned array a gparams
- *
- * Private function. Appends GParameters to the array with DmArticle
- * property values parsed from the json node metadata.
- */
-void
-dm_audio_add_json_to_params (JsonNode *node,
-                             GArray *params)
+static gpointer
+dm_audio_get_private (gpointer self)
 {
-  if (!JSON_NODE_HOLDS_OBJECT (node))
-    {
-      g_critical ("Trying to instantiate a DmAudio from a non json object.");
-      return;
-    }
-
-  dm_content_add_json_to_params (node, params);
+  return dm_audio_get_instance_private (self);
+}
 
-  JsonObject *object = json_node_get_object (node);
-  GObjectClass *klass = g_type_class_ref (DM_TYPE_AUDIO);
+static const DmJsonField audio_fields[] = {
+  DM_JSON_FIELD ("duration", "duration", UINT, DmAudioPrivate, duration),
+  DM_JSON_FIELD ("transcript", "transcript", STRING, DmAudioPrivate, transcript),
+};
 
-  dm_utils_append_gparam_from_json_node (json_object_get_member (object, "duration"),
-                                         g_object_class_find_property (klass, "duration"),
-                                         params);
-  dm_utils_append_gparam_from_json_node (json_object_get_member (object, "transcript"),
-                                         g_object_class_find_property (klass, "transcript"),
-                                         params);
-  g_type_class_unref (klass);
-}
+const DmJsonFieldTable dm_audio_json_fields = {
+  &dm_content_json_fields,
+  dm_audio_get_private,
+  audio_fields,
+  G_N_ELEMENTS (audio_fields),
+};
 
 /**
  * dm_audio_new_from_json_node:
@@ -172,13 +159,6 @@ dm_audio_new_from_json_node (JsonNode *node)
 {
   g_autoptr(EosProfileProbe) probe = EOS_PROFILE_PROBE ("/dmodel/object/audio");
 
-G_GNUC_BEGIN_IGNORE_DEPRECATIONS
-  GArray *params = g_array_new (FALSE, TRUE, sizeof (GParameter));
-  dm_audio_add_json_to_params (node, params);
-  DmAudio *model = g_object_newv (DM_TYPE_AUDIO, params->len,
-                                  (GParameter *)params->data);
-  dm_utils_free_gparam_array (params);
-G_GNUC_END_IGNORE_DEPRECATIONS
-
-  return DM_CONTENT (model);
+  return dm_utils_new_model_from_json_node (DM_TYPE_AUDIO,
+                                            &dm_audio_json_fields, node);
 }
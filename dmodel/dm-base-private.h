@@ -0,0 +1,19 @@
+/* Copyright 2020 Endless Mobile, Inc. */
+
+#pragma once
+
+#include "dm-content.h"
+#include "dm-utils-private.h"
+
+G_BEGIN_DECLS
+
+/* dm_content_json_fields and dm_media_json_fields are declared in
+ * dm-content-private.h and dm-media-private.h, since subclasses chain to them.
+ */
+extern const DmJsonFieldTable dm_article_json_fields;
+extern const DmJsonFieldTable dm_audio_json_fields;
+extern const DmJsonFieldTable dm_dictionary_entry_json_fields;
+extern const DmJsonFieldTable dm_set_json_fields;
+extern const DmJsonFieldTable dm_video_json_fields;
+
+G_END_DECLS
@@ -1,4 +1,5 @@
 #include "dm-base.h"
+#include "dm-base-private.h"
 
 #include "dm-audio.h"
 #include "dm-article.h"
@@ -8,8 +9,12 @@
 #include "dm-image.h"
 #include "dm-utils.h"
 #include "dm-video.h"
+#include "dm-content-private.h"
+#include "dm-json-reader-private.h"
+#include "dm-media-private.h"
 
 #include <json-glib/json-glib.h>
+#include <string.h>
 #include <endless/endless.h>
 
 /**
@@ -92,3 +97,106 @@ dm_model_from_json_node (JsonNode *node,
       return NULL;
     }
 }
+
+typedef struct {
+  const char *type_name;
+  GType (*get_type) (void);
+  const DmJsonFieldTable *fields;
+} ModelType;
+
+static const ModelType model_types[] = {
+  { "ekn://_vocab/ContentObject", dm_content_get_type, &dm_content_json_fields },
+  { "ekn://_vocab/ArticleObject", dm_article_get_type, &dm_article_json_fields },
+  { "ekn://_vocab/DictionaryObject", dm_dictionary_entry_get_type, &dm_dictionary_entry_json_fields },
+  { "ekn://_vocab/SetObject", dm_set_get_type, &dm_set_json_fields },
+  { "ekn://_vocab/MediaObject", dm_media_get_type, &dm_media_json_fields },
+  { "ekn://_vocab/ImageObject", dm_image_get_type, &dm_media_json_fields },
+  { "ekn://_vocab/VideoObject", dm_video_get_type, &dm_video_json_fields },
+  { "ekn://_vocab/AudioObject", dm_audio_get_type, &dm_audio_json_fields },
+};
+
+/**
+ * dm_model_from_json_bytes:
+ * @bytes: the JSON text of the object metadata
+ * @properties: (nullable) (array zero-terminated=1): names of the properties
+ *   to fill in, or %NULL for all of them
+ * @error: an error if one occurred
+ *
+ * Creates an object model straight from the text of its metadata, as stored
+ * in a shard, without building a JsonNode tree for it first. The model is the
+ * same as dm_model_from_json_node() would create from the parsed text.
+ * Properties not listed in @properties keep their default values; the ID is
+ * always set.
+ *
+ * Returns: (transfer full): The newly created #DmContent.
+ *
+ * Since: 0.2
+ */
+DmContent *
+dm_model_from_json_bytes (GBytes *bytes,
+                          const char * const *properties,
+                          GError **error)
+{
+  g_autoptr(EosProfileProbe) probe = EOS_PROFILE_PROBE ("/dmodel/base/from_json_bytes");
+
+  gsize length;
+  const char *data = g_bytes_get_data (bytes, &length);
+  if (data == NULL)
+    data = "";
+
+  if (!g_utf8_validate (data, length, NULL))
+    {
+      g_set_error (error, DM_CONTENT_ERROR, DM_CONTENT_ERROR_BAD_FORMAT,
+                   "Object model json is not valid UTF-8");
+      return NULL;
+    }
+
+  /* The type decides which fields there are, so find it before anything */
+  static const char * const identity_keys[] = { "@type", "@id", NULL };
+  char *identity[G_N_ELEMENTS (identity_keys) - 1] = { NULL, };
+
+  gboolean scanned = dm_json_reader_get_strings (data, length, identity_keys,
+                                                 identity, error);
+  g_autofree char *type = identity[0];
+  g_autofree char *id = identity[1];
+
+  if (!scanned)
+    return NULL;
+
+  if (type == NULL)
+    {
+      g_set_error (error, DM_CONTENT_ERROR, DM_CONTENT_ERROR_BAD_FORMAT,
+                   "Object model json has no @type string field");
+      return NULL;
+    }
+
+  const ModelType *model_type = NULL;
+  for (guint i = 0; i < G_N_ELEMENTS (model_types) && !model_type; i++)
+    {
+      if (strcmp (model_types[i].type_name, type) == 0)
+        model_type = &model_types[i];
+    }
+
+  if (model_type == NULL)
+    {
+      g_set_error (error, DM_CONTENT_ERROR, DM_CONTENT_ERROR_BAD_FORMAT,
+                   "Unknown value for @type field %s", type);
+      return NULL;
+    }
+
+  g_autoptr(DmContent) model = id != NULL ?
+    g_object_new (model_type->get_type (), "id", id, NULL) :
+    g_object_new (model_type->get_type (), NULL);
+
+  DmJsonPending *pending = NULL;
+  if (!dm_json_reader_fill_model (bytes, model, model_type->fields,
+                                  properties, &pending, error))
+    return NULL;
+
+  if (pending != NULL)
+    dm_content_set_pending_fields (model, pending);
+
+  dm_content_set_metadata_size (model, length);
+
+  return g_steal_pointer (&model);
+}
@@ -12,4 +12,10 @@ DmContent *
 dm_model_from_json_node (JsonNode *node,
                          GError **error);
 
+DM_AVAILABLE_IN_0_2
+DmContent *
+dm_model_from_json_bytes (GBytes *bytes,
+                          const char * const *properties,
+                          GError **error);
+
 G_END_DECLS
@@ -0,0 +1,62 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+
+/* Copyright 2020 Endless Mobile, Inc. */
+
+#pragma once
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct _DmCache DmCache;
+
+DmCache *
+dm_cache_new (GHashFunc hash_func,
+              GEqualFunc key_equal_func,
+              GBoxedCopyFunc key_copy_func,
+              GDestroyNotify key_free_func,
+              GBoxedCopyFunc value_copy_func,
+              GDestroyNotify value_free_func,
+              guint max_entries,
+              gsize max_cost);
+
+void
+dm_cache_free (DmCache *cache);
+
+gpointer
+dm_cache_lookup (DmCache *cache,
+                 gconstpointer key);
+
+void
+dm_cache_insert (DmCache *cache,
+                 gconstpointer key,
+                 gpointer value,
+                 gsize cost);
+
+void
+dm_cache_remove (DmCache *cache,
+                 gconstpointer key);
+
+void
+dm_cache_clear (DmCache *cache);
+
+void
+dm_cache_set_limits (DmCache *cache,
+                     guint max_entries,
+                     gsize max_cost);
+
+void
+dm_cache_get_limits (DmCache *cache,
+                     guint *max_entries,
+                     gsize *max_cost);
+
+void
+dm_cache_get_stats (DmCache *cache,
+                    guint64 *hits,
+                    guint64 *misses,
+                    guint *n_entries,
+                    gsize *total_cost);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (DmCache, dm_cache_free)
+
+G_END_DECLS
@@ -0,0 +1,291 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+
+/* Copyright 2020 Endless Mobile, Inc. */
+
+#include "dm-cache-private.h"
+
+/* A thread-safe, least recently used cache bounded both by number of entries
+ * and by the sum of a caller supplied cost for each entry, usually its
+ * approximate size in bytes.
+ *
+ * Values are copied on the way in and on the way out with the copy function
+ * given at construction time, so for reference counted values the cache
+ * holds its own reference and hands out new ones.
+ */
+struct _DmCache
+{
+  GMutex lock;
+
+  GBoxedCopyFunc key_copy_func;
+  GDestroyNotify key_free_func;
+  GBoxedCopyFunc value_copy_func;
+  GDestroyNotify value_free_func;
+
+  /* key => GList link in lru, whose data is a CacheEntry */
+  GHashTable *entries;
+  /* most recently used first */
+  GQueue lru;
+
+  guint max_entries;
+  gsize max_cost;
+  gsize total_cost;
+
+  guint64 hits;
+  guint64 misses;
+};
+
+typedef struct
+{
+  gpointer key;
+  gpointer value;
+  gsize cost;
+} CacheEntry;
+
+static void
+cache_entry_free (DmCache *cache,
+                  CacheEntry *entry)
+{
+  if (cache->key_free_func != NULL)
+    cache->key_free_func (entry->key);
+  if (cache->value_free_func != NULL)
+    cache->value_free_func (entry->value);
+
+  g_slice_free (CacheEntry, entry);
+}
+
+/*< private >
+ * dm_cache_new:
+ * @hash_func: hash function for keys
+ * @key_equal_func: equality function for keys
+ * @key_copy_func: (nullable): function to copy keys when inserting them
+ * @key_free_func: (nullable): function to free copied keys
+ * @value_copy_func: (nullable): function to copy values in and out
+ * @value_free_func: (nullable): function to free copied values
+ * @max_entries: maximum number of entries, 0 disables the cache
+ * @max_cost: maximum sum of entry costs, 0 for no limit
+ *
+ * Returns: (transfer full): a new #DmCache
+ */
+DmCache *
+dm_cache_new (GHashFunc hash_func,
+              GEqualFunc key_equal_func,
+              GBoxedCopyFunc key_copy_func,
+              GDestroyNotify key_free_func,
+              GBoxedCopyFunc value_copy_func,
+              GDestroyNotify value_free_func,
+              guint max_entries,
+              gsize max_cost)
+{
+  DmCache *cache = g_slice_new0 (DmCache);
+
+  g_mutex_init (&cache->lock);
+
+  cache->key_copy_func = key_copy_func;
+  cache->key_free_func = key_free_func;
+  cache->value_copy_func = value_copy_func;
+  cache->value_free_func = value_free_func;
+
+  /* The entries own their keys, the table only borrows them */
+  cache->entries = g_hash_table_new (hash_func, key_equal_func);
+  g_queue_init (&cache->lru);
+
+  cache->max_entries = max_entries;
+  cache->max_cost = max_cost;
+
+  return cache;
+}
+
+static void
+dm_cache_clear_unlocked (DmCache *cache)
+{
+  CacheEntry *entry;
+
+  g_hash_table_remove_all (cache->entries);
+
+  while ((entry = g_queue_pop_head (&cache->lru)) != NULL)
+    cache_entry_free (cache, entry);
+
+  cache->total_cost = 0;
+}
+
+void
+dm_cache_free (DmCache *cache)
+{
+  g_return_if_fail (cache != NULL);
+
+  dm_cache_clear_unlocked (cache);
+
+  g_hash_table_unref (cache->entries);
+  g_mutex_clear (&cache->lock);
+
+  g_slice_free (DmCache, cache);
+}
+
+static void
+dm_cache_remove_link_unlocked (DmCache *cache,
+                               GList *link)
+{
+  CacheEntry *entry = link->data;
+
+  g_hash_table_remove (cache->entries, entry->key);
+  g_queue_delete_link (&cache->lru, link);
+
+  cache->total_cost -= entry->cost;
+  cache_entry_free (cache, entry);
+}
+
+static void
+dm_cache_evict_unlocked (DmCache *cache)
+{
+  while (cache->lru.length > 0 &&
+         (cache->lru.length > cache->max_entries ||
+          (cache->max_cost > 0 && cache->total_cost > cache->max_cost)))
+    dm_cache_remove_link_unlocked (cache, cache->lru.tail);
+}
+
+/*< private >
+ * dm_cache_lookup:
+ * @cache: the cache
+ * @key: the key to look up
+ *
+ * Looks up @key and marks it as the most recently used entry.
+ *
+ * Returns: (transfer full) (nullable): a copy of the cached value, or %NULL
+ */
+gpointer
+dm_cache_lookup (DmCache *cache,
+                 gconstpointer key)
+{
+  g_return_val_if_fail (cache != NULL, NULL);
+
+  g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&cache->lock);
+
+  GList *link = g_hash_table_lookup (cache->entries, key);
+  if (link == NULL)
+    {
+      cache->misses++;
+      return NULL;
+    }
+
+  cache->hits++;
+
+  g_queue_unlink (&cache->lru, link);
+  g_queue_push_head_link (&cache->lru, link);
+
+  CacheEntry *entry = link->data;
+  return cache->value_copy_func ? cache->value_copy_func (entry->value) : entry->value;
+}
+
+/*< private >
+ * dm_cache_insert:
+ * @cache: the cache
+ * @key: the key
+ * @value: the value, which is copied
+ * @cost: the cost of keeping @value around
+ *
+ * Adds or replaces the entry for @key, evicting the least recently used
+ * entries until the cache is back within its limits. Entries that would not
+ * fit even in an empty cache are not added.
+ */
+void
+dm_cache_insert (DmCache *cache,
+                 gconstpointer key,
+                 gpointer value,
+                 gsize cost)
+{
+  g_return_if_fail (cache != NULL);
+
+  g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&cache->lock);
+
+  GList *link = g_hash_table_lookup (cache->entries, key);
+  if (link != NULL)
+    dm_cache_remove_link_unlocked (cache, link);
+
+  if (cache->max_entries == 0 || (cache->max_cost > 0 && cost > cache->max_cost))
+    return;
+
+  CacheEntry *entry = g_slice_new0 (CacheEntry);
+  entry->key = cache->key_copy_func ? cache->key_copy_func ((gpointer) key) : (gpointer) key;
+  entry->value = cache->value_copy_func ? cache->value_copy_func (value) : value;
+  entry->cost = cost;
+
+  g_queue_push_head (&cache->lru, entry);
+  g_hash_table_insert (cache->entries, entry->key, cache->lru.head);
+  cache->total_cost += cost;
+
+  dm_cache_evict_unlocked (cache);
+}
+
+void
+dm_cache_remove (DmCache *cache,
+                 gconstpointer key)
+{
+  g_return_if_fail (cache != NULL);
+
+  g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&cache->lock);
+
+  GList *link = g_hash_table_lookup (cache->entries, key);
+  if (link != NULL)
+    dm_cache_remove_link_unlocked (cache, link);
+}
+
+void
+dm_cache_clear (DmCache *cache)
+{
+  g_return_if_fail (cache != NULL);
+
+  g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&cache->lock);
+
+  dm_cache_clear_unlocked (cache);
+}
+
+void
+dm_cache_set_limits (DmCache *cache,
+                     guint max_entries,
+                     gsize max_cost)
+{
+  g_return_if_fail (cache != NULL);
+
+  g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&cache->lock);
+
+  cache->max_entries = max_entries;
+  cache->max_cost = max_cost;
+
+  dm_cache_evict_unlocked (cache);
+}
+
+void
+dm_cache_get_limits (DmCache *cache,
+                     guint *max_entries,
+                     gsize *max_cost)
+{
+  g_return_if_fail (cache != NULL);
+
+  g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&cache->lock);
+
+  if (max_entries != NULL)
+    *max_entries = cache->max_entries;
+  if (max_cost != NULL)
+    *max_cost = cache->max_cost;
+}
+
+void
+dm_cache_get_stats (DmCache *cache,
+                    guint64 *hits,
+                    guint64 *misses,
+                    guint *n_entries,
+                    gsize *total_cost)
+{
+  g_return_if_fail (cache != NULL);
+
+  g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&cache->lock);
+
+  if (hits != NULL)
+    *hits = cache->hits;
+  if (misses != NULL)
+    *misses = cache->misses;
+  if (n_entries != NULL)
+    *n_entries = cache->lru.length;
+  if (total_cost != NULL)
+    *total_cost = cache->total_cost;
+}
@@ -2,10 +2,25 @@
 
 #pragma once
 
+#include "dm-json-reader-private.h"
+#include "dm-utils-private.h"
+
 G_BEGIN_DECLS
 
+extern const DmJsonFieldTable dm_content_json_fields;
+
+gsize
+dm_content_get_approximate_size (DmContent *self);
+
+void
+dm_content_set_metadata_size (DmContent *self,
+                              gsize size);
+
+void
+dm_content_set_pending_fields (DmContent *self,
+                               DmJsonPending *pending);
+
 void
-dm_content_add_json_to_params (JsonNode *node,
-                               GArray *params);
+dm_content_resolve_pending_fields (DmContent *self);
 
 G_END_DECLS
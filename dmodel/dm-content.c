@@ -36,8 +36,21 @@ typedef struct {
   char **resources;
   JsonObject *discovery_feed_content;
   guint sequence_number;
+
+  /* Lazy fields of this model or its subclasses still to be decoded, see
+   * dm_content_resolve_pending_fields() */
+  DmJsonPending *pending_fields;
+
+  /* Length of the JSON text the model was created from, or 0 if unknown */
+  gsize metadata_size;
 } DmContentPrivate;
 
+/* Guards decoding pending fields. Models are shared between threads through
+ * the domain's model cache, so two threads may ask for a lazy field at the
+ * same time; this is rare, so there is no need for a lock per model.
+ */
+G_LOCK_DEFINE_STATIC (pending_fields);
+
 G_DEFINE_TYPE_WITH_PRIVATE (DmContent, dm_content, G_TYPE_OBJECT)
 
 enum {
@@ -293,6 +306,7 @@ dm_content_finalize (GObject *object)
   DmContent *self = DM_CONTENT (object);
   DmContentPrivate *priv = dm_content_get_instance_private (self);
 
+  g_clear_pointer (&priv->pending_fields, dm_json_pending_free);
   g_clear_pointer (&priv->id, g_free);
   g_clear_pointer (&priv->title, g_free);
   g_clear_pointer (&priv->original_title, g_free);
@@ -533,87 +547,171 @@ dm_content_init (G_GNUC_UNUSED DmContent *self)
 {
 }
 
-/**
- * dm_content_add_json_to_params: (skip)
- * @node: a json node
- * @params: a caller owned array a gparams
+static gsize
+string_size (const char *string)
+{
+  return string != NULL ? strlen (string) + 1 : 0;
+}
+
+static gsize
+strv_size (char * const *strv)
+{
+  gsize size = 0;
+  for (char * const *iter = strv; iter != NULL && *iter != NULL; iter++)
+    size += sizeof (char *) + strlen (*iter) + 1;
+  return size;
+}
+
+/*< private >
+ * dm_content_get_approximate_size:
+ * @self: the model
+ *
+ * Estimates how much memory the model takes up, to keep caches of models
+ * within a memory budget. Models created from the text of their metadata are
+ * counted by the size of that text, which covers the fields of subclasses
+ * and lazy fields still to be decoded alike; for other models only the
+ * strings held by #DmContent itself are added up.
  *
- * Private function. Appends GParameters to the array with DmContent
- * property values parsed from the json node metadata.
+ * Returns: the approximate size of the model, in bytes
+ */
+gsize
+dm_content_get_approximate_size (DmContent *self)
+{
+  g_return_val_if_fail (DM_IS_CONTENT (self), 0);
+
+  DmContentPrivate *priv = dm_content_get_instance_private (self);
+
+  GTypeQuery query;
+  g_type_query (G_OBJECT_TYPE (self), &query);
+
+  gsize size = query.instance_size;
+
+  if (priv->metadata_size > 0)
+    return size + priv->metadata_size;
+
+  /* None of these are lazy, so they can be read without locking */
+  size += string_size (priv->id);
+  size += string_size (priv->title);
+  size += string_size (priv->original_title);
+  size += string_size (priv->original_uri);
+  size += string_size (priv->thumbnail_uri);
+  size += string_size (priv->language);
+  size += string_size (priv->copyright_holder);
+  size += string_size (priv->source_uri);
+  size += string_size (priv->content_type);
+  size += string_size (priv->synopsis);
+  size += string_size (priv->last_modified_date);
+  size += string_size (priv->license);
+  size += strv_size (priv->tags);
+  size += strv_size (priv->resources);
+
+  return size;
+}
+
+/*< private >
+ * dm_content_set_metadata_size:
+ * @self: the model
+ * @size: length of the JSON text the model was created from
+ *
+ * Records how large the metadata of a newly created model was, for
+ * dm_content_get_approximate_size(). Must be called before the model is
+ * shared with anything else.
  */
 void
-dm_content_add_json_to_params (JsonNode *node,
-                               GArray *params)
+dm_content_set_metadata_size (DmContent *self,
+                              gsize size)
 {
-  if (!JSON_NODE_HOLDS_OBJECT (node))
+  g_return_if_fail (DM_IS_CONTENT (self));
+
+  DmContentPrivate *priv = dm_content_get_instance_private (self);
+  priv->metadata_size = size;
+}
+
+/*< private >
+ * dm_content_set_pending_fields:
+ * @self: the model
+ * @pending: (transfer full): lazy fields left to decode
+ *
+ * Hands the lazy fields of a newly created model over to it, to be decoded
+ * when first needed. Must be called before the model is shared with anything
+ * else.
+ */
+void
+dm_content_set_pending_fields (DmContent *self,
+                               DmJsonPending *pending)
+{
+  g_return_if_fail (DM_IS_CONTENT (self));
+
+  DmContentPrivate *priv = dm_content_get_instance_private (self);
+
+  g_clear_pointer (&priv->pending_fields, dm_json_pending_free);
+  priv->pending_fields = pending;
+}
+
+/*< private >
+ * dm_content_resolve_pending_fields:
+ * @self: the model
+ *
+ * Decodes the lazy fields of the model, if there are any left. Classes with
+ * lazy fields must call this before reading any of them; it is cheap once the
+ * fields have been decoded, and safe to call from any thread.
+ */
+void
+dm_content_resolve_pending_fields (DmContent *self)
+{
+  DmContentPrivate *priv = dm_content_get_instance_private (self);
+
+  if (G_LIKELY (g_atomic_pointer_get (&priv->pending_fields) == NULL))
+    return;
+
+  G_LOCK (pending_fields);
+
+  DmJsonPending *pending = priv->pending_fields;
+  if (pending != NULL)
     {
-      g_critical ("Trying to instantiate a DmContent from a non json object.");
-      return;
+      dm_json_pending_resolve (pending, self);
+      g_atomic_pointer_set (&priv->pending_fields, NULL);
+      dm_json_pending_free (pending);
     }
 
-  JsonObject *object = json_node_get_object (node);
-  GObjectClass *klass = g_type_class_ref (DM_TYPE_CONTENT);
-
-  dm_utils_append_gparam_from_json_node (json_object_get_member (object, "@id"),
-                                         g_object_class_find_property (klass, "id"),
-                                         params);
-  dm_utils_append_gparam_from_json_node (json_object_get_member (object, "contentType"),
-                                         g_object_class_find_property (klass, "content-type"),
-                                         params);
-  dm_utils_append_gparam_from_json_node (json_object_get_member (object, "title"),
-                                         g_object_class_find_property (klass, "title"),
-                                         params);
-  dm_utils_append_gparam_from_json_node (json_object_get_member (object, "originalTitle"),
-                                         g_object_class_find_property (klass, "original-title"),
-                                         params);
-  dm_utils_append_gparam_from_json_node (json_object_get_member (object, "originalURI"),
-                                         g_object_class_find_property (klass, "original-uri"),
-                                         params);
-  dm_utils_append_gparam_from_json_node (json_object_get_member (object, "language"),
-                                         g_object_class_find_property (klass, "language"),
-                                         params);
-  dm_utils_append_gparam_from_json_node (json_object_get_member (object, "copyrightHolder"),
-                                         g_object_class_find_property (klass, "copyright-holder"),
-                                         params);
-  dm_utils_append_gparam_from_json_node (json_object_get_member (object, "sourceURI"),
-                                         g_object_class_find_property (klass, "source-uri"),
-                                         params);
-  dm_utils_append_gparam_from_json_node (json_object_get_member (object, "synopsis"),
-                                         g_object_class_find_property (klass, "synopsis"),
-                                         params);
-  dm_utils_append_gparam_from_json_node (json_object_get_member (object, "lastModifiedDate"),
-                                         g_object_class_find_property (klass, "last-modified-date"),
-                                         params);
-  dm_utils_append_gparam_from_json_node (json_object_get_member (object, "license"),
-                                         g_object_class_find_property (klass, "license"),
-                                         params);
-  dm_utils_append_gparam_from_json_node (json_object_get_member (object, "thumbnail"),
-                                         g_object_class_find_property (klass, "thumbnail-uri"),
-                                         params);
-  dm_utils_append_gparam_from_json_node (json_object_get_member (object, "featured"),
-                                         g_object_class_find_property (klass, "featured"),
-                                         params);
-  dm_utils_append_gparam_from_json_node (json_object_get_member (object, "tags"),
-                                         g_object_class_find_property (klass, "tags"),
-                                         params);
-  dm_utils_append_gparam_from_json_node (json_object_get_member (object, "resources"),
-                                         g_object_class_find_property (klass, "resources"),
-                                         params);
-  dm_utils_append_gparam_from_json_node (json_object_get_member (object, "discoveryFeedContent"),
-                                         g_object_class_find_property (klass, "discovery-feed-content"),
-                                         params);
-  dm_utils_append_gparam_from_json_node (json_object_get_member (object, "sequenceNumber"),
-                                         g_object_class_find_property (klass, "sequence-number"),
-                                         params);
-  dm_utils_append_gparam_from_json_node (json_object_get_member (object, "canPrint"),
-                                         g_object_class_find_property (klass, "can-print"),
-                                         params);
-  dm_utils_append_gparam_from_json_node (json_object_get_member (object, "canExport"),
-                                         g_object_class_find_property (klass, "can-export"),
-                                         params);
-  g_type_class_unref (klass);
+  G_UNLOCK (pending_fields);
 }
 
+static gpointer
+dm_content_get_private (gpointer self)
+{
+  return dm_content_get_instance_private (self);
+}
+
+/* The "@id" member is handled by dm_utils_new_model_from_json_node() */
+static const DmJsonField content_fields[] = {
+  DM_JSON_FIELD ("contentType", "content-type", STRING, DmContentPrivate, content_type),
+  DM_JSON_FIELD ("title", "title", STRING, DmContentPrivate, title),
+  DM_JSON_FIELD ("originalTitle", "original-title", STRING, DmContentPrivate, original_title),
+  DM_JSON_FIELD ("originalURI", "original-uri", STRING, DmContentPrivate, original_uri),
+  DM_JSON_FIELD ("language", "language", STRING, DmContentPrivate, language),
+  DM_JSON_FIELD ("copyrightHolder", "copyright-holder", STRING, DmContentPrivate, copyright_holder),
+  DM_JSON_FIELD ("sourceURI", "source-uri", STRING, DmContentPrivate, source_uri),
+  DM_JSON_FIELD ("synopsis", "synopsis", STRING, DmContentPrivate, synopsis),
+  DM_JSON_FIELD ("lastModifiedDate", "last-modified-date", STRING, DmContentPrivate, last_modified_date),
+  DM_JSON_FIELD ("license", "license", STRING, DmContentPrivate, license),
+  DM_JSON_FIELD ("thumbnail", "thumbnail-uri", STRING, DmContentPrivate, thumbnail_uri),
+  DM_JSON_FIELD ("featured", "featured", BOOLEAN, DmContentPrivate, featured),
+  DM_JSON_FIELD ("tags", "tags", STRV, DmContentPrivate, tags),
+  DM_JSON_FIELD ("resources", "resources", STRV, DmContentPrivate, resources),
+  DM_JSON_FIELD ("discoveryFeedContent", "discovery-feed-content", JSON_OBJECT, DmContentPrivate, discovery_feed_content),
+  DM_JSON_FIELD ("sequenceNumber", "sequence-number", UINT, DmContentPrivate, sequence_number),
+  DM_JSON_FIELD ("canPrint", "can-print", BOOLEAN, DmContentPrivate, can_print),
+  DM_JSON_FIELD ("canExport", "can-export", BOOLEAN, DmContentPrivate, can_export),
+};
+
+const DmJsonFieldTable dm_content_json_fields = {
+  NULL,
+  dm_content_get_private,
+  content_fields,
+  G_N_ELEMENTS (content_fields),
+};
+
 /**
  * dm_content_get_tags:
  * @self: the model
@@ -700,13 +798,6 @@ dm_content_new_from_json_node (JsonNode *node)
 {
   g_autoptr(EosProfileProbe) probe = EOS_PROFILE_PROBE ("/dmodel/object/content");
 
-G_GNUC_BEGIN_IGNORE_DEPRECATIONS
-  GArray *params = g_array_new (FALSE, TRUE, sizeof (GParameter));
-  dm_content_add_json_to_params (node, params);
-  DmContent *model = g_object_newv (DM_TYPE_CONTENT, params->len,
-                                    (GParameter *)params->data);
-  dm_utils_free_gparam_array (params);
-G_GNUC_END_IGNORE_DEPRECATIONS
-
-  return model;
+  return dm_utils_new_model_from_json_node (DM_TYPE_CONTENT,
+                                            &dm_content_json_fields, node);
 }
@@ -57,4 +57,15 @@ dm_database_manager_fix_query (DmDatabaseManager *self,
                                char **spell_fixed_terms,
                                GError **error_out);
 
+XapianMSet *
+dm_database_manager_fix_and_query (DmDatabaseManager *self,
+                                   DmQuery *query,
+                                   const char *lang,
+                                   GError **error_out);
+
+void
+dm_database_manager_get_spelling_cache_stats (DmDatabaseManager *self,
+                                              guint64 *hits,
+                                              guint64 *misses);
+
 G_END_DECLS
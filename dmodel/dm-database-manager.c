@@ -15,6 +15,7 @@
  */
 
 #include "dm-database-manager-private.h"
+#include "dm-cache-private.h"
 #include "dm-query-private.h"
 #include "dm-shard.h"
 
@@ -23,16 +24,47 @@
 #define PREFIX_METADATA_KEY "XbPrefixes"
 #define STOPWORDS_METADATA_KEY "XbStopwords"
 
+#define SPELLING_CACHE_SIZE 512
+
 G_DEFINE_QUARK (dm-database-manager-error-quark, dm_database_manager_error)
 
+/* Xapian objects are not safe to use from more than one thread at a time,
+ * so every worker running a query checks out its own database, query parser
+ * and stemmers from a bounded pool of identical handles.
+ */
 typedef struct {
+  XapianDatabase *database;
+  XapianQueryParser *query_parser;
+
   /* string lang_name => object XapianStem */
   GHashTable *stemmers;
 
+  /* tag filter clauses, see dm_query_clause_cache_new() */
+  DmCache *clause_cache;
+} DatabaseHandle;
+
+/* The result of fixing a set of search terms; either string may be NULL */
+typedef struct {
+  gint ref_count;
+
+  char *stop_fixed_terms;
+  char *spell_fixed_terms;
+} FixedTerms;
+
+typedef struct {
   GSList *shards;
 
-  XapianQueryParser *query_parser;
-  XapianDatabase *database;
+  GMutex handles_lock;
+  GCond handles_cond;
+  /* DatabaseHandle, most recently released first */
+  GQueue idle_handles;
+  guint n_handles;
+  guint max_handles;
+
+  /* search terms => FixedTerms. The databases never change once opened, so
+   * neither do the stop word filtering and spelling correction of a given
+   * set of search terms. */
+  DmCache *spelling_cache;
 } DmDatabaseManagerPrivate;
 
 struct _DmDatabaseManager {
@@ -49,14 +81,70 @@ static GParamSpec *dm_database_manager_properties[N_PROPS];
 
 G_DEFINE_TYPE_WITH_PRIVATE (DmDatabaseManager, dm_database_manager, G_TYPE_OBJECT)
 
+static FixedTerms *
+fixed_terms_new (char *stop_fixed_terms,
+                 char *spell_fixed_terms)
+{
+  FixedTerms *fixed = g_slice_new0 (FixedTerms);
+
+  fixed->ref_count = 1;
+  fixed->stop_fixed_terms = stop_fixed_terms;
+  fixed->spell_fixed_terms = spell_fixed_terms;
+
+  return fixed;
+}
+
+static FixedTerms *
+fixed_terms_ref (FixedTerms *fixed)
+{
+  g_atomic_int_inc (&fixed->ref_count);
+  return fixed;
+}
+
+static void
+fixed_terms_unref (FixedTerms *fixed)
+{
+  if (!g_atomic_int_dec_and_test (&fixed->ref_count))
+    return;
+
+  g_free (fixed->stop_fixed_terms);
+  g_free (fixed->spell_fixed_terms);
+  g_slice_free (FixedTerms, fixed);
+}
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (FixedTerms, fixed_terms_unref)
+
+static gsize
+fixed_terms_get_size (FixedTerms *fixed)
+{
+  gsize size = sizeof (FixedTerms);
+
+  if (fixed->stop_fixed_terms != NULL)
+    size += strlen (fixed->stop_fixed_terms) + 1;
+  if (fixed->spell_fixed_terms != NULL)
+    size += strlen (fixed->spell_fixed_terms) + 1;
+
+  return size;
+}
+
+static void
+database_handle_free (DatabaseHandle *handle)
+{
+  g_clear_object (&handle->database);
+  g_clear_object (&handle->query_parser);
+  g_clear_pointer (&handle->stemmers, g_hash_table_unref);
+  g_clear_pointer (&handle->clause_cache, dm_cache_free);
+
+  g_slice_free (DatabaseHandle, handle);
+}
+
 /* Registers the prefixes and booleanPrefixes contained in the JSON object
  * to the query parser.
  */
 static void
-dm_database_manager_add_queryparser_prefixes (DmDatabaseManager *self,
-                                              JsonObject *object)
+database_handle_add_queryparser_prefixes (DatabaseHandle *handle,
+                                          JsonObject *object)
 {
-  DmDatabaseManagerPrivate *priv = dm_database_manager_get_instance_private (self);
   JsonNode *element_node;
   JsonObject *element_object;
   JsonArray *array;
@@ -70,7 +158,7 @@ dm_database_manager_add_queryparser_prefixes (DmDatabaseManager *self,
       element_node = l->data;
       element_object = json_node_get_object (element_node);
 
-      xapian_query_parser_add_prefix (priv->query_parser,
+      xapian_query_parser_add_prefix (handle->query_parser,
                                       json_object_get_string_member (element_object, "field"),
                                       json_object_get_string_member (element_object, "prefix"));
     }
@@ -85,7 +173,7 @@ dm_database_manager_add_queryparser_prefixes (DmDatabaseManager *self,
       element_node = l->data;
       element_object = json_node_get_object (element_node);
 
-      xapian_query_parser_add_boolean_prefix (priv->query_parser,
+      xapian_query_parser_add_boolean_prefix (handle->query_parser,
                                               json_object_get_string_member (element_object, "field"),
                                               json_object_get_string_member (element_object, "prefix"),
                                               FALSE);
@@ -95,7 +183,7 @@ dm_database_manager_add_queryparser_prefixes (DmDatabaseManager *self,
 }
 
 static void
-dm_database_manager_add_queryparser_standard_prefixes (DmDatabaseManager *self)
+database_handle_add_queryparser_standard_prefixes (DatabaseHandle *handle)
 {
   static const struct {
     const gchar *field;
@@ -108,17 +196,15 @@ dm_database_manager_add_queryparser_standard_prefixes (DmDatabaseManager *self)
     { "id", "Q" },
   };
 
-  DmDatabaseManagerPrivate *priv = dm_database_manager_get_instance_private (self);
-
   guint idx;
 
   for (idx = 0; idx < G_N_ELEMENTS (standard_prefixes); idx++)
-    xapian_query_parser_add_prefix (priv->query_parser,
+    xapian_query_parser_add_prefix (handle->query_parser,
                                     standard_prefixes[idx].field,
                                     standard_prefixes[idx].prefix);
 
   for (idx = 0; idx < G_N_ELEMENTS (standard_boolean_prefixes); idx++)
-    xapian_query_parser_add_boolean_prefix (priv->query_parser,
+    xapian_query_parser_add_boolean_prefix (handle->query_parser,
                                             standard_boolean_prefixes[idx].field,
                                             standard_boolean_prefixes[idx].prefix,
                                             FALSE);
@@ -170,10 +256,14 @@ dm_database_manager_finalize (GObject *object)
   DmDatabaseManager *self = DM_DATABASE_MANAGER (object);
   DmDatabaseManagerPrivate *priv = dm_database_manager_get_instance_private (self);
 
-  g_clear_object (&priv->database);
-  g_clear_object (&priv->query_parser);
+  g_assert (g_queue_get_length (&priv->idle_handles) == priv->n_handles);
 
-  g_clear_pointer (&priv->stemmers, g_hash_table_unref);
+  g_queue_foreach (&priv->idle_handles, (GFunc) database_handle_free, NULL);
+  g_queue_clear (&priv->idle_handles);
+  g_mutex_clear (&priv->handles_lock);
+  g_cond_clear (&priv->handles_cond);
+
+  g_clear_pointer (&priv->spelling_cache, dm_cache_free);
 
   G_OBJECT_CLASS (dm_database_manager_parent_class)->finalize (object);
 }
@@ -201,21 +291,32 @@ dm_database_manager_init (DmDatabaseManager *self)
 {
   DmDatabaseManagerPrivate *priv = dm_database_manager_get_instance_private (self);
 
-  priv->stemmers = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_object_unref);
-  g_hash_table_insert (priv->stemmers, g_strdup ("none"), xapian_stem_new ());
+  g_mutex_init (&priv->handles_lock);
+  g_cond_init (&priv->handles_cond);
+  g_queue_init (&priv->idle_handles);
+
+  /* There is no point in having more handles than threads that can be
+   * querying at the same time.
+   */
+  priv->max_handles = MAX (g_get_num_processors (), 1);
+
+  priv->spelling_cache = dm_cache_new (g_str_hash, g_str_equal,
+                                       (GBoxedCopyFunc) g_strdup, g_free,
+                                       (GBoxedCopyFunc) fixed_terms_ref,
+                                       (GDestroyNotify) fixed_terms_unref,
+                                       SPELLING_CACHE_SIZE, 0);
 }
 
 static gboolean
-dm_database_manager_register_prefixes (DmDatabaseManager *self,
-                                       GError **error_out)
+database_handle_register_prefixes (DatabaseHandle *handle,
+                                   GError **error_out)
 {
-  DmDatabaseManagerPrivate *priv = dm_database_manager_get_instance_private (self);
   GError *error = NULL;
   JsonNode *root;
 
   /* Attempt to read the database's custom prefix association metadata */
   g_autofree char *metadata_json =
-    xapian_database_get_metadata (priv->database, PREFIX_METADATA_KEY, &error);
+    xapian_database_get_metadata (handle->database, PREFIX_METADATA_KEY, &error);
 
   if (strlen (metadata_json) == 0)
     g_set_error (&error, DM_DATABASE_MANAGER_ERROR,
@@ -225,7 +326,7 @@ dm_database_manager_register_prefixes (DmDatabaseManager *self,
 
   if (error != NULL)
     {
-      dm_database_manager_add_queryparser_standard_prefixes (self);
+      database_handle_add_queryparser_standard_prefixes (handle);
       g_propagate_error (error_out, error);
       return FALSE;
     }
@@ -234,29 +335,28 @@ dm_database_manager_register_prefixes (DmDatabaseManager *self,
   json_parser_load_from_data (parser, metadata_json, -1, &error);
   if (error != NULL)
     {
-      dm_database_manager_add_queryparser_standard_prefixes (self);
+      database_handle_add_queryparser_standard_prefixes (handle);
       g_propagate_error (error_out, error);
       return FALSE;
     }
 
   root = json_parser_get_root (parser);
   if (root != NULL)
-    dm_database_manager_add_queryparser_prefixes (self, json_node_get_object (root));
+    database_handle_add_queryparser_prefixes (handle, json_node_get_object (root));
   else
-    dm_database_manager_add_queryparser_standard_prefixes (self);
+    database_handle_add_queryparser_standard_prefixes (handle);
 
   return TRUE;
 }
 
 static gboolean
-dm_database_manager_register_stopwords (DmDatabaseManager *self,
-                                        GError **error_out)
+database_handle_register_stopwords (DatabaseHandle *handle,
+                                    GError **error_out)
 {
-  DmDatabaseManagerPrivate *priv = dm_database_manager_get_instance_private (self);
   GError *error = NULL;
 
   g_autofree char *stopwords_json =
-    xapian_database_get_metadata (priv->database, STOPWORDS_METADATA_KEY, &error);
+    xapian_database_get_metadata (handle->database, STOPWORDS_METADATA_KEY, &error);
 
   if (strlen (stopwords_json) == 0)
     g_set_error (&error, DM_DATABASE_MANAGER_ERROR,
@@ -313,7 +413,7 @@ dm_database_manager_register_stopwords (DmDatabaseManager *self,
 
   g_list_free (elements);
 
-  xapian_query_parser_set_stopper (priv->query_parser, XAPIAN_STOPPER (stopper));
+  xapian_query_parser_set_stopper (handle->query_parser, XAPIAN_STOPPER (stopper));
 
   return TRUE;
 }
@@ -362,15 +462,13 @@ create_database_from_shards (GSList *shards,
   return db;
 }
 
-static gboolean
-dm_database_manager_create_db_internal (DmDatabaseManager *self,
-                                        GError **error_out)
+static DatabaseHandle *
+database_handle_new (GSList *shards,
+                     GError **error_out)
 {
-  DmDatabaseManagerPrivate *priv = dm_database_manager_get_instance_private (self);
-
   GError *error = NULL;
 
-  priv->database = create_database_from_shards (priv->shards, &error);
+  g_autoptr(XapianDatabase) database = create_database_from_shards (shards, &error);
   if (error != NULL)
     {
       g_set_error (error_out, DM_DATABASE_MANAGER_ERROR,
@@ -378,40 +476,129 @@ dm_database_manager_create_db_internal (DmDatabaseManager *self,
                    "Cannot create XapianDatabase: %s",
                    error->message);
       g_error_free (error);
-      return FALSE;
+      return NULL;
     }
 
+  DatabaseHandle *handle = g_slice_new0 (DatabaseHandle);
+  handle->database = g_steal_pointer (&database);
+
+  handle->stemmers = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_object_unref);
+  g_hash_table_insert (handle->stemmers, g_strdup ("none"), xapian_stem_new ());
+
+  handle->clause_cache = dm_query_clause_cache_new ();
+
   /* Create a XapianQueryParser for this particular database, stemming
    * by its registered language
    */
-  priv->query_parser = xapian_query_parser_new ();
-  xapian_query_parser_set_database (priv->query_parser, priv->database);
+  handle->query_parser = xapian_query_parser_new ();
+  xapian_query_parser_set_database (handle->query_parser, handle->database);
 
-  if (!dm_database_manager_register_prefixes (self, &error))
+  /* The default operator used to be switched to AND by the first spelling
+   * fix on the single shared parser; set it up front so that every handle
+   * in the pool parses queries the same way.
+   */
+  xapian_query_parser_set_default_op (handle->query_parser, XAPIAN_QUERY_OP_AND);
+
+  if (!database_handle_register_prefixes (handle, &error))
     {
       g_info ("Could not register database prefixes: %s", error->message);
       g_clear_error (&error);
     }
 
-  if (!dm_database_manager_register_stopwords (self, &error))
+  if (!database_handle_register_stopwords (handle, &error))
     {
       g_info ("Could not add database stop words: %s.", error->message);
       g_clear_error (&error);
     }
 
-  return TRUE;
+  return handle;
 }
 
-static gboolean
-ensure_db (DmDatabaseManager *self,
-           GError **error_out)
+/* Checks out a database handle for exclusive use by the calling thread,
+ * creating a new one if the pool is not full yet, or waiting for another
+ * thread to release one otherwise.
+ */
+static DatabaseHandle *
+dm_database_manager_acquire_handle (DmDatabaseManager *self,
+                                    GError **error_out)
 {
   DmDatabaseManagerPrivate *priv = dm_database_manager_get_instance_private (self);
+  DatabaseHandle *handle;
 
-  if (priv->database != NULL)
-    return TRUE;
+  g_mutex_lock (&priv->handles_lock);
+
+  while ((handle = g_queue_pop_head (&priv->idle_handles)) == NULL &&
+         priv->n_handles >= priv->max_handles)
+    g_cond_wait (&priv->handles_cond, &priv->handles_lock);
+
+  if (handle != NULL)
+    {
+      g_mutex_unlock (&priv->handles_lock);
+      return handle;
+    }
+
+  /* Reserve a slot and create the handle without holding the lock, opening
+   * the databases can take a while.
+   */
+  priv->n_handles++;
+  g_mutex_unlock (&priv->handles_lock);
 
-  return dm_database_manager_create_db_internal (self, error_out);
+  g_autoptr(EosProfileProbe) probe = EOS_PROFILE_PROBE ("/dmodel/database/handle");
+
+  handle = database_handle_new (priv->shards, error_out);
+  if (handle == NULL)
+    {
+      g_mutex_lock (&priv->handles_lock);
+      priv->n_handles--;
+      g_cond_signal (&priv->handles_cond);
+      g_mutex_unlock (&priv->handles_lock);
+    }
+
+  return handle;
+}
+
+static void
+dm_database_manager_release_handle (DmDatabaseManager *self,
+                                    DatabaseHandle *handle)
+{
+  DmDatabaseManagerPrivate *priv = dm_database_manager_get_instance_private (self);
+
+  g_mutex_lock (&priv->handles_lock);
+  g_queue_push_head (&priv->idle_handles, handle);
+  g_cond_signal (&priv->handles_cond);
+  g_mutex_unlock (&priv->handles_lock);
+}
+
+typedef struct {
+  DmDatabaseManager *manager;
+  DatabaseHandle *handle;
+} HandleLease;
+
+static void
+handle_lease_free (gpointer data)
+{
+  HandleLease *lease = data;
+
+  dm_database_manager_release_handle (lease->manager, lease->handle);
+  g_object_unref (lease->manager);
+
+  g_slice_free (HandleLease, lease);
+}
+
+/* Documents in a XapianMSet are read lazily from the database it came from,
+ * so the handle stays checked out for as long as the results are alive.
+ */
+static void
+dm_database_manager_lease_handle (DmDatabaseManager *self,
+                                  DatabaseHandle *handle,
+                                  XapianMSet *results)
+{
+  HandleLease *lease = g_slice_new0 (HandleLease);
+  lease->manager = g_object_ref (self);
+  lease->handle = handle;
+
+  g_object_set_data_full (G_OBJECT (results), "dm-database-handle",
+                          lease, handle_lease_free);
 }
 
 static XapianMSet *
@@ -446,20 +633,19 @@ database_is_empty (XapianDatabase *db)
 }
 
 static gboolean
-dm_database_manager_fix_query_internal (DmDatabaseManager *self,
-                                        const char *search_terms,
-                                        char **stop_fixed_terms_out,
-                                        char **spell_fixed_terms_out,
-                                        GError **error_out)
+database_handle_fix_query (DatabaseHandle *handle,
+                           const char *search_terms,
+                           char **stop_fixed_terms_out,
+                           char **spell_fixed_terms_out,
+                           GError **error_out)
 {
   g_return_val_if_fail (stop_fixed_terms_out != NULL, FALSE);
   g_return_val_if_fail (spell_fixed_terms_out != NULL, FALSE);
 
   g_autoptr(EosProfileProbe) probe = EOS_PROFILE_PROBE ("/dmodel/fix_query");
 
-  DmDatabaseManagerPrivate *priv = dm_database_manager_get_instance_private (self);
   GError *error = NULL;
-  XapianStopper *stopper = xapian_query_parser_get_stopper (priv->query_parser);
+  XapianStopper *stopper = xapian_query_parser_get_stopper (handle->query_parser);
 
   if (stopper != NULL && stop_fixed_terms_out != NULL)
     {
@@ -480,10 +666,8 @@ dm_database_manager_fix_query_internal (DmDatabaseManager *self,
       *stop_fixed_terms_out = g_strjoinv (" ", filtered_words);
     }
 
-  xapian_query_parser_set_default_op (priv->query_parser, XAPIAN_QUERY_OP_AND);
-
   /* Parse the user's query so we can request a spelling correction. */
-  xapian_query_parser_parse_query_full (priv->query_parser,
+  xapian_query_parser_parse_query_full (handle->query_parser,
                                         search_terms != NULL ? search_terms : "",
                                         XAPIAN_QUERY_PARSER_FEATURE_DEFAULT |
                                         XAPIAN_QUERY_PARSER_FEATURE_WILDCARD |
@@ -503,7 +687,7 @@ dm_database_manager_fix_query_internal (DmDatabaseManager *self,
        * newline appended. This has now been fixed, but in order to avoid
        * having to rebuild everything, we remove all excess whitespace from
        * each corrected term. */
-      g_autofree char *corrected = xapian_query_parser_get_corrected_query_string (priv->query_parser);
+      g_autofree char *corrected = xapian_query_parser_get_corrected_query_string (handle->query_parser);
       g_auto(GStrv) temp_array = g_strsplit (corrected, " ", -1);
 
       for (char **iter = temp_array; *iter != NULL; iter++)
@@ -523,6 +707,63 @@ dm_database_manager_fix_query_internal (DmDatabaseManager *self,
   return TRUE;
 }
 
+/* Like database_handle_fix_query(), but answers from the spelling cache if
+ * the same search terms were fixed before. @handle may be NULL, in which case
+ * one is only checked out from @self on a cache miss.
+ */
+static gboolean
+dm_database_manager_fix_terms (DmDatabaseManager *self,
+                               DatabaseHandle *handle,
+                               const char *search_terms,
+                               char **stop_fixed_terms_out,
+                               char **spell_fixed_terms_out,
+                               GError **error_out)
+{
+  DmDatabaseManagerPrivate *priv = dm_database_manager_get_instance_private (self);
+  const char *cache_key = search_terms != NULL ? search_terms : "";
+
+  g_autoptr(FixedTerms) fixed = dm_cache_lookup (priv->spelling_cache, cache_key);
+
+  if (fixed == NULL)
+    {
+      g_autofree char *stop_fixed_terms = NULL;
+      g_autofree char *spell_fixed_terms = NULL;
+      gboolean retval;
+
+      if (handle != NULL)
+        {
+          retval = database_handle_fix_query (handle, search_terms,
+                                              &stop_fixed_terms,
+                                              &spell_fixed_terms, error_out);
+        }
+      else
+        {
+          DatabaseHandle *own_handle = dm_database_manager_acquire_handle (self, error_out);
+          if (own_handle == NULL)
+            return FALSE;
+
+          retval = database_handle_fix_query (own_handle, search_terms,
+                                              &stop_fixed_terms,
+                                              &spell_fixed_terms, error_out);
+
+          dm_database_manager_release_handle (self, own_handle);
+        }
+
+      if (!retval)
+        return FALSE;
+
+      fixed = fixed_terms_new (g_steal_pointer (&stop_fixed_terms),
+                               g_steal_pointer (&spell_fixed_terms));
+      dm_cache_insert (priv->spelling_cache, cache_key, fixed,
+                       fixed_terms_get_size (fixed));
+    }
+
+  *stop_fixed_terms_out = g_strdup (fixed->stop_fixed_terms);
+  *spell_fixed_terms_out = g_strdup (fixed->spell_fixed_terms);
+
+  return TRUE;
+}
+
 gboolean
 dm_database_manager_fix_query (DmDatabaseManager *self,
                                const char *search_terms,
@@ -532,27 +773,23 @@ dm_database_manager_fix_query (DmDatabaseManager *self,
 {
   g_return_val_if_fail (DM_IS_DATABASE_MANAGER (self), FALSE);
 
-  if (!ensure_db (self, error_out))
-    return FALSE;
-
-  return dm_database_manager_fix_query_internal (self, search_terms,
-                                                 stop_fixed_terms,
-                                                 spell_fixed_terms, error_out);
+  return dm_database_manager_fix_terms (self, NULL, search_terms,
+                                        stop_fixed_terms, spell_fixed_terms,
+                                        error_out);
 }
 
 /* If a database exists, queries it with the given #DmQuery. */
 static XapianMSet *
-dm_database_manager_query_internal (DmDatabaseManager *self,
-                                    DmQuery *query,
-                                    const char *lang,
-                                    GError **error_out)
+database_handle_query (DatabaseHandle *handle,
+                       DmQuery *query,
+                       const char *lang,
+                       GError **error_out)
 {
   g_autoptr(EosProfileProbe) probe = EOS_PROFILE_PROBE ("/dmodel/query");
 
-  DmDatabaseManagerPrivate *priv = dm_database_manager_get_instance_private (self);
   GError *error = NULL;
 
-  if (database_is_empty (priv->database))
+  if (database_is_empty (handle->database))
     {
       g_set_error (error_out, DM_DATABASE_MANAGER_ERROR,
                    DM_DATABASE_MANAGER_ERROR_NOT_FOUND,
@@ -560,7 +797,7 @@ dm_database_manager_query_internal (DmDatabaseManager *self,
       return NULL;
     }
 
-  XapianStem *stem = g_hash_table_lookup (priv->stemmers, lang);
+  XapianStem *stem = g_hash_table_lookup (handle->stemmers, lang);
   if (stem == NULL)
     {
       stem = xapian_stem_new_for_language (lang, &error);
@@ -570,20 +807,20 @@ dm_database_manager_query_internal (DmDatabaseManager *self,
                      lang, error->message);
           g_clear_error (&error);
 
-          stem = g_hash_table_lookup (priv->stemmers, "none");
+          stem = g_hash_table_lookup (handle->stemmers, "none");
         }
       else
         {
-          g_hash_table_insert (priv->stemmers, g_strdup (lang), stem);
+          g_hash_table_insert (handle->stemmers, g_strdup (lang), stem);
         }
     }
 
   g_assert (stem != NULL);
 
-  xapian_query_parser_set_stemmer (priv->query_parser, stem);
-  xapian_query_parser_set_stemming_strategy (priv->query_parser, XAPIAN_STEM_STRATEGY_STEM_SOME);
+  xapian_query_parser_set_stemmer (handle->query_parser, stem);
+  xapian_query_parser_set_stemming_strategy (handle->query_parser, XAPIAN_STEM_STRATEGY_STEM_SOME);
 
-  g_autoptr(XapianEnquire) enquire = xapian_enquire_new (priv->database, &error);
+  g_autoptr(XapianEnquire) enquire = xapian_enquire_new (handle->database, &error);
   if (error != NULL)
     {
       g_propagate_error (error_out, error);
@@ -595,9 +832,10 @@ dm_database_manager_query_internal (DmDatabaseManager *self,
   g_autofree char *dump = dm_query_to_string (query);
   g_debug (G_STRLOC " %s", dump);
 
-  g_autoptr(XapianQuery) parsed_query = dm_query_get_query (query,
-                                                            priv->query_parser,
-                                                            &error);
+  g_autoptr(XapianQuery) parsed_query = dm_query_get_query_full (query,
+                                                                 handle->query_parser,
+                                                                 handle->clause_cache,
+                                                                 &error);
   if (error != NULL)
     {
       g_propagate_error (error_out, error);
@@ -610,6 +848,14 @@ dm_database_manager_query_internal (DmDatabaseManager *self,
   guint offset = dm_query_get_offset (query);
   guint limit = dm_query_get_limit (query);
 
+  /* Xapian only estimates the number of matches past the ones it returns,
+   * so counting asks for all of them. Their documents are never read. */
+  if (dm_query_get_output (query) == DM_QUERY_OUTPUT_COUNT)
+    {
+      offset = 0;
+      limit = xapian_database_get_doc_count (handle->database);
+    }
+
   return fetch_results (enquire, parsed_query, offset, limit, error_out);
 }
 
@@ -621,10 +867,64 @@ dm_database_manager_query (DmDatabaseManager *self,
 {
   g_return_val_if_fail (DM_IS_DATABASE_MANAGER (self), NULL);
 
-  if (!ensure_db (self, error_out))
+  DatabaseHandle *handle = dm_database_manager_acquire_handle (self, error_out);
+  if (handle == NULL)
+    return NULL;
+
+  XapianMSet *results = database_handle_query (handle, query, lang, error_out);
+  if (results == NULL)
+    {
+      dm_database_manager_release_handle (self, handle);
+      return NULL;
+    }
+
+  dm_database_manager_lease_handle (self, handle, results);
+
+  return results;
+}
+
+/* Fixes the search terms of @query and runs the fixed query on the same
+ * database handle, so that both steps only need to check out a handle once.
+ * The spelling correction is still a separate parse from the one building the
+ * final query, since it runs on the raw search terms with different parser
+ * flags. */
+XapianMSet *
+dm_database_manager_fix_and_query (DmDatabaseManager *self,
+                                   DmQuery *query,
+                                   const char *lang,
+                                   GError **error_out)
+{
+  g_return_val_if_fail (DM_IS_DATABASE_MANAGER (self), NULL);
+
+  DatabaseHandle *handle = dm_database_manager_acquire_handle (self, error_out);
+  if (handle == NULL)
     return NULL;
 
-  return dm_database_manager_query_internal (self, query, lang, error_out);
+  g_autofree char *stop_fixed_terms = NULL;
+  g_autofree char *spell_fixed_terms = NULL;
+
+  if (!dm_database_manager_fix_terms (self, handle,
+                                      dm_query_get_search_terms (query),
+                                      &stop_fixed_terms, &spell_fixed_terms,
+                                      error_out))
+    {
+      dm_database_manager_release_handle (self, handle);
+      return NULL;
+    }
+
+  g_autoptr(DmQuery) fixed_query = dm_query_new_fixed (query, stop_fixed_terms,
+                                                       spell_fixed_terms);
+
+  XapianMSet *results = database_handle_query (handle, fixed_query, lang, error_out);
+  if (results == NULL)
+    {
+      dm_database_manager_release_handle (self, handle);
+      return NULL;
+    }
+
+  dm_database_manager_lease_handle (self, handle, results);
+
+  return results;
 }
 
 DmDatabaseManager *
@@ -634,3 +934,17 @@ dm_database_manager_new (GSList *shards)
                        "shards", shards,
                        NULL);
 }
+
+/* Gets the number of times fixing a set of search terms was, or was not,
+ * answered from the spelling cache. */
+void
+dm_database_manager_get_spelling_cache_stats (DmDatabaseManager *self,
+                                              guint64 *hits,
+                                              guint64 *misses)
+{
+  g_return_if_fail (DM_IS_DATABASE_MANAGER (self));
+
+  DmDatabaseManagerPrivate *priv = dm_database_manager_get_instance_private (self);
+
+  dm_cache_get_stats (priv->spelling_cache, hits, misses, NULL, NULL);
+}
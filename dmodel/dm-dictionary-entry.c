@@ -2,6 +2,7 @@
 
 #include "dm-dictionary-entry.h"
 
+#include "dm-base-private.h"
 #include "dm-utils-private.h"
 #include "dm-content-private.h"
 
@@ -149,33 +150,25 @@ dm_dictionary_entry_init (G_GNUC_UNUSED DmDictionaryEntry *self)
 {
 }
 
-static void
-dm_dictionary_entry_add_json_to_params (JsonNode *node,
-                                        GArray *params)
+static gpointer
+dm_dictionary_entry_get_private (gpointer self)
 {
-  if (!JSON_NODE_HOLDS_OBJECT (node))
-    {
-      g_critical ("Trying to instantiate a DmDictionaryEntry from a non json object.");
-      return;
-    }
-
-  dm_content_add_json_to_params (node, params);
-
-  JsonObject *object = json_node_get_object (node);
-  GObjectClass *klass = g_type_class_ref (DM_TYPE_DICTIONARY_ENTRY);
-
-  dm_utils_append_gparam_from_json_node (json_object_get_member (object, "word"),
-                                         g_object_class_find_property (klass, "word"),
-                                         params);
-  dm_utils_append_gparam_from_json_node (json_object_get_member (object, "definition"),
-                                         g_object_class_find_property (klass, "definition"),
-                                         params);
-  dm_utils_append_gparam_from_json_node (json_object_get_member (object, "partOfSpeech"),
-                                         g_object_class_find_property (klass, "part-of-speech"),
-                                         params);
-  g_type_class_unref (klass);
+  return dm_dictionary_entry_get_instance_private (self);
 }
 
+static const DmJsonField dictionary_entry_fields[] = {
+  DM_JSON_FIELD ("word", "word", STRING, DmDictionaryEntryPrivate, word),
+  DM_JSON_FIELD ("definition", "definition", STRING, DmDictionaryEntryPrivate, definition),
+  DM_JSON_FIELD ("partOfSpeech", "part-of-speech", STRING, DmDictionaryEntryPrivate, part_of_speech),
+};
+
+const DmJsonFieldTable dm_dictionary_entry_json_fields = {
+  &dm_content_json_fields,
+  dm_dictionary_entry_get_private,
+  dictionary_entry_fields,
+  G_N_ELEMENTS (dictionary_entry_fields),
+};
+
 /**
  * dm_dictionary_entry_new_from_json_node:
  * @node: a json node with the model metadata
@@ -190,15 +183,7 @@ dm_dictionary_entry_new_from_json_node (JsonNode *node)
 {
   g_autoptr(EosProfileProbe) probe = EOS_PROFILE_PROBE ("/dmodel/object/dictionary");
 
-G_GNUC_BEGIN_IGNORE_DEPRECATIONS
-  GArray *params = g_array_new (FALSE, TRUE, sizeof (GParameter));
-  dm_dictionary_entry_add_json_to_params (node, params);
-  DmDictionaryEntry *model = g_object_newv (DM_TYPE_DICTIONARY_ENTRY,
-                                            params->len,
-                                            (GParameter *)params->data);
-  dm_utils_free_gparam_array (params);
-G_GNUC_END_IGNORE_DEPRECATIONS
-
-  return DM_CONTENT (model);
+  return dm_utils_new_model_from_json_node (DM_TYPE_DICTIONARY_ENTRY,
+                                            &dm_dictionary_entry_json_fields, node);
 }
 
@@ -0,0 +1,24 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+
+/* Copyright 2020 Endless Mobile, Inc. */
+
+#pragma once
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+gboolean
+dm_domain_descriptor_load (const char *app_id,
+                           const char *data_dir,
+                           GSList **shards,
+                           GList **subscriptions);
+
+void
+dm_domain_descriptor_save (const char *app_id,
+                           const char *data_dir,
+                           GPtrArray *watched_paths,
+                           GSList *shards,
+                           GList *subscriptions);
+
+G_END_DECLS
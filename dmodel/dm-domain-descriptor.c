@@ -0,0 +1,255 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+
+/* Copyright 2020 Endless Mobile, Inc. */
+
+/* For the nanosecond timestamps in struct stat */
+#define _POSIX_C_SOURCE 200809L
+
+#include "dm-domain-descriptor-private.h"
+
+#include "dm-shard.h"
+#include "dm-shard-eos-shard-private.h"
+#include "dm-shard-open-zim-private.h"
+
+#include <errno.h>
+#include <glib/gstdio.h>
+#include <string.h>
+
+/* An on-disk cache of what a domain found out about its content while
+ * initializing: the subscriptions, and the type, path and database offset of
+ * each shard. Loading it takes one mmap and a stat of each file or directory
+ * that the original answer depended on, instead of walking the flatpak
+ * installations, parsing every manifest and looking up the database offset
+ * inside each ZIM file.
+ *
+ * The descriptor is a serialized GVariant of DESCRIPTOR_TYPE, with:
+ *  - the format version, bumped whenever the layout or its meaning changes
+ *  - the data directory the content was found in
+ *  - a stamp (path, inode, size, modification and status change times in
+ *    nanoseconds) of every watched path, with zeroes for paths that did not
+ *    exist
+ *  - the subscription IDs, in the same order as the domain keeps them
+ *  - the shards as (type, path, database offset), -1 meaning unknown
+ *
+ * A descriptor whose version, data directory or stamps don't match is
+ * ignored, and the domain is initialized the slow way and writes a new one.
+ */
+
+#define DESCRIPTOR_VERSION 2
+#define DESCRIPTOR_TYPE G_VARIANT_TYPE ("(usa(sxxxx)asa(ssx))")
+
+#define SHARD_TYPE_EOS_SHARD "eosshard"
+#define SHARD_TYPE_OPEN_ZIM "openzim"
+
+static char *
+get_descriptor_filename (const char *app_id)
+{
+  g_autofree char *basename = g_strconcat (app_id, ".gvariant", NULL);
+  return g_build_filename (g_get_user_cache_dir (), "dmodel", "domains",
+                           basename, NULL);
+}
+
+static void
+get_stamp (const char *path,
+           gint64 *inode,
+           gint64 *size,
+           gint64 *modified,
+           gint64 *changed)
+{
+  GStatBuf buf;
+
+  if (g_stat (path, &buf) != 0)
+    {
+      *inode = *size = *modified = *changed = 0;
+      return;
+    }
+
+  *inode = buf.st_ino;
+  *size = buf.st_size;
+  /* Whole seconds would miss a change made within the same second as the
+   * descriptor was written */
+  *modified = buf.st_mtim.tv_sec * G_GINT64_CONSTANT (1000000000) +
+    buf.st_mtim.tv_nsec;
+  *changed = buf.st_ctim.tv_sec * G_GINT64_CONSTANT (1000000000) +
+    buf.st_ctim.tv_nsec;
+}
+
+static gboolean
+stamps_are_current (GVariant *stamps)
+{
+  GVariantIter iter;
+  const char *path;
+  gint64 inode, size, modified, changed;
+
+  g_variant_iter_init (&iter, stamps);
+  while (g_variant_iter_next (&iter, "(&sxxxx)", &path, &inode, &size, &modified, &changed))
+    {
+      gint64 current_inode, current_size, current_modified, current_changed;
+      get_stamp (path, &current_inode, &current_size, &current_modified, &current_changed);
+
+      if (inode != current_inode || size != current_size ||
+          modified != current_modified || changed != current_changed)
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+/*< private >
+ * dm_domain_descriptor_load:
+ * @app_id: knowledge app ID
+ * @data_dir: the data directory the app's content is in now
+ * @shards: (out) (transfer full) (element-type DmShard): return location for
+ *   the shards
+ * @subscriptions: (out) (transfer full) (element-type utf8): return location
+ *   for the subscription IDs
+ *
+ * Loads the cached descriptor for @app_id, if there is one and nothing it
+ * depends on has changed since it was written. The shards are created, but
+ * not initialized.
+ *
+ * Returns: %TRUE if the descriptor was loaded, %FALSE otherwise
+ */
+gboolean
+dm_domain_descriptor_load (const char *app_id,
+                           const char *data_dir,
+                           GSList **shards,
+                           GList **subscriptions)
+{
+  g_autofree char *filename = get_descriptor_filename (app_id);
+  g_autoptr(GMappedFile) file = g_mapped_file_new (filename, FALSE, NULL);
+  if (file == NULL)
+    return FALSE;
+
+  g_autoptr(GBytes) bytes = g_mapped_file_get_bytes (file);
+  g_autoptr(GVariant) descriptor =
+    g_variant_ref_sink (g_variant_new_from_bytes (DESCRIPTOR_TYPE, bytes, FALSE));
+
+  guint32 version;
+  const char *cached_data_dir;
+  g_autoptr(GVariant) stamps = NULL;
+  g_autoptr(GVariant) subscription_ids = NULL;
+  g_autoptr(GVariant) shard_entries = NULL;
+  g_variant_get (descriptor, "(u&s@a(sxxxx)@as@a(ssx))", &version,
+                 &cached_data_dir, &stamps, &subscription_ids, &shard_entries);
+
+  if (version != DESCRIPTOR_VERSION ||
+      g_strcmp0 (cached_data_dir, data_dir) != 0 ||
+      g_variant_n_children (shard_entries) == 0 ||
+      !stamps_are_current (stamps))
+    return FALSE;
+
+  GSList *shards_list = NULL;
+  GVariantIter iter;
+  const char *type, *path;
+  gint64 db_offset;
+
+  g_variant_iter_init (&iter, shard_entries);
+  while (g_variant_iter_next (&iter, "(&s&sx)", &type, &path, &db_offset))
+    {
+      DmShard *shard;
+
+      if (g_strcmp0 (type, SHARD_TYPE_EOS_SHARD) == 0)
+        shard = DM_SHARD (dm_shard_eos_shard_new (path));
+      else if (g_strcmp0 (type, SHARD_TYPE_OPEN_ZIM) == 0)
+        shard = DM_SHARD (dm_shard_open_zim_new (path));
+      else
+        {
+          g_slist_free_full (shards_list, g_object_unref);
+          return FALSE;
+        }
+
+      if (db_offset >= 0)
+        dm_shard_override_db_offset (shard, db_offset);
+
+      shards_list = g_slist_prepend (shards_list, shard);
+    }
+
+  GList *subscriptions_list = NULL;
+  const char *subscription_id;
+
+  g_variant_iter_init (&iter, subscription_ids);
+  while (g_variant_iter_next (&iter, "&s", &subscription_id))
+    subscriptions_list = g_list_prepend (subscriptions_list, g_strdup (subscription_id));
+
+  *shards = g_slist_reverse (shards_list);
+  *subscriptions = g_list_reverse (subscriptions_list);
+  return TRUE;
+}
+
+static gint64
+get_known_db_offset (DmShard *shard)
+{
+  gint64 db_offset;
+  g_object_get (shard, "db-offset-override", &db_offset, NULL);
+
+  /* ZIM files are the only ones that know how to look the offset up; that
+   * lookup is what we want to avoid next time around */
+  if (db_offset < 0 && DM_IS_SHARD_OPEN_ZIM (shard))
+    db_offset = dm_shard_get_db_offset (shard);
+
+  return db_offset;
+}
+
+/*< private >
+ * dm_domain_descriptor_save:
+ * @app_id: knowledge app ID
+ * @data_dir: the data directory the app's content was found in
+ * @watched_paths: (element-type filename): the paths that were looked at to
+ *   find the shards and subscriptions, whether they existed or not
+ * @shards: (element-type DmShard): the initialized shards
+ * @subscriptions: (element-type utf8): the subscription IDs
+ *
+ * Writes the descriptor for @app_id, replacing any previous one. The shard
+ * files are watched as well as @watched_paths. Failing to write the cache is
+ * not an error, the next domain for @app_id will just not be able to use it.
+ */
+void
+dm_domain_descriptor_save (const char *app_id,
+                           const char *data_dir,
+                           GPtrArray *watched_paths,
+                           GSList *shards,
+                           GList *subscriptions)
+{
+  g_auto(GVariantBuilder) stamps = G_VARIANT_BUILDER_INIT (G_VARIANT_TYPE ("a(sxxxx)"));
+  g_auto(GVariantBuilder) subscription_ids = G_VARIANT_BUILDER_INIT (G_VARIANT_TYPE ("as"));
+  g_auto(GVariantBuilder) shard_entries = G_VARIANT_BUILDER_INIT (G_VARIANT_TYPE ("a(ssx)"));
+  gint64 inode, size, modified, changed;
+
+  for (guint i = 0; i < watched_paths->len; i++)
+    {
+      const char *path = g_ptr_array_index (watched_paths, i);
+      get_stamp (path, &inode, &size, &modified, &changed);
+      g_variant_builder_add (&stamps, "(sxxxx)", path, inode, size, modified, changed);
+    }
+
+  for (GSList *l = shards; l != NULL; l = l->next)
+    {
+      DmShard *shard = l->data;
+      const char *path = dm_shard_get_path (shard);
+      const char *type = DM_IS_SHARD_OPEN_ZIM (shard) ? SHARD_TYPE_OPEN_ZIM : SHARD_TYPE_EOS_SHARD;
+
+      get_stamp (path, &inode, &size, &modified, &changed);
+      g_variant_builder_add (&stamps, "(sxxxx)", path, inode, size, modified, changed);
+      g_variant_builder_add (&shard_entries, "(ssx)", type, path,
+                             get_known_db_offset (shard));
+    }
+
+  for (GList *l = subscriptions; l != NULL; l = l->next)
+    g_variant_builder_add (&subscription_ids, "s", l->data);
+
+  g_autoptr(GVariant) descriptor =
+    g_variant_ref_sink (g_variant_new ("(usa(sxxxx)asa(ssx))", DESCRIPTOR_VERSION,
+                                       data_dir, &stamps, &subscription_ids,
+                                       &shard_entries));
+
+  g_autofree char *filename = get_descriptor_filename (app_id);
+  g_autofree char *dirname = g_path_get_dirname (filename);
+  g_autoptr(GError) error = NULL;
+
+  if (g_mkdir_with_parents (dirname, 0755) != 0 ||
+      !g_file_set_contents (filename, g_variant_get_data (descriptor),
+                            g_variant_get_size (descriptor), &error))
+    g_debug ("Could not write domain descriptor for %s: %s", app_id,
+             error ? error->message : g_strerror (errno));
+}
@@ -13,4 +13,42 @@ dm_domain_get_for_app_id (const char *app_id,
                           GCancellable *cancellable,
                           GError **error);
 
+DmQuery *
+dm_domain_fix_query_sync (DmDomain *self,
+                          DmQuery *query,
+                          GError **error);
+
+GPtrArray *
+dm_domain_run_query (DmDomain *self,
+                     DmQuery *query,
+                     int *upper_bound_out,
+                     GError **error);
+
+void
+dm_domain_fix_and_query (DmDomain *self,
+                         DmQuery *query,
+                         GCancellable *cancellable,
+                         GAsyncReadyCallback callback,
+                         gpointer user_data);
+
+void
+dm_domain_query_batch (DmDomain *self,
+                       GPtrArray *queries,
+                       GCancellable *cancellable,
+                       GAsyncReadyCallback callback,
+                       gpointer user_data);
+
+GPtrArray *
+dm_domain_query_batch_finish (DmDomain *self,
+                              GAsyncResult *result,
+                              GError **error);
+
+gboolean
+dm_domain_get_objects_sync (DmDomain *self,
+                            GPtrArray *uris,
+                            const char * const *fields,
+                            GSList **models_out,
+                            GCancellable *cancellable,
+                            GError **error);
+
 G_END_DECLS
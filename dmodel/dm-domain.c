@@ -1,17 +1,28 @@
 /* Copyright 2016 Endless Mobile, Inc. */
 
 #include "dm-domain-private.h"
+#include "dm-domain-descriptor-private.h"
 
 #include "dm-shard.h"
 #include "dm-shard-eos-shard-private.h"
 #include "dm-shard-open-zim-private.h"
+#include "dm-shard-index-private.h"
+#include "dm-cache-private.h"
+#include "dm-content-private.h"
 #include "dm-database-manager-private.h"
+#include "dm-query-private.h"
 #include "dm-base.h"
 #include "dm-utils.h"
 #include "dm-utils-private.h"
 
+#include <endless/endless.h>
 #include <string.h>
 
+#define DEFAULT_MODEL_CACHE_SIZE 512
+#define DEFAULT_MODEL_CACHE_MAX_BYTES (16 * 1024 * 1024)
+#define DEFAULT_QUERY_CACHE_SIZE 256
+#define DEFAULT_ZIM_CACHE_MAX_BYTES (8 * 1024 * 1024)
+
 #define dm_domain_return_malformed_manifest(error,element) \
   G_STMT_START{                                            \
     g_set_error (error, DM_DOMAIN_ERROR,                   \
@@ -46,11 +57,23 @@ struct _DmDomain
   char *language;
 
   DmDatabaseManager *db_manager;
-  GMutex db_lock;
   gboolean using_3rd_party_search_index;
 
   // List of DmShard items
   GSList *shards;
+  DmShardIndex *shard_index;
+
+  /* object ID => DmContent */
+  DmCache *model_cache;
+
+  /* the data cache of each ZIM shard gets its own budget of this size */
+  gsize zim_cache_max_bytes;
+
+  /* query cache key => QueryResultsEntry. The set of shards is fixed once
+   * the domain is initialized, so entries stay valid for as long as the
+   * domain is around; new content means a new domain and an empty cache.
+   */
+  DmCache *query_cache;
 };
 
 static void initable_iface_init (GInitableIface *initable_iface);
@@ -62,12 +85,26 @@ enum {
   PROP_APP_ID = 1,
   PROP_PATH,
   PROP_LANGUAGE,
+  PROP_MODEL_CACHE_SIZE,
+  PROP_MODEL_CACHE_MAX_BYTES,
+  PROP_QUERY_CACHE_SIZE,
+  PROP_ZIM_CACHE_MAX_BYTES,
 
   NPROPS
 };
 
 static GParamSpec *dm_domain_props[NPROPS] = { NULL, };
 
+static void
+dm_domain_apply_zim_cache_limits (DmDomain *self)
+{
+  for (GSList *l = self->shards; l != NULL; l = l->next)
+    {
+      if (DM_IS_SHARD_OPEN_ZIM (l->data))
+        dm_shard_open_zim_set_data_cache_max_bytes (l->data, self->zim_cache_max_bytes);
+    }
+}
+
 static void
 dm_domain_get_property (GObject *object,
                         guint prop_id,
@@ -90,6 +127,34 @@ dm_domain_get_property (GObject *object,
       g_value_set_string (value, self->language);
       break;
 
+    case PROP_MODEL_CACHE_SIZE:
+      {
+        guint max_entries;
+        dm_cache_get_limits (self->model_cache, &max_entries, NULL);
+        g_value_set_uint (value, max_entries);
+      }
+      break;
+
+    case PROP_MODEL_CACHE_MAX_BYTES:
+      {
+        gsize max_bytes;
+        dm_cache_get_limits (self->model_cache, NULL, &max_bytes);
+        g_value_set_uint64 (value, max_bytes);
+      }
+      break;
+
+    case PROP_QUERY_CACHE_SIZE:
+      {
+        guint max_entries;
+        dm_cache_get_limits (self->query_cache, &max_entries, NULL);
+        g_value_set_uint (value, max_entries);
+      }
+      break;
+
+    case PROP_ZIM_CACHE_MAX_BYTES:
+      g_value_set_uint64 (value, self->zim_cache_max_bytes);
+      break;
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
     }
@@ -120,6 +185,32 @@ dm_domain_set_property (GObject *object,
       self->language = g_value_dup_string (value);
       break;
 
+    case PROP_MODEL_CACHE_SIZE:
+      {
+        gsize max_bytes;
+        dm_cache_get_limits (self->model_cache, NULL, &max_bytes);
+        dm_cache_set_limits (self->model_cache, g_value_get_uint (value), max_bytes);
+      }
+      break;
+
+    case PROP_MODEL_CACHE_MAX_BYTES:
+      {
+        guint max_entries;
+        dm_cache_get_limits (self->model_cache, &max_entries, NULL);
+        dm_cache_set_limits (self->model_cache, max_entries,
+                             (gsize) MIN (g_value_get_uint64 (value), G_MAXSIZE));
+      }
+      break;
+
+    case PROP_QUERY_CACHE_SIZE:
+      dm_cache_set_limits (self->query_cache, g_value_get_uint (value), 0);
+      break;
+
+    case PROP_ZIM_CACHE_MAX_BYTES:
+      self->zim_cache_max_bytes = (gsize) MIN (g_value_get_uint64 (value), G_MAXSIZE);
+      dm_domain_apply_zim_cache_limits (self);
+      break;
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
     }
@@ -135,10 +226,12 @@ dm_domain_finalize (GObject *object)
   g_free (self->language);
 
   g_clear_object (&self->db_manager);
-  g_mutex_clear (&self->db_lock);
 
   g_list_free_full (self->subscriptions, g_free);
 
+  g_clear_pointer (&self->shard_index, dm_shard_index_free);
+  g_clear_pointer (&self->model_cache, dm_cache_free);
+  g_clear_pointer (&self->query_cache, dm_cache_free);
   g_slist_free_full (self->shards, g_object_unref);
 
   G_OBJECT_CLASS (dm_domain_parent_class)->finalize (object);
@@ -186,29 +279,164 @@ dm_domain_class_init (DmDomainClass *klass)
       NULL,
       G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY | G_PARAM_STATIC_STRINGS);
 
+  /**
+   * DmDomain:model-cache-size:
+   *
+   * The maximum number of content object models the domain keeps around
+   * after loading them, so that requesting them again does not need to
+   * parse their metadata. Set to 0 to disable the cache.
+   *
+   * Since: 0.2
+   */
+  dm_domain_props[PROP_MODEL_CACHE_SIZE] =
+    g_param_spec_uint ("model-cache-size", "Model cache size",
+      "Maximum number of content object models to keep cached",
+      0, G_MAXUINT, DEFAULT_MODEL_CACHE_SIZE,
+      G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+
+  /**
+   * DmDomain:model-cache-max-bytes:
+   *
+   * The approximate amount of memory, in bytes, that the cached content
+   * object models may take up. Set to 0 for no limit other than
+   * #DmDomain:model-cache-size.
+   *
+   * Since: 0.2
+   */
+  dm_domain_props[PROP_MODEL_CACHE_MAX_BYTES] =
+    g_param_spec_uint64 ("model-cache-max-bytes", "Model cache maximum bytes",
+      "Approximate memory budget for cached content object models",
+      0, G_MAXUINT64, DEFAULT_MODEL_CACHE_MAX_BYTES,
+      G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+
+  /**
+   * DmDomain:query-cache-size:
+   *
+   * The maximum number of query results the domain remembers, so that
+   * running an identical query again skips the search database and goes
+   * straight to loading the matching models. Set to 0 to disable the cache.
+   *
+   * Since: 0.2
+   */
+  dm_domain_props[PROP_QUERY_CACHE_SIZE] =
+    g_param_spec_uint ("query-cache-size", "Query cache size",
+      "Maximum number of query results to keep cached",
+      0, G_MAXUINT, DEFAULT_QUERY_CACHE_SIZE,
+      G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+
+  /**
+   * DmDomain:zim-cache-max-bytes:
+   *
+   * The approximate amount of memory, in bytes, that each ZIM file in the
+   * domain may use to keep the decompressed data of articles that were
+   * read, so that reading them again, such as when a page is rendered more
+   * than once, does not decompress them again. Set to 0 to disable the cache.
+   *
+   * Since: 0.2
+   */
+  dm_domain_props[PROP_ZIM_CACHE_MAX_BYTES] =
+    g_param_spec_uint64 ("zim-cache-max-bytes", "ZIM cache maximum bytes",
+      "Approximate memory budget for decompressed ZIM data, per ZIM file",
+      0, G_MAXUINT64, DEFAULT_ZIM_CACHE_MAX_BYTES,
+      G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+
   g_object_class_install_properties (object_class,
                                      NPROPS,
                                      dm_domain_props);
 }
 
+/* The outcome of running a query against the search databases: the URIs of
+ * the matching documents, in order, and the estimated total number of
+ * matches. Immutable once created, so it can be shared between threads.
+ */
+typedef struct
+{
+  gint ref_count;
+
+  GPtrArray *uris;
+  int upper_bound;
+} QueryResultsEntry;
+
+static QueryResultsEntry *
+query_results_entry_new (GPtrArray *uris,
+                         int upper_bound)
+{
+  QueryResultsEntry *entry = g_slice_new0 (QueryResultsEntry);
+
+  entry->ref_count = 1;
+  entry->uris = g_ptr_array_ref (uris);
+  entry->upper_bound = upper_bound;
+
+  return entry;
+}
+
+static QueryResultsEntry *
+query_results_entry_ref (QueryResultsEntry *entry)
+{
+  g_atomic_int_inc (&entry->ref_count);
+  return entry;
+}
+
 static void
-dm_domain_init (G_GNUC_UNUSED DmDomain *self)
+query_results_entry_unref (QueryResultsEntry *entry)
 {
+  if (!g_atomic_int_dec_and_test (&entry->ref_count))
+    return;
+
+  g_ptr_array_unref (entry->uris);
+  g_slice_free (QueryResultsEntry, entry);
 }
 
-static gboolean
-dm_domain_process_subscription (DmDomain *self,
-                                GFile *subscription_dir,
-                                GError **error)
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (QueryResultsEntry, query_results_entry_unref)
+
+static gsize
+query_results_entry_get_size (QueryResultsEntry *entry)
+{
+  gsize size = sizeof (QueryResultsEntry) + entry->uris->len * sizeof (gpointer);
+
+  for (guint i = 0; i < entry->uris->len; i++)
+    size += strlen (g_ptr_array_index (entry->uris, i)) + 1;
+
+  return size;
+}
+
+static void
+dm_domain_init (DmDomain *self)
+{
+  self->model_cache = dm_cache_new (g_str_hash, g_str_equal,
+                                    (GBoxedCopyFunc) g_strdup, g_free,
+                                    g_object_ref, g_object_unref,
+                                    DEFAULT_MODEL_CACHE_SIZE,
+                                    DEFAULT_MODEL_CACHE_MAX_BYTES);
+  self->query_cache = dm_cache_new (g_str_hash, g_str_equal,
+                                    (GBoxedCopyFunc) g_strdup, g_free,
+                                    (GBoxedCopyFunc) query_results_entry_ref,
+                                    (GDestroyNotify) query_results_entry_unref,
+                                    DEFAULT_QUERY_CACHE_SIZE, 0);
+  self->zim_cache_max_bytes = DEFAULT_ZIM_CACHE_MAX_BYTES;
+}
+
+static JsonParser *
+load_manifest (GFile *subscription_dir,
+               GError **error)
 {
   g_autofree gchar *subscription_path = g_file_get_path (subscription_dir);
-  JsonParser *json_parser = json_parser_new ();
+  g_autoptr(JsonParser) json_parser = json_parser_new ();
   g_autofree gchar *manifest_filename = g_build_filename (subscription_path, "manifest.json", NULL);
-  gboolean parsing_success = json_parser_load_from_file (json_parser, manifest_filename, error);
-  if (!parsing_success)
-    return FALSE;
+  if (!json_parser_load_from_file (json_parser, manifest_filename, error))
+    return NULL;
+
+  return g_steal_pointer (&json_parser);
+}
 
-  g_autoptr(JsonNode) manifest_node = json_parser_get_root (json_parser);
+static gboolean
+dm_domain_process_manifest (DmDomain *self,
+                            GFile *subscription_dir,
+                            JsonParser *json_parser,
+                            GError **error)
+{
+  g_autofree gchar *subscription_path = g_file_get_path (subscription_dir);
+  JsonNode *manifest_node = json_parser_get_root (json_parser);
   JsonObject *manifest = json_node_get_object (manifest_node);
   g_autoptr(GHashTable) db_offset_by_path = g_hash_table_new_full (g_str_hash, g_str_equal,
                                                                    NULL, g_free);
@@ -302,10 +530,42 @@ dm_domain_process_subscription (DmDomain *self,
 }
 
 static gboolean
-dm_domain_import_subscriptions (DmDomain *self,
-                                GFile *subscriptions_dir,
-                                GCancellable *cancellable,
+dm_domain_process_subscription (DmDomain *self,
+                                GFile *subscription_dir,
                                 GError **error)
+{
+  g_autoptr(JsonParser) json_parser = load_manifest (subscription_dir, error);
+  if (json_parser == NULL)
+    return FALSE;
+
+  return dm_domain_process_manifest (self, subscription_dir, json_parser, error);
+}
+
+typedef struct
+{
+  GFile *dir;
+  char *name;
+
+  JsonParser *manifest;
+  GError *error;
+} Subscription;
+
+static void
+subscription_free (Subscription *subscription)
+{
+  g_clear_object (&subscription->dir);
+  g_clear_pointer (&subscription->name, g_free);
+  g_clear_object (&subscription->manifest);
+  g_clear_error (&subscription->error);
+
+  g_slice_free (Subscription, subscription);
+}
+
+static gboolean
+list_subscriptions (GFile *subscriptions_dir,
+                    GPtrArray *subscriptions,
+                    GCancellable *cancellable,
+                    GError **error)
 {
   g_autoptr(GFileEnumerator) subscriptions_iter = g_file_enumerate_children (subscriptions_dir, "",
                                                                              G_FILE_QUERY_INFO_NONE,
@@ -320,10 +580,73 @@ dm_domain_import_subscriptions (DmDomain *self,
         break;
       if (g_file_info_get_file_type (info) != G_FILE_TYPE_DIRECTORY)
         continue;
-      if (!dm_domain_process_subscription (self, dir, error))
+
+      Subscription *subscription = g_slice_new0 (Subscription);
+      subscription->dir = g_object_ref (dir);
+      subscription->name = g_strdup (g_file_info_get_name (info));
+      g_ptr_array_add (subscriptions, subscription);
+    }
+
+  return TRUE;
+}
+
+static void
+load_manifest_for_index (guint index,
+                         gpointer user_data)
+{
+  GPtrArray *subscriptions = user_data;
+  Subscription *subscription = g_ptr_array_index (subscriptions, index);
+
+  subscription->manifest = load_manifest (subscription->dir, &subscription->error);
+}
+
+/* Imports the subscriptions in each directory of @subscriptions_dirs, in
+ * order. The manifests are all loaded in parallel first, and then processed
+ * one after the other so that the shards keep their order. The path of each
+ * manifest is appended to @watched_paths. */
+static gboolean
+dm_domain_import_subscriptions (DmDomain *self,
+                                GPtrArray *subscriptions_dirs,
+                                GPtrArray *watched_paths,
+                                GCancellable *cancellable,
+                                GError **error)
+{
+  g_autoptr(GPtrArray) subscriptions =
+    g_ptr_array_new_with_free_func ((GDestroyNotify) subscription_free);
+
+  for (guint i = 0; i < subscriptions_dirs->len; i++)
+    {
+      if (!list_subscriptions (g_ptr_array_index (subscriptions_dirs, i),
+                               subscriptions, cancellable, error))
+        return FALSE;
+    }
+
+  for (guint i = 0; i < subscriptions->len; i++)
+    {
+      Subscription *subscription = g_ptr_array_index (subscriptions, i);
+      g_autofree char *subscription_path = g_file_get_path (subscription->dir);
+      g_ptr_array_add (watched_paths, g_build_filename (subscription_path,
+                                                        "manifest.json", NULL));
+    }
+
+  dm_utils_parallel_for (subscriptions->len, load_manifest_for_index, subscriptions);
+
+  for (guint i = 0; i < subscriptions->len; i++)
+    {
+      Subscription *subscription = g_ptr_array_index (subscriptions, i);
+
+      if (subscription->manifest == NULL)
+        {
+          g_propagate_error (error, g_steal_pointer (&subscription->error));
           return FALSE;
+        }
+
+      if (!dm_domain_process_manifest (self, subscription->dir,
+                                       subscription->manifest, error))
+        return FALSE;
 
-      self->subscriptions = g_list_prepend (self->subscriptions, g_strdup (g_file_info_get_name (info)));
+      self->subscriptions = g_list_prepend (self->subscriptions,
+                                            g_steal_pointer (&subscription->name));
     }
 
   return TRUE;
@@ -342,6 +665,8 @@ dm_domain_initable_init (GInitable *initable,
                          GError **error)
 {
   DmDomain *self = DM_DOMAIN (initable);
+  g_autofree char *content_path = NULL;
+  g_autoptr(GPtrArray) watched_paths = NULL;
 
   gboolean has_app_id = (self->app_id != NULL && *self->app_id != '\0');
   gboolean has_path = (self->path != NULL && *self->path != '\0');
@@ -363,38 +688,55 @@ dm_domain_initable_init (GInitable *initable,
     }
   else if (has_app_id)
     {
-      /* Import subscriptions from data directory */
       g_autoptr(GFile) content_dir = dm_get_data_dir (self->app_id);
-      g_autoptr(GFile) subscriptions_dir = g_file_get_child (content_dir,
-                                                             "com.endlessm.subscriptions");
-      if (is_directory (subscriptions_dir, cancellable))
+      content_path = g_file_get_path (content_dir);
+
+      /* Try the descriptor left behind by a previous run first, it is only
+         used if nothing it was built from has changed since */
+      if (dm_domain_descriptor_load (self->app_id, content_path,
+                                     &self->shards, &self->subscriptions))
         {
-          if (!dm_domain_import_subscriptions (self, subscriptions_dir,
-                                               cancellable, error))
-              return FALSE;
+          /* Each subscription has shards of one type only, but they can
+             differ between subscriptions, so look at all of them */
+          for (GSList *l = self->shards; l != NULL; l = l->next)
+            if (DM_IS_SHARD_OPEN_ZIM (l->data))
+              self->using_3rd_party_search_index = TRUE;
         }
-
-      /* libdmodel is used to query app content from SDK apps and from
-         eos-knowledge-services (EKS). If we find the app content under
-         the /app directory, that means we've found the content in the context
-         of the app sandbox, not EKS, so that means we don't need to scan
-         for the app extensions dirs manually in Flatpak installations
-         (EKS case, where content is not mounted in /app) */
-      g_autofree char *subscriptions_path = g_file_get_path (subscriptions_dir);
-      if (!g_str_has_prefix (subscriptions_path, "/app"))
+      else
         {
-          /* Import subscriptions from extensions directories */
-          g_autoptr(GList) extensions_dirs = dm_get_extensions_dirs (self->app_id);
-          for (GList *l = extensions_dirs; l != NULL; l = l->next)
+          g_autoptr(GPtrArray) subscriptions_dirs = g_ptr_array_new_with_free_func (g_object_unref);
+          watched_paths = g_ptr_array_new_with_free_func (g_free);
+
+          /* Import subscriptions from data directory */
+          g_autoptr(GFile) subscriptions_dir = g_file_get_child (content_dir,
+                                                                 "com.endlessm.subscriptions");
+          g_autofree char *subscriptions_path = g_file_get_path (subscriptions_dir);
+          g_ptr_array_add (watched_paths, g_strdup (subscriptions_path));
+          if (is_directory (subscriptions_dir, cancellable))
+            g_ptr_array_add (subscriptions_dirs, g_object_ref (subscriptions_dir));
+
+          /* libdmodel is used to query app content from SDK apps and from
+             eos-knowledge-services (EKS). If we find the app content under
+             the /app directory, that means we've found the content in the context
+             of the app sandbox, not EKS, so that means we don't need to scan
+             for the app extensions dirs manually in Flatpak installations
+             (EKS case, where content is not mounted in /app) */
+          if (!g_str_has_prefix (subscriptions_path, "/app"))
             {
-              GFile *extension_dir = l->data;
-              if (is_directory (extension_dir, cancellable))
+              /* Import subscriptions from extensions directories */
+              g_autoptr(GList) extensions_dirs = dm_utils_get_extensions_dirs_full (self->app_id,
+                                                                                    watched_paths);
+              for (GList *l = extensions_dirs; l != NULL; l = l->next)
                 {
-                  if (!dm_domain_import_subscriptions (self, extension_dir,
-                                                      cancellable, error))
-                      return FALSE;
+                  GFile *extension_dir = l->data;
+                  if (is_directory (extension_dir, cancellable))
+                    g_ptr_array_add (subscriptions_dirs, g_object_ref (extension_dir));
                 }
             }
+
+          if (!dm_domain_import_subscriptions (self, subscriptions_dirs,
+                                               watched_paths, cancellable, error))
+            return FALSE;
         }
     }
   else
@@ -411,12 +753,21 @@ dm_domain_initable_init (GInitable *initable,
       return FALSE;
     }
 
+  dm_domain_apply_zim_cache_limits (self);
+
   self->db_manager = dm_database_manager_new (self->shards);
-  g_mutex_init (&self->db_lock);
 
   if (!dm_utils_parallel_init (self->shards, 0, cancellable, error))
     return FALSE;
 
+  self->shard_index = dm_shard_index_new (self->shards);
+
+  /* Now that the shards are initialized, their database offsets can be
+     looked up and saved along with everything else */
+  if (watched_paths != NULL)
+    dm_domain_descriptor_save (self->app_id, content_path, watched_paths,
+                               self->shards, self->subscriptions);
+
   return TRUE;
 }
 
@@ -439,10 +790,7 @@ dm_domain_load_record (DmDomain *self,
       return NULL;
     }
 
-  DmShardRecord *record = NULL;
-  for (GSList *l = self->shards; l && !record; l = g_slist_next (l))
-    record = dm_shard_find_by_id (l->data, object_id);
-  return record;
+  return dm_shard_index_find_by_id (self->shard_index, object_id);
 }
 
 /**
@@ -518,10 +866,214 @@ dm_domain_test_link (DmDomain *self,
                      const gchar *link,
                      GError **error)
 {
-  gchar *object_uri = NULL;
-  for (GSList *l = self->shards; l && !object_uri && !*error; l = g_slist_next (l))
-    object_uri = dm_shard_test_link (l->data, link, error);
-  return object_uri;
+  g_return_val_if_fail (DM_IS_DOMAIN (self), NULL);
+  g_return_val_if_fail (link != NULL, NULL);
+
+  return dm_shard_index_test_link (self->shard_index, link, error);
+}
+
+/* Loads the model for @uri from its shard, without looking in the model
+ * cache. If @fields is not %NULL, only those properties are filled in, and
+ * the model is not added to the cache, since other callers expect complete
+ * models. This reads from disk. */
+static DmContent *
+dm_domain_load_model (DmDomain *self,
+                      const char *uri,
+                      const char * const *fields,
+                      GCancellable *cancellable,
+                      GError **error)
+{
+  g_autofree gchar *object_id = (gchar *) dm_utils_uri_get_object_id (uri);
+  g_autoptr(DmShardRecord) record = dm_domain_load_record (self, uri, NULL);
+  if (record == NULL)
+    {
+      g_set_error (error, DM_DOMAIN_ERROR, DM_DOMAIN_ERROR_ID_NOT_FOUND,
+                   "Could not find shard record for URI %s", uri);
+      return NULL;
+    }
+
+  DmShard *shard = dm_shard_record_get_shard (record);
+
+  if (fields != NULL)
+    return dm_shard_get_model_with_fields (shard, record, fields,
+                                           cancellable, error);
+
+  DmContent *model = dm_shard_get_model (shard, record, cancellable, error);
+  if (model != NULL)
+    dm_cache_insert (self->model_cache, object_id, model,
+                     dm_content_get_approximate_size (model));
+
+  return model;
+}
+
+/* Looks up @uri in the model cache, returning a new reference to the model
+ * or %NULL if it's not there. A complete model from the cache satisfies a
+ * caller that only needs some fields just as well. */
+static DmContent *
+dm_domain_lookup_model (DmDomain *self,
+                        const char *uri)
+{
+  g_autofree gchar *object_id = (gchar *) dm_utils_uri_get_object_id (uri);
+
+  if (object_id == NULL)
+    return NULL;
+
+  return dm_cache_lookup (self->model_cache, object_id);
+}
+
+/* Loads the model for @uri, from the model cache if it's there. See
+ * dm_domain_load_model(). */
+static DmContent *
+dm_domain_get_object_sync (DmDomain *self,
+                           const char *uri,
+                           const char * const *fields,
+                           GCancellable *cancellable,
+                           GError **error)
+{
+  DmContent *model = dm_domain_lookup_model (self, uri);
+  if (model != NULL)
+    return model;
+
+  return dm_domain_load_model (self, uri, fields, cancellable, error);
+}
+
+/**
+ * dm_domain_get_model_cache_stats:
+ * @self: the domain
+ * @hits: (out) (optional): return location for the number of cache hits
+ * @misses: (out) (optional): return location for the number of cache misses
+ *
+ * Gets the number of times a content object model was requested from this
+ * domain and was, or was not, found in its model cache.
+ * See #DmDomain:model-cache-size.
+ *
+ * Since: 0.2
+ */
+void
+dm_domain_get_model_cache_stats (DmDomain *self,
+                                 guint64 *hits,
+                                 guint64 *misses)
+{
+  g_return_if_fail (DM_IS_DOMAIN (self));
+
+  dm_cache_get_stats (self->model_cache, hits, misses, NULL, NULL);
+}
+
+/**
+ * dm_domain_get_spelling_cache_stats:
+ * @self: the domain
+ * @hits: (out) (optional): return location for the number of cache hits
+ * @misses: (out) (optional): return location for the number of cache misses
+ *
+ * Gets the number of times the stop word filtering and spelling correction
+ * of a set of search terms was, or was not, already known from an earlier
+ * query to this domain.
+ *
+ * Since: 0.2
+ */
+void
+dm_domain_get_spelling_cache_stats (DmDomain *self,
+                                    guint64 *hits,
+                                    guint64 *misses)
+{
+  g_return_if_fail (DM_IS_DOMAIN (self));
+
+  dm_database_manager_get_spelling_cache_stats (self->db_manager, hits, misses);
+}
+
+/**
+ * dm_domain_get_zim_cache_stats:
+ * @self: the domain
+ * @hits: (out) (optional): return location for the number of cache hits
+ * @misses: (out) (optional): return location for the number of cache misses
+ *
+ * Gets the number of times compressed data was read from the ZIM files in
+ * this domain and its decompressed form was, or was not, already cached,
+ * summed over all of the domain's ZIM files.
+ * See #DmDomain:zim-cache-max-bytes.
+ *
+ * Since: 0.2
+ */
+void
+dm_domain_get_zim_cache_stats (DmDomain *self,
+                               guint64 *hits,
+                               guint64 *misses)
+{
+  g_return_if_fail (DM_IS_DOMAIN (self));
+
+  guint64 total_hits = 0, total_misses = 0;
+  for (GSList *l = self->shards; l != NULL; l = l->next)
+    {
+      if (!DM_IS_SHARD_OPEN_ZIM (l->data))
+        continue;
+
+      guint64 shard_hits, shard_misses;
+      dm_shard_open_zim_get_data_cache_stats (l->data, &shard_hits, &shard_misses);
+      total_hits += shard_hits;
+      total_misses += shard_misses;
+    }
+
+  if (hits != NULL)
+    *hits = total_hits;
+  if (misses != NULL)
+    *misses = total_misses;
+}
+
+/**
+ * dm_domain_get_zim_redirect_cache_stats:
+ * @self: the domain
+ * @hits: (out) (optional): return location for the number of cache hits
+ * @misses: (out) (optional): return location for the number of cache misses
+ *
+ * Gets the number of times a redirect was looked up in the ZIM files in this
+ * domain and where it leads was, or was not, already known, summed over all
+ * of the domain's ZIM files.
+ *
+ * Since: 0.2
+ */
+void
+dm_domain_get_zim_redirect_cache_stats (DmDomain *self,
+                                        guint64 *hits,
+                                        guint64 *misses)
+{
+  g_return_if_fail (DM_IS_DOMAIN (self));
+
+  guint64 total_hits = 0, total_misses = 0;
+  for (GSList *l = self->shards; l != NULL; l = l->next)
+    {
+      if (!DM_IS_SHARD_OPEN_ZIM (l->data))
+        continue;
+
+      guint64 shard_hits, shard_misses;
+      dm_shard_open_zim_get_redirect_cache_stats (l->data, &shard_hits, &shard_misses);
+      total_hits += shard_hits;
+      total_misses += shard_misses;
+    }
+
+  if (hits != NULL)
+    *hits = total_hits;
+  if (misses != NULL)
+    *misses = total_misses;
+}
+
+static void
+get_object_thread (GTask *task,
+                   gpointer source_object,
+                   gpointer task_data,
+                   GCancellable *cancellable)
+{
+  DmDomain *self = source_object;
+  const char *uri = task_data;
+  GError *error = NULL;
+
+  DmContent *model = dm_domain_load_model (self, uri, NULL, cancellable, &error);
+  if (model == NULL)
+    {
+      g_task_return_error (task, error);
+      return;
+    }
+
+  g_task_return_pointer (task, model, g_object_unref);
 }
 
 /**
@@ -544,28 +1096,20 @@ dm_domain_get_object (DmDomain *self,
   g_return_if_fail (DM_IS_DOMAIN (self));
   g_return_if_fail (G_IS_CANCELLABLE (cancellable) || cancellable == NULL);
 
-  GError *error = NULL;
-
   g_autoptr(GTask) task = g_task_new (self, cancellable, callback, user_data);
 
-  g_autoptr(DmShardRecord) record = dm_domain_load_record (self, uri, NULL);
-  if (record == NULL)
-    {
-      g_task_return_new_error (task, DM_DOMAIN_ERROR, DM_DOMAIN_ERROR_ID_NOT_FOUND,
-                               "Could not find shard record for URI %s", uri);
-      return;
-    }
-
-  DmContent *model = dm_shard_get_model (dm_shard_record_get_shard (record),
-                                         record, cancellable, &error);
-
-  if (error != NULL)
+  DmContent *model = dm_domain_lookup_model (self, uri);
+  if (model != NULL)
     {
-      g_task_return_error (task, error);
+      g_task_return_pointer (task, model, g_object_unref);
       return;
     }
 
-  g_task_return_pointer (task, model, g_object_unref);
+  /* Looking up the record and loading the model both read from disk, keep
+   * them off the caller's thread */
+  g_task_set_priority (task, G_PRIORITY_DEFAULT);
+  g_task_set_task_data (task, g_strdup (uri), g_free);
+  dm_utils_run_io_task (task, get_object_thread);
 }
 
 /**
@@ -589,22 +1133,101 @@ dm_domain_get_object_finish (DmDomain *self,
   return g_task_propagate_pointer (G_TASK (result), error);
 }
 
-static DmContent *
-dm_domain_get_object_sync (DmDomain *self,
-                           const char *uri,
-                           GCancellable *cancellable,
-                           GError **error)
+typedef struct
 {
-  g_autoptr(DmShardRecord) record = dm_domain_load_record (self, uri, NULL);
-  if (record == NULL)
+  DmDomain *domain;
+  GCancellable *cancellable;
+
+  GPtrArray *uris;
+  const char * const *fields;
+  DmContent **models;
+  GError **errors;
+} ObjectsBatch;
+
+static void
+get_object_for_batch_index (guint index,
+                            gpointer user_data)
+{
+  ObjectsBatch *batch = user_data;
+  const char *uri = g_ptr_array_index (batch->uris, index);
+
+  if (g_cancellable_set_error_if_cancelled (batch->cancellable, &batch->errors[index]))
+    return;
+
+  g_debug ("Retrieving document object '%s'\n", uri);
+
+  batch->models[index] = dm_domain_get_object_sync (batch->domain, uri,
+                                                    batch->fields,
+                                                    batch->cancellable,
+                                                    &batch->errors[index]);
+}
+
+/*< private >
+ * dm_domain_get_objects_sync:
+ * @self: the domain
+ * @uris: (element-type utf8): the URIs of the objects to load
+ * @fields: (nullable): the model properties to fill in, or %NULL for all
+ * @models_out: (out) (transfer full) (element-type DmContent): return
+ *   location for the models
+ * @cancellable: (nullable): a #GCancellable
+ * @error: return location for an error
+ *
+ * Fetches the models for a list of URIs, looking up their records and
+ * parsing their metadata in parallel. The models are returned in the same
+ * order as @uris; if any of them fails, the first error in that order is
+ * returned. @fields is as for dm_domain_get_object_sync().
+ *
+ * Returns: %TRUE if all the models were loaded
+ */
+gboolean
+dm_domain_get_objects_sync (DmDomain *self,
+                            GPtrArray *uris,
+                            const char * const *fields,
+                            GSList **models_out,
+                            GCancellable *cancellable,
+                            GError **error)
+{
+  g_autoptr(EosProfileProbe) probe = EOS_PROFILE_PROBE ("/dmodel/domain/get_objects");
+
+  ObjectsBatch batch = {
+    .domain = self,
+    .cancellable = cancellable,
+    .uris = uris,
+    .fields = fields,
+    .models = g_new0 (DmContent *, uris->len),
+    .errors = g_new0 (GError *, uris->len),
+  };
+
+  dm_utils_parallel_for (uris->len, get_object_for_batch_index, &batch);
+
+  gboolean retval = TRUE;
+  GSList *models = NULL;
+
+  for (guint i = 0; i < uris->len; i++)
     {
-      g_set_error (error, DM_DOMAIN_ERROR, DM_DOMAIN_ERROR_ID_NOT_FOUND,
-                   "Could not find shard record for URI %s", uri);
-      return NULL;
+      if (batch.errors[i] != NULL)
+        {
+          if (retval)
+            g_propagate_error (error, batch.errors[i]);
+          else
+            g_error_free (batch.errors[i]);
+
+          retval = FALSE;
+        }
+
+      if (batch.models[i] != NULL)
+        models = g_slist_prepend (models, batch.models[i]);
     }
 
-  return dm_shard_get_model (dm_shard_record_get_shard (record),
-                             record, cancellable, error);
+  if (retval)
+    *models_out = g_slist_reverse (models);
+  else
+    g_slist_free_full (models, g_object_unref);
+
+  g_free (batch.models);
+  g_free (batch.errors);
+
+  return retval;
 }
 
 typedef struct
@@ -615,8 +1238,8 @@ typedef struct
 
   DmDatabaseManager *db_manager;
 
-  char *fixed_stop_terms;
-  char *fixed_spell_terms;
+  /* Whether to fix the search terms before running the query */
+  gboolean fix_query;
 } RequestState;
 
 static void
@@ -624,9 +1247,6 @@ request_state_free (gpointer data)
 {
   RequestState *state = data;
 
-  g_free (state->fixed_stop_terms);
-  g_free (state->fixed_spell_terms);
-
   g_clear_object (&state->domain);
   g_clear_object (&state->query);
   g_clear_object (&state->db_manager);
@@ -634,42 +1254,84 @@ request_state_free (gpointer data)
   g_slice_free (RequestState, state);
 }
 
+/* Returns the query to fix and run in place of @query. This is a copy if
+ * anything needs to be changed, since @query belongs to the caller and may
+ * be used from other threads at the same time. */
+static DmQuery *
+prepare_query_for_fix (DmDomain *self,
+                       DmQuery *query)
+{
+  if (!self->using_3rd_party_search_index)
+    return g_object_ref (query);
+
+  return dm_query_new_from_object (query,
+                                   "match", DM_QUERY_MATCH_TITLE_SYNOPSIS,
+                                   "cutoff", 5,
+                                   "tags-match-all", NULL,
+                                   "tags-match-any", NULL,
+                                   "content-type", NULL,
+                                   "excluded-content-type", NULL,
+                                   NULL);
+}
+
+/*< private >
+ * dm_domain_fix_query_sync:
+ * @self: the domain
+ * @query: the query object to fix
+ * @error: return location for an error
+ *
+ * Synchronous version of dm_domain_get_fixed_query(), for use from worker
+ * threads.
+ *
+ * Returns: (transfer full): a new query object with the fixed query, or
+ *   @query itself if there was nothing to fix
+ */
+DmQuery *
+dm_domain_fix_query_sync (DmDomain *self,
+                          DmQuery *query,
+                          GError **error)
+{
+  GError *internal_error = NULL;
+
+  g_autoptr(DmQuery) prepared_query = prepare_query_for_fix (self, query);
+
+  g_autofree char *fixed_stop_terms = NULL;
+  g_autofree char *fixed_spell_terms = NULL;
+
+  dm_database_manager_fix_query (self->db_manager,
+                                 dm_query_get_search_terms (prepared_query),
+                                 &fixed_stop_terms,
+                                 &fixed_spell_terms, &internal_error);
+  if (internal_error != NULL)
+    {
+      g_propagate_error (error, internal_error);
+      return NULL;
+    }
+
+  return dm_query_new_fixed (prepared_query, fixed_stop_terms, fixed_spell_terms);
+}
+
 static void
 query_fix_task (GTask *task,
-                gpointer source_obj,
+                G_GNUC_UNUSED gpointer source_obj,
                 gpointer task_data,
                 G_GNUC_UNUSED GCancellable *cancellable)
 {
-  DmDomain *self = source_obj;
   RequestState *request = task_data;
   GError *error = NULL;
 
   if (g_task_return_error_if_cancelled (task))
     return;
 
-  g_autoptr(GMutexLocker) db_lock = g_mutex_locker_new (&self->db_lock);
-
-  if (request->domain->using_3rd_party_search_index)
-    g_object_set (request->query,
-                  "match", DM_QUERY_MATCH_TITLE_SYNOPSIS,
-                  "cutoff", 5,
-                  "tags-match-all", NULL,
-                  "tags-match-any", NULL,
-                  "content-type", NULL,
-                  "excluded-content-type", NULL,
-                  NULL);
-
-  dm_database_manager_fix_query (request->db_manager,
-                                 dm_query_get_search_terms (request->query),
-                                 &request->fixed_stop_terms,
-                                 &request->fixed_spell_terms, &error);
-  if (error != NULL)
+  DmQuery *fixed_query = dm_domain_fix_query_sync (request->domain,
+                                                   request->query, &error);
+  if (fixed_query == NULL)
     {
       g_task_return_error (task, error);
       return;
     }
 
-  g_task_return_boolean (task, TRUE);
+  g_task_return_pointer (task, fixed_query, g_object_unref);
 }
 
 /**
@@ -732,112 +1394,240 @@ dm_domain_get_fixed_query_finish (DmDomain *self,
   g_return_val_if_fail (G_IS_TASK (result), NULL);
   g_return_val_if_fail (error == NULL || *error == NULL, NULL);
 
-  gboolean success = g_task_propagate_boolean (G_TASK (result), error);
-
-  if (success)
-    {
-      RequestState *request = g_task_get_task_data (G_TASK (result));
-
-      /* If we didn't get a corrected query, we can just reuse the existing query object */
-      if (request->fixed_stop_terms == NULL && request->fixed_spell_terms == NULL)
-        return g_object_ref (request->query);
-
-      if (request->fixed_stop_terms != NULL && request->fixed_spell_terms != NULL)
-        return dm_query_new_from_object (request->query,
-                                         "stopword-free-terms", request->fixed_stop_terms,
-                                         "corrected-terms", request->fixed_spell_terms,
-                                         NULL);
-      else if (request->fixed_stop_terms != NULL)
-        return dm_query_new_from_object (request->query,
-                                         "stopword-free-terms", request->fixed_stop_terms,
-                                         NULL);
-      else
-        return dm_query_new_from_object (request->query,
-                                         "corrected-terms", request->fixed_spell_terms,
-                                         NULL);
-    }
-
-  return NULL;
+  return g_task_propagate_pointer (G_TASK (result), error);
 }
 
-static void
-query_task (GTask *task,
-            gpointer source_object,
-            gpointer task_data,
-            G_GNUC_UNUSED GCancellable *cancellable)
+static const char *
+get_query_language (DmDomain *self)
 {
-  RequestState *state = task_data;
-  DmDomain *self = source_object;
-  GError *error = NULL;
-
-  if (g_task_return_error_if_cancelled (task))
-    return;
-
-  g_autoptr(GMutexLocker) db_lock = g_mutex_locker_new (&self->db_lock);
-
   const char *lang = self->language;
   if (lang == NULL || *lang == '\0')
-    lang = "none";
+    return "none";
+  return lang;
+}
 
-  g_autoptr(XapianMSet) results =
-    dm_database_manager_query (state->db_manager, state->query, lang, &error);
-  if (error != NULL)
-    {
-      g_task_return_error (task, error);
-      return;
-    }
+/* Collects the URIs of the documents in @results, in order. The results of
+ * a count hold every match, so their size is the exact count, and none of
+ * their documents are read. */
+static GPtrArray *
+get_uris_from_results (XapianMSet *results,
+                       DmQuery *query,
+                       int *upper_bound_out)
+{
+  GError *internal_error = NULL;
 
   int n_results = xapian_mset_get_size (results);
   int upper_bound = xapian_mset_get_matches_upper_bound (results);
 
   g_debug (G_STRLOC ": Found %d results (upper bound: %d)\n", n_results, upper_bound);
 
-  GList *models = NULL;
+  if (dm_query_get_output (query) == DM_QUERY_OUTPUT_COUNT)
+    {
+      *upper_bound_out = n_results;
+      return g_ptr_array_new_with_free_func (g_free);
+    }
+
+  GPtrArray *uris = g_ptr_array_new_full (n_results, g_free);
 
   g_autoptr(XapianMSetIterator) iter = xapian_mset_get_begin (results);
   while (xapian_mset_iterator_next (iter))
     {
-      GError *internal_error = NULL;
-
       XapianDocument *document = xapian_mset_iterator_get_document (iter, &internal_error);
       if (internal_error != NULL)
         {
           g_debug ("INTERNAL: Unable to fetch document from iterator: %s",
                    internal_error->message);
-          g_error_free (internal_error);
+          g_clear_error (&internal_error);
           continue;
         }
 
       g_autofree char *document_data = xapian_document_get_data (document);
-      g_autofree char *uri = NULL;
 
       if (!g_str_has_prefix (document_data, "ekn://"))
-        uri = g_strconcat ("ekn+zim:///", document_data, NULL);
+        g_ptr_array_add (uris, g_strconcat ("ekn+zim:///", document_data, NULL));
+      else
+        g_ptr_array_add (uris, g_steal_pointer (&document_data));
+    }
+
+  *upper_bound_out = upper_bound;
+  return uris;
+}
+
+/*< private >
+ * dm_domain_run_query:
+ * @self: the domain
+ * @query: the query to run
+ * @upper_bound_out: (out): return location for the upper bound on the total
+ *   number of matches
+ * @error: return location for an error
+ *
+ * Runs @query against the search databases, without going through the
+ * query cache, and without loading any models.
+ *
+ * Returns: (transfer full) (element-type utf8): the URIs of the matching
+ *   documents, in order, or %NULL on error
+ */
+GPtrArray *
+dm_domain_run_query (DmDomain *self,
+                     DmQuery *query,
+                     int *upper_bound_out,
+                     GError **error)
+{
+  g_autoptr(XapianMSet) results =
+    dm_database_manager_query (self->db_manager, query,
+                               get_query_language (self), error);
+  if (results == NULL)
+    return NULL;
+
+  return get_uris_from_results (results, query, upper_bound_out);
+}
+
+/* Like dm_domain_run_query(), but fixes the search terms of @query first,
+ * while holding on to the same database handle. */
+static GPtrArray *
+dm_domain_fix_and_run_query (DmDomain *self,
+                             DmQuery *query,
+                             int *upper_bound_out,
+                             GError **error)
+{
+  g_autoptr(XapianMSet) results =
+    dm_database_manager_fix_and_query (self->db_manager, query,
+                                       get_query_language (self), error);
+  if (results == NULL)
+    return NULL;
+
+  return get_uris_from_results (results, query, upper_bound_out);
+}
+
+/* Gets the URIs matching @query from the query cache, or runs it and caches
+ * them, fixing its search terms first if @fix_query is %TRUE. */
+static QueryResultsEntry *
+dm_domain_lookup_query (DmDomain *self,
+                        DmQuery *query,
+                        gboolean fix_query,
+                        GError **error)
+{
+  g_autoptr(DmQuery) prepared_query = NULL;
+  if (fix_query)
+    query = prepared_query = prepare_query_for_fix (self, query);
+
+  /* Fixing is deterministic for a given set of databases, so results for a
+   * query whose terms still have to be fixed are cached under the unfixed
+   * query, and a hit skips the spelling correction as well. A count has no
+   * URIs, so it gets a key of its own. */
+  g_autofree char *query_key = dm_query_get_cache_key (query);
+  gboolean count = dm_query_get_output (query) == DM_QUERY_OUTPUT_COUNT;
+  g_autofree char *cache_key = g_strconcat (fix_query ? "fix:" : "",
+                                            count ? "count:" : "",
+                                            query_key, NULL);
+  QueryResultsEntry *entry = dm_cache_lookup (self->query_cache, cache_key);
+
+  if (entry == NULL)
+    {
+      int upper_bound;
+      g_autoptr(GPtrArray) uris = NULL;
+
+      if (fix_query)
+        uris = dm_domain_fix_and_run_query (self, query, &upper_bound, error);
       else
-        uri = g_strdup (document_data);
+        uris = dm_domain_run_query (self, query, &upper_bound, error);
 
-      g_debug ("Retrieving document object '%s'\n", uri);
+      if (uris == NULL)
+        return NULL;
 
-      DmContent *model =
-        dm_domain_get_object_sync (self, uri, NULL, &internal_error);
+      entry = query_results_entry_new (uris, upper_bound);
+      dm_cache_insert (self->query_cache, cache_key, entry,
+                       query_results_entry_get_size (entry));
+    }
 
-      if (internal_error != NULL)
-        {
-          g_task_return_error (task, internal_error);
-          return;
-        }
+  return entry;
+}
+
+/* Builds the results for @query from @entry, loading the models for its URIs
+ * if @query asks for them */
+static DmQueryResults *
+dm_domain_load_query_results (DmDomain *self,
+                              DmQuery *query,
+                              QueryResultsEntry *entry,
+                              GCancellable *cancellable,
+                              GError **error)
+{
+  GPtrArray *uris = entry->uris;
+  GSList *models = NULL;
 
-      models = g_list_prepend (models, model);
+  switch (dm_query_get_output (query))
+    {
+    case DM_QUERY_OUTPUT_COUNT:
+      return g_object_new (DM_TYPE_QUERY_RESULTS,
+                           "upper-bound", entry->upper_bound,
+                           NULL);
+
+    case DM_QUERY_OUTPUT_IDS:
+      {
+        g_auto(GStrv) ids = g_new0 (char *, uris->len + 1);
+        for (guint i = 0; i < uris->len; i++)
+          ids[i] = g_strdup (g_ptr_array_index (uris, i));
+
+        return g_object_new (DM_TYPE_QUERY_RESULTS,
+                             "upper-bound", entry->upper_bound,
+                             "ids", ids,
+                             NULL);
+      }
+
+    case DM_QUERY_OUTPUT_MODELS:
+    default:
+      break;
     }
 
-  g_debug ("Models found: %d of %d matches", g_list_length (models), n_results);
+  const char * const *fields = (const char * const *) dm_query_get_fields (query);
+
+  if (!dm_domain_get_objects_sync (self, uris, fields, &models, cancellable, error))
+    return NULL;
+
+  g_debug ("Models found: %u of %u matches", g_slist_length (models), uris->len);
 
   DmQueryResults *query_results =
     g_object_new (DM_TYPE_QUERY_RESULTS,
-                  "upper-bound", upper_bound,
-                  "models", g_list_reverse (models),
+                  "upper-bound", entry->upper_bound,
+                  "models", models,
                   NULL);
 
+  g_slist_free_full (models, g_object_unref);
+
+  return query_results;
+}
+
+static void
+query_task (GTask *task,
+            gpointer source_object,
+            gpointer task_data,
+            GCancellable *cancellable)
+{
+  RequestState *state = task_data;
+  DmDomain *self = source_object;
+  GError *error = NULL;
+
+  if (g_task_return_error_if_cancelled (task))
+    return;
+
+  g_autoptr(QueryResultsEntry) entry = dm_domain_lookup_query (self, state->query,
+                                                               state->fix_query,
+                                                               &error);
+  if (entry == NULL)
+    {
+      g_task_return_error (task, error);
+      return;
+    }
+
+  DmQueryResults *query_results = dm_domain_load_query_results (self, state->query,
+                                                                entry, cancellable,
+                                                                &error);
+  if (query_results == NULL)
+    {
+      g_task_return_error (task, error);
+      return;
+    }
+
   g_task_return_pointer (task, query_results, g_object_unref);
 }
 
@@ -875,6 +1665,43 @@ dm_domain_query (DmDomain *self,
   g_object_unref (task);
 }
 
+/*< private >
+ * dm_domain_fix_and_query:
+ * @self: the domain
+ * @query: the query object, whose search terms will be fixed
+ * @cancellable: (allow-none): optional #GCancellable object, %NULL to ignore.
+ * @callback: (scope async): callback to call when the request is satisfied.
+ * @user_data: (closure): the data to pass to callback function.
+ *
+ * Like dm_domain_get_fixed_query() followed by dm_domain_query() on the
+ * fixed query, but done in a single worker thread round-trip, using the same
+ * database handle for both steps. Finish with dm_domain_query_finish().
+ */
+void
+dm_domain_fix_and_query (DmDomain *self,
+                         DmQuery *query,
+                         GCancellable *cancellable,
+                         GAsyncReadyCallback callback,
+                         gpointer user_data)
+{
+  g_return_if_fail (DM_IS_DOMAIN (self));
+  g_return_if_fail (DM_IS_QUERY (query));
+  g_return_if_fail (G_IS_CANCELLABLE (cancellable) || cancellable == NULL);
+
+  GTask *task = g_task_new (self, cancellable, callback, user_data);
+
+  RequestState *state = g_slice_new0 (RequestState);
+  state->domain = g_object_ref (self);
+  state->db_manager = g_object_ref (self->db_manager);
+  state->query = g_object_ref (query);
+  state->fix_query = TRUE;
+
+  g_task_set_task_data (task, state, request_state_free);
+
+  g_task_run_in_thread (task, query_task);
+  g_object_unref (task);
+}
+
 /**
  * dm_domain_query_finish:
  * @self: domain
@@ -897,6 +1724,155 @@ dm_domain_query_finish (DmDomain *self,
   return g_task_propagate_pointer (G_TASK (result), error);
 }
 
+typedef struct
+{
+  DmDomain *domain;
+  GCancellable *cancellable;
+
+  GPtrArray *queries;
+  QueryResultsEntry **entries;
+  GError **errors;
+} QueryBatch;
+
+static void
+lookup_query_for_batch_index (guint index,
+                              gpointer user_data)
+{
+  QueryBatch *batch = user_data;
+  DmQuery *query = g_ptr_array_index (batch->queries, index);
+
+  if (g_cancellable_set_error_if_cancelled (batch->cancellable, &batch->errors[index]))
+    return;
+
+  const char *search_terms = dm_query_get_search_terms (query);
+  gboolean fix_query = search_terms != NULL && *search_terms != '\0';
+
+  batch->entries[index] = dm_domain_lookup_query (batch->domain, query, fix_query,
+                                                  &batch->errors[index]);
+}
+
+static void
+query_batch_task (GTask *task,
+                  gpointer source_object,
+                  gpointer task_data,
+                  GCancellable *cancellable)
+{
+  DmDomain *self = source_object;
+  GPtrArray *queries = task_data;
+  GError *error = NULL;
+
+  if (g_task_return_error_if_cancelled (task))
+    return;
+
+  QueryBatch batch = {
+    .domain = self,
+    .cancellable = cancellable,
+    .queries = queries,
+    .entries = g_new0 (QueryResultsEntry *, queries->len),
+    .errors = g_new0 (GError *, queries->len),
+  };
+
+  /* Each query checks out its own database handle, so they can all run at
+   * the same time. Loading the models is parallel within each query
+   * already, so that part is done one query after the other. */
+  dm_utils_parallel_for (queries->len, lookup_query_for_batch_index, &batch);
+
+  g_autoptr(GPtrArray) results = g_ptr_array_new_full (queries->len, g_object_unref);
+
+  for (guint i = 0; i < queries->len; i++)
+    {
+      if (batch.errors[i] != NULL)
+        {
+          if (error == NULL)
+            error = batch.errors[i];
+          else
+            g_error_free (batch.errors[i]);
+          continue;
+        }
+
+      if (error == NULL)
+        {
+          DmQueryResults *query_results =
+            dm_domain_load_query_results (self, g_ptr_array_index (queries, i),
+                                          batch.entries[i], cancellable, &error);
+          if (query_results != NULL)
+            g_ptr_array_add (results, query_results);
+        }
+
+      query_results_entry_unref (batch.entries[i]);
+    }
+
+  g_free (batch.entries);
+  g_free (batch.errors);
+
+  if (error != NULL)
+    {
+      g_task_return_error (task, error);
+      return;
+    }
+
+  g_task_return_pointer (task, g_steal_pointer (&results),
+                         (GDestroyNotify) g_ptr_array_unref);
+}
+
+/*< private >
+ * dm_domain_query_batch:
+ * @self: the domain
+ * @queries: (element-type DmQuery): the query objects
+ * @cancellable: (allow-none): optional #GCancellable object, %NULL to ignore.
+ * @callback: (scope async): callback to call when the request is satisfied.
+ * @user_data: (closure): the data to pass to callback function.
+ *
+ * Asynchronously runs several queries in one worker thread round-trip. Queries
+ * with search terms have them fixed first, as dm_engine_query() does.
+ */
+void
+dm_domain_query_batch (DmDomain *self,
+                       GPtrArray *queries,
+                       GCancellable *cancellable,
+                       GAsyncReadyCallback callback,
+                       gpointer user_data)
+{
+  g_return_if_fail (DM_IS_DOMAIN (self));
+  g_return_if_fail (queries != NULL);
+  g_return_if_fail (G_IS_CANCELLABLE (cancellable) || cancellable == NULL);
+
+  GTask *task = g_task_new (self, cancellable, callback, user_data);
+
+  GPtrArray *queries_copy = g_ptr_array_new_full (queries->len, g_object_unref);
+  for (guint i = 0; i < queries->len; i++)
+    g_ptr_array_add (queries_copy, g_object_ref (g_ptr_array_index (queries, i)));
+
+  g_task_set_task_data (task, queries_copy, (GDestroyNotify) g_ptr_array_unref);
+
+  g_task_run_in_thread (task, query_batch_task);
+  g_object_unref (task);
+}
+
+/*< private >
+ * dm_domain_query_batch_finish:
+ * @self: domain
+ * @result: the #GAsyncResult that was provided to the callback.
+ * @error: #GError for error reporting.
+ *
+ * Finish a dm_domain_query_batch() call. If any of the queries failed, the
+ * first error in query order is returned.
+ *
+ * Returns: (transfer full) (element-type DmQueryResults): the results
+ *   objects, in the same order as the queries
+ */
+GPtrArray *
+dm_domain_query_batch_finish (DmDomain *self,
+                              GAsyncResult *result,
+                              GError **error)
+{
+  g_return_val_if_fail (DM_IS_DOMAIN (self), NULL);
+  g_return_val_if_fail (G_IS_TASK (result), NULL);
+  g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+  return g_task_propagate_pointer (G_TASK (result), error);
+}
+
 /**
  * dm_domain_read_uri:
  * @self: domain
@@ -931,21 +1907,17 @@ dm_domain_read_uri (DmDomain *self,
       return TRUE;
     }
 
-  DmContent *model = dm_shard_get_model (dm_shard_record_get_shard (record),
-                                         record, NULL, NULL);
-  if (model)
-    g_object_get (model, "content-type", *mime_type, NULL);
+  if (mime_type)
+    {
+      g_autoptr(DmContent) model = dm_domain_get_object_sync (self, uri, NULL, NULL, NULL);
+      if (model)
+        g_object_get (model, "content-type", (char **) mime_type, NULL);
+    }
 
   if (bytes)
     {
-      g_autoptr(GInputStream) stream = dm_shard_stream_data (dm_shard_record_get_shard (record),
-                                                             record, NULL, &internal_error);
-      if (!internal_error)
-        {
-          gsize size = dm_shard_get_data_size (dm_shard_record_get_shard (record), record);
-          *bytes = g_input_stream_read_bytes (stream, size, NULL, &internal_error);
-        }
-
+      *bytes = dm_shard_get_data_bytes (dm_shard_record_get_shard (record),
+                                        record, NULL, &internal_error);
       if (internal_error)
         {
           g_propagate_error (error, internal_error);
@@ -113,4 +113,28 @@ dm_domain_query_finish (DmDomain *self,
                         GAsyncResult *result,
                         GError **error);
 
+DM_AVAILABLE_IN_0_2
+void
+dm_domain_get_model_cache_stats (DmDomain *self,
+                                 guint64 *hits,
+                                 guint64 *misses);
+
+DM_AVAILABLE_IN_0_2
+void
+dm_domain_get_spelling_cache_stats (DmDomain *self,
+                                    guint64 *hits,
+                                    guint64 *misses);
+
+DM_AVAILABLE_IN_0_2
+void
+dm_domain_get_zim_cache_stats (DmDomain *self,
+                               guint64 *hits,
+                               guint64 *misses);
+
+DM_AVAILABLE_IN_0_2
+void
+dm_domain_get_zim_redirect_cache_stats (DmDomain *self,
+                                        guint64 *hits,
+                                        guint64 *misses);
+
 G_END_DECLS
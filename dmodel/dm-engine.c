@@ -24,6 +24,8 @@ struct _DmEngine
 
   // Hash table with app id string keys, DmDomain values
   GHashTable *domains;
+  // App id string => GPtrArray of GTask waiting for the domain to load
+  GHashTable *loading_domains;
 };
 
 G_DEFINE_TYPE (DmEngine, dm_engine, G_TYPE_OBJECT)
@@ -93,6 +95,7 @@ dm_engine_finalize (GObject *object)
   g_clear_pointer (&self->default_app_id, g_free);
   g_clear_pointer (&self->language, g_free);
   g_clear_pointer (&self->domains, g_hash_table_unref);
+  g_clear_pointer (&self->loading_domains, g_hash_table_unref);
 
   G_OBJECT_CLASS (dm_engine_parent_class)->finalize (object);
 }
@@ -136,6 +139,8 @@ static void
 dm_engine_init (DmEngine *self)
 {
   self->domains = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_object_unref);
+  self->loading_domains = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+                                                 (GDestroyNotify) g_ptr_array_unref);
 }
 
 /**
@@ -255,6 +260,28 @@ on_domain_object_finished (GObject *source,
   g_task_return_pointer (task, model, g_object_unref);
 }
 
+static void
+on_domain_loaded_for_object (GObject *source,
+                             GAsyncResult *result,
+                             gpointer user_data)
+{
+  DmEngine *self = DM_ENGINE (source);
+  g_autoptr(GTask) task = user_data;
+  GCancellable *cancellable = g_task_get_cancellable (task);
+  const char *id = g_task_get_task_data (task);
+  GError *error = NULL;
+
+  g_autoptr(DmDomain) domain = NULL;
+  if (!(domain = dm_engine_get_domain_for_app_finish (self, result, &error)))
+    {
+      g_task_return_error (task, error);
+      return;
+    }
+
+  dm_domain_get_object (domain, id, cancellable, on_domain_object_finished,
+                        g_steal_pointer (&task));
+}
+
 /**
  * dm_engine_get_object_for_app:
  * @self: the engine
@@ -280,11 +307,14 @@ dm_engine_get_object_for_app (DmEngine *self,
   g_return_if_fail (app_id && *app_id);
 
   g_autoptr(GTask) task = g_task_new (self, cancellable, callback, user_data);
-  GError *error = NULL;
-  DmDomain *domain;
-  if (!(domain = dm_engine_get_domain_for_app (self, app_id, &error)))
+  g_task_set_task_data (task, g_strdup (id), g_free);
+
+  DmDomain *domain = g_hash_table_lookup (self->domains, app_id);
+  if (domain == NULL)
     {
-      g_task_return_error (task, error);
+      dm_engine_get_domain_for_app_async (self, app_id, cancellable,
+                                          on_domain_loaded_for_object,
+                                          g_steal_pointer (&task));
       return;
     }
 
@@ -333,25 +363,59 @@ on_domain_query_finished (GObject *source,
   g_task_return_pointer (task, results, g_object_unref);
 }
 
+/* Runs the query in the task data of @task against @domain, and returns
+ * the results from @task, taking ownership of it */
 static void
-on_query_fixed_finished (GObject *source,
-                         GAsyncResult *result,
-                         gpointer user_data)
+query_domain (DmDomain *domain,
+              GTask *task)
 {
-  DmDomain *domain = DM_DOMAIN (source);
-  g_autoptr(GTask) task = user_data;
   GCancellable *cancellable = g_task_get_cancellable (task);
+  DmQuery *query = g_task_get_task_data (task);
+
+  const char *search_terms = dm_query_get_search_terms (query);
+  if (search_terms  != NULL && *search_terms != '\0')
+    {
+      dm_domain_fix_and_query (domain, query, cancellable,
+                               on_domain_query_finished, task);
+      return;
+    }
+
+  /* We're searching for tags without a query string. */
+  dm_domain_query (domain, query, cancellable, on_domain_query_finished, task);
+}
+
+static void
+on_domain_loaded_for_query (GObject *source,
+                            GAsyncResult *result,
+                            gpointer user_data)
+{
+  DmEngine *self = DM_ENGINE (source);
+  g_autoptr(GTask) task = user_data;
   GError *error = NULL;
 
-  g_autoptr(DmQuery) query = NULL;
-  if (!(query = dm_domain_get_fixed_query_finish (domain, result, &error)))
+  g_autoptr(DmDomain) domain = NULL;
+  if (!(domain = dm_engine_get_domain_for_app_finish (self, result, &error)))
     {
       g_task_return_error (task, error);
       return;
     }
 
-  dm_domain_query (domain, query, cancellable, on_domain_query_finished,
-                   g_steal_pointer (&task));
+  query_domain (domain, g_steal_pointer (&task));
+}
+
+/* Gets the app ID of the domain that @query should run against */
+static char *
+dm_engine_get_app_id_for_query (DmEngine *self,
+                                DmQuery *query)
+{
+  g_autofree char *query_app_id = NULL;
+  g_object_get (G_OBJECT (query),
+                "app_id", &query_app_id,
+                NULL);
+  if (query_app_id && *query_app_id)
+    return g_steal_pointer (&query_app_id);
+
+  return g_strdup (self->default_app_id);
 }
 
 /**
@@ -376,36 +440,23 @@ dm_engine_query (DmEngine *self,
   g_return_if_fail (DM_IS_QUERY (query));
   g_return_if_fail (G_IS_CANCELLABLE (cancellable) || cancellable == NULL);
 
-  g_autofree gchar *query_app_id = NULL;
-  g_object_get (G_OBJECT (query),
-                "app_id", &query_app_id,
-                NULL);
-  gchar *app_id = self->default_app_id;
-  if (query_app_id && *query_app_id)
-    app_id = query_app_id;
+  g_autofree char *app_id = dm_engine_get_app_id_for_query (self, query);
 
   g_return_if_fail (app_id && *app_id);
 
   g_autoptr(GTask) task = g_task_new (self, cancellable, callback, user_data);
-  GError *error = NULL;
-  DmDomain *domain;
-  if (!(domain = dm_engine_get_domain_for_app (self, app_id, &error)))
-    {
-      g_task_return_error (task, error);
-      return;
-    }
+  g_task_set_task_data (task, g_object_ref (query), g_object_unref);
 
-  const char *search_terms = dm_query_get_search_terms (query);
-  if (search_terms  != NULL && *search_terms != '\0')
+  DmDomain *domain = g_hash_table_lookup (self->domains, app_id);
+  if (domain == NULL)
     {
-      dm_domain_get_fixed_query (domain, query, cancellable,
-                                 on_query_fixed_finished, g_steal_pointer (&task));
+      dm_engine_get_domain_for_app_async (self, app_id, cancellable,
+                                          on_domain_loaded_for_query,
+                                          g_steal_pointer (&task));
       return;
     }
 
-  /* We're searching for tags without a query string. */
-  dm_domain_query (domain, query, cancellable, on_domain_query_finished,
-                   g_steal_pointer (&task));
+  query_domain (domain, g_steal_pointer (&task));
 }
 
 /**
@@ -431,6 +482,299 @@ dm_engine_query_finish (DmEngine *self,
   return g_task_propagate_pointer (G_TASK (result), error);
 }
 
+typedef struct
+{
+  /* in the same order as the queries */
+  DmQuery **queries;
+  char **app_ids;
+  DmQueryResults **results;
+  guint n_queries;
+
+  /* number of domains that have not finished loading, or whose queries have
+   * not finished yet */
+  guint n_pending;
+  GError *error;
+} QueryBatchState;
+
+static void
+query_batch_state_free (gpointer data)
+{
+  QueryBatchState *state = data;
+
+  for (guint i = 0; i < state->n_queries; i++)
+    {
+      g_clear_object (&state->queries[i]);
+      g_clear_object (&state->results[i]);
+    }
+  g_free (state->queries);
+  g_strfreev (state->app_ids);
+  g_free (state->results);
+  g_clear_error (&state->error);
+
+  g_slice_free (QueryBatchState, state);
+}
+
+/* The queries of a batch that go to the same domain */
+typedef struct
+{
+  GTask *task;
+
+  GPtrArray *queries;
+  /* guint, the position in the batch of each query */
+  GArray *indices;
+} DomainBatch;
+
+static DomainBatch *
+domain_batch_new (GTask *task)
+{
+  DomainBatch *batch = g_slice_new0 (DomainBatch);
+
+  batch->task = g_object_ref (task);
+  batch->queries = g_ptr_array_new_with_free_func (g_object_unref);
+  batch->indices = g_array_new (FALSE, FALSE, sizeof (guint));
+
+  return batch;
+}
+
+static void
+domain_batch_free (gpointer data)
+{
+  DomainBatch *batch = data;
+
+  g_object_unref (batch->task);
+  g_ptr_array_unref (batch->queries);
+  g_array_unref (batch->indices);
+
+  g_slice_free (DomainBatch, batch);
+}
+
+static void
+on_domain_query_batch_finished (GObject *source,
+                                GAsyncResult *result,
+                                gpointer user_data)
+{
+  DmDomain *domain = DM_DOMAIN (source);
+  DomainBatch *batch = user_data;
+  g_autoptr(GTask) task = g_object_ref (batch->task);
+  QueryBatchState *state = g_task_get_task_data (task);
+  GError *error = NULL;
+
+  g_autoptr(GPtrArray) results = dm_domain_query_batch_finish (domain, result, &error);
+  if (results == NULL)
+    {
+      if (state->error == NULL)
+        state->error = error;
+      else
+        g_error_free (error);
+    }
+  else
+    {
+      for (guint i = 0; i < results->len; i++)
+        {
+          guint index = g_array_index (batch->indices, guint, i);
+          state->results[index] = g_object_ref (g_ptr_array_index (results, i));
+        }
+    }
+
+  domain_batch_free (batch);
+
+  if (--state->n_pending > 0)
+    return;
+
+  if (state->error != NULL)
+    {
+      g_task_return_error (task, g_steal_pointer (&state->error));
+      return;
+    }
+
+  GPtrArray *all_results = g_ptr_array_new_full (state->n_queries, g_object_unref);
+  for (guint i = 0; i < state->n_queries; i++)
+    g_ptr_array_add (all_results, g_steal_pointer (&state->results[i]));
+
+  g_task_return_pointer (task, all_results, (GDestroyNotify) g_ptr_array_unref);
+}
+
+/* Sends the queries of the batch in @task to their domains, which must all be
+ * loaded, and takes ownership of @task */
+static void
+query_batch_dispatch (DmEngine *self,
+                      GTask *task)
+{
+  g_autoptr(GTask) owned_task = task;
+  QueryBatchState *state = g_task_get_task_data (task);
+  GCancellable *cancellable = g_task_get_cancellable (task);
+
+  /* DmDomain => DomainBatch */
+  g_autoptr(GHashTable) batches = g_hash_table_new_full (NULL, NULL, NULL,
+                                                         domain_batch_free);
+
+  for (guint i = 0; i < state->n_queries; i++)
+    {
+      DmDomain *domain = g_hash_table_lookup (self->domains, state->app_ids[i]);
+      g_assert (domain != NULL);
+
+      DomainBatch *batch = g_hash_table_lookup (batches, domain);
+      if (batch == NULL)
+        {
+          batch = domain_batch_new (task);
+          g_hash_table_insert (batches, domain, batch);
+        }
+
+      g_ptr_array_add (batch->queries, g_object_ref (state->queries[i]));
+      g_array_append_val (batch->indices, i);
+    }
+
+  state->n_pending = g_hash_table_size (batches);
+
+  GHashTableIter iter;
+  gpointer domain, batch;
+  g_hash_table_iter_init (&iter, batches);
+  while (g_hash_table_iter_next (&iter, &domain, &batch))
+    {
+      g_hash_table_iter_steal (&iter);
+      dm_domain_query_batch (domain, ((DomainBatch *) batch)->queries, cancellable,
+                             on_domain_query_batch_finished, batch);
+    }
+}
+
+static void
+on_domain_loaded_for_batch (GObject *source,
+                            GAsyncResult *result,
+                            gpointer user_data)
+{
+  DmEngine *self = DM_ENGINE (source);
+  g_autoptr(GTask) task = user_data;
+  QueryBatchState *state = g_task_get_task_data (task);
+  GError *error = NULL;
+
+  g_autoptr(DmDomain) domain = dm_engine_get_domain_for_app_finish (self, result, &error);
+  if (domain == NULL)
+    {
+      if (state->error == NULL)
+        state->error = error;
+      else
+        g_error_free (error);
+    }
+
+  if (--state->n_pending > 0)
+    return;
+
+  if (state->error != NULL)
+    {
+      g_task_return_error (task, g_steal_pointer (&state->error));
+      return;
+    }
+
+  query_batch_dispatch (self, g_steal_pointer (&task));
+}
+
+/**
+ * dm_engine_query_batch:
+ * @self: the engine
+ * @queries: (array length=n_queries): the query objects
+ * @n_queries: the number of queries
+ * @cancellable: (allow-none): optional #GCancellable object, %NULL to ignore.
+ * @callback: (scope async): callback to call when the request is satisfied.
+ * @user_data: (closure): the data to pass to callback function.
+ *
+ * Asynchronously runs several queries at once, as dm_engine_query() would run
+ * each of them. This is cheaper than making the calls one by one: the
+ * queries for each domain are run together, in parallel, in a single worker
+ * thread round-trip.
+ *
+ * Since: 0.2
+ */
+void
+dm_engine_query_batch (DmEngine *self,
+                       DmQuery **queries,
+                       guint n_queries,
+                       GCancellable *cancellable,
+                       GAsyncReadyCallback callback,
+                       gpointer user_data)
+{
+  g_return_if_fail (DM_IS_ENGINE (self));
+  g_return_if_fail (queries != NULL || n_queries == 0);
+  g_return_if_fail (G_IS_CANCELLABLE (cancellable) || cancellable == NULL);
+
+  g_auto(GStrv) app_ids = g_new0 (char *, n_queries + 1);
+  for (guint i = 0; i < n_queries; i++)
+    {
+      g_return_if_fail (DM_IS_QUERY (queries[i]));
+
+      app_ids[i] = dm_engine_get_app_id_for_query (self, queries[i]);
+
+      g_return_if_fail (app_ids[i] && *app_ids[i]);
+    }
+
+  g_autoptr(GTask) task = g_task_new (self, cancellable, callback, user_data);
+
+  QueryBatchState *state = g_slice_new0 (QueryBatchState);
+  state->queries = g_new0 (DmQuery *, n_queries);
+  for (guint i = 0; i < n_queries; i++)
+    state->queries[i] = g_object_ref (queries[i]);
+  state->app_ids = g_steal_pointer (&app_ids);
+  state->results = g_new0 (DmQueryResults *, n_queries);
+  state->n_queries = n_queries;
+  g_task_set_task_data (task, state, query_batch_state_free);
+
+  if (n_queries == 0)
+    {
+      g_task_return_pointer (task, g_ptr_array_new_with_free_func (g_object_unref),
+                             (GDestroyNotify) g_ptr_array_unref);
+      return;
+    }
+
+  /* Load the domains that are not loaded yet first, without blocking */
+  g_autoptr(GHashTable) to_load = g_hash_table_new (g_str_hash, g_str_equal);
+  for (guint i = 0; i < n_queries; i++)
+    {
+      if (!g_hash_table_contains (self->domains, state->app_ids[i]))
+        g_hash_table_add (to_load, state->app_ids[i]);
+    }
+
+  if (g_hash_table_size (to_load) == 0)
+    {
+      query_batch_dispatch (self, g_steal_pointer (&task));
+      return;
+    }
+
+  state->n_pending = g_hash_table_size (to_load);
+
+  GHashTableIter iter;
+  gpointer app_id;
+  g_hash_table_iter_init (&iter, to_load);
+  while (g_hash_table_iter_next (&iter, &app_id, NULL))
+    dm_engine_get_domain_for_app_async (self, app_id, cancellable,
+                                        on_domain_loaded_for_batch,
+                                        g_object_ref (task));
+}
+
+/**
+ * dm_engine_query_batch_finish:
+ * @self: the engine
+ * @result: the #GAsyncResult that was provided to the callback.
+ * @error: #GError for error reporting.
+ *
+ * Finishes a call to dm_engine_query_batch(). If any of the queries failed,
+ * an error is thrown and no results are returned.
+ *
+ * Returns: (transfer full) (element-type DmQueryResults): the results
+ *   objects, in the same order as the queries
+ *
+ * Since: 0.2
+ */
+GPtrArray *
+dm_engine_query_batch_finish (DmEngine *self,
+                              GAsyncResult *result,
+                              GError **error)
+{
+  g_return_val_if_fail (DM_IS_ENGINE (self), NULL);
+  g_return_val_if_fail (G_IS_TASK (result), NULL);
+  g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+  return g_task_propagate_pointer (G_TASK (result), error);
+}
+
 /**
  * dm_engine_get_domain:
  * @self: the engine
@@ -492,6 +836,151 @@ dm_engine_get_domain_for_app (DmEngine *self,
   return domain;
 }
 
+static void
+load_domain_task (GTask *task,
+                  G_GNUC_UNUSED gpointer source_object,
+                  gpointer task_data,
+                  G_GNUC_UNUSED GCancellable *cancellable)
+{
+  char **app_id_and_language = task_data;
+  GError *error = NULL;
+
+  DmDomain *domain = dm_domain_get_for_app_id (app_id_and_language[0], NULL,
+                                               app_id_and_language[1],
+                                               NULL, &error);
+  if (domain == NULL)
+    {
+      g_task_return_error (task, error);
+      return;
+    }
+
+  g_task_return_pointer (task, domain, g_object_unref);
+}
+
+static void
+on_domain_loaded (GObject *source,
+                  GAsyncResult *result,
+                  gpointer user_data)
+{
+  DmEngine *self = DM_ENGINE (source);
+  g_autofree char *app_id = user_data;
+  g_autoptr(GError) error = NULL;
+
+  g_autoptr(GPtrArray) waiters = NULL;
+  g_hash_table_steal_extended (self->loading_domains, app_id, NULL,
+                               (gpointer *) &waiters);
+  g_assert (waiters != NULL);
+
+  g_autoptr(DmDomain) domain = g_task_propagate_pointer (G_TASK (result), &error);
+  if (domain != NULL)
+    {
+      /* The domain may have been loaded synchronously in the meantime, in
+       * which case that one wins, so that there is only ever one domain per
+       * app id */
+      DmDomain *existing = g_hash_table_lookup (self->domains, app_id);
+      if (existing != NULL)
+        g_set_object (&domain, existing);
+      else
+        g_hash_table_insert (self->domains, g_strdup (app_id), g_object_ref (domain));
+    }
+
+  for (guint i = 0; i < waiters->len; i++)
+    {
+      GTask *waiter = g_ptr_array_index (waiters, i);
+
+      if (domain != NULL)
+        g_task_return_pointer (waiter, g_object_ref (domain), g_object_unref);
+      else
+        g_task_return_error (waiter, g_error_copy (error));
+    }
+}
+
+/**
+ * dm_engine_get_domain_for_app_async:
+ * @self: the engine
+ * @app_id: the id of the application to load the object from
+ * @cancellable: (allow-none): optional #GCancellable object, %NULL to ignore.
+ * @callback: (scope async): callback to call when the request is satisfied.
+ * @user_data: (closure): the data to pass to callback function.
+ *
+ * Asynchronously gets a #DmDomain object for a given app id, like
+ * dm_engine_get_domain_for_app(), but creating the domain in a worker
+ * thread if none exists yet.
+ *
+ * Concurrent requests for the same app id share a single load. If
+ * @cancellable is cancelled, this request fails with %G_IO_ERROR_CANCELLED
+ * when the shared load finishes, which carries on for any other requests.
+ *
+ * Since: 0.2
+ */
+void
+dm_engine_get_domain_for_app_async (DmEngine *self,
+                                    const char *app_id,
+                                    GCancellable *cancellable,
+                                    GAsyncReadyCallback callback,
+                                    gpointer user_data)
+{
+  g_return_if_fail (DM_IS_ENGINE (self));
+  g_return_if_fail (app_id && *app_id);
+  g_return_if_fail (G_IS_CANCELLABLE (cancellable) || cancellable == NULL);
+
+  g_autoptr(GTask) task = g_task_new (self, cancellable, callback, user_data);
+  g_task_set_source_tag (task, dm_engine_get_domain_for_app_async);
+
+  DmDomain *domain = g_hash_table_lookup (self->domains, app_id);
+  if (domain != NULL)
+    {
+      g_task_return_pointer (task, g_object_ref (domain), g_object_unref);
+      return;
+    }
+
+  GPtrArray *waiters = g_hash_table_lookup (self->loading_domains, app_id);
+  if (waiters != NULL)
+    {
+      g_ptr_array_add (waiters, g_steal_pointer (&task));
+      return;
+    }
+
+  waiters = g_ptr_array_new_with_free_func (g_object_unref);
+  g_ptr_array_add (waiters, g_steal_pointer (&task));
+  g_hash_table_insert (self->loading_domains, g_strdup (app_id), waiters);
+
+  /* The load is not tied to any one request's cancellable, since others may
+   * be waiting for it */
+  g_autoptr(GTask) load_task = g_task_new (self, NULL, on_domain_loaded,
+                                           g_strdup (app_id));
+  char **app_id_and_language = g_new0 (char *, 3);
+  app_id_and_language[0] = g_strdup (app_id);
+  app_id_and_language[1] = g_strdup (self->language);
+  g_task_set_task_data (load_task, app_id_and_language, (GDestroyNotify) g_strfreev);
+
+  g_task_run_in_thread (load_task, load_domain_task);
+}
+
+/**
+ * dm_engine_get_domain_for_app_finish:
+ * @self: the engine
+ * @result: the #GAsyncResult that was provided to the callback.
+ * @error: #GError for error reporting.
+ *
+ * Finish a dm_engine_get_domain_for_app_async() call.
+ *
+ * Returns: (transfer full): the domain
+ *
+ * Since: 0.2
+ */
+DmDomain *
+dm_engine_get_domain_for_app_finish (DmEngine *self,
+                                     GAsyncResult *result,
+                                     GError **error)
+{
+  g_return_val_if_fail (DM_IS_ENGINE (self), NULL);
+  g_return_val_if_fail (g_task_is_valid (result, self), NULL);
+  g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+  return g_task_propagate_pointer (G_TASK (result), error);
+}
+
 /**
  * dm_engine_add_domain_for_path:
  * @self: the engine
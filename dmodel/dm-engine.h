@@ -71,6 +71,21 @@ dm_engine_query_finish (DmEngine *self,
                         GAsyncResult *result,
                         GError **error);
 
+DM_AVAILABLE_IN_0_2
+void
+dm_engine_query_batch (DmEngine *self,
+                       DmQuery **queries,
+                       guint n_queries,
+                       GCancellable *cancellable,
+                       GAsyncReadyCallback callback,
+                       gpointer user_data);
+
+DM_AVAILABLE_IN_0_2
+GPtrArray *
+dm_engine_query_batch_finish (DmEngine *self,
+                              GAsyncResult *result,
+                              GError **error);
+
 DM_AVAILABLE_IN_ALL
 DmDomain *
 dm_engine_get_domain (DmEngine *self,
@@ -82,6 +97,20 @@ dm_engine_get_domain_for_app (DmEngine *self,
                               const char *app_id,
                               GError **error);
 
+DM_AVAILABLE_IN_0_2
+void
+dm_engine_get_domain_for_app_async (DmEngine *self,
+                                    const char *app_id,
+                                    GCancellable *cancellable,
+                                    GAsyncReadyCallback callback,
+                                    gpointer user_data);
+
+DM_AVAILABLE_IN_0_2
+DmDomain *
+dm_engine_get_domain_for_app_finish (DmEngine *self,
+                                     GAsyncResult *result,
+                                     GError **error);
+
 DM_AVAILABLE_IN_ALL
 void
 dm_engine_add_domain_for_path (DmEngine *self,
@@ -40,13 +40,6 @@ dm_image_new_from_json_node (JsonNode *node)
 {
   g_autoptr(EosProfileProbe) probe = EOS_PROFILE_PROBE ("/dmodel/object/image");
 
-G_GNUC_BEGIN_IGNORE_DEPRECATIONS
-  GArray *params = g_array_new (FALSE, TRUE, sizeof (GParameter));
-  dm_media_add_json_to_params (node, params);
-  DmImage *model = g_object_newv (DM_TYPE_IMAGE, params->len,
-                                  (GParameter *)params->data);
-  dm_utils_free_gparam_array (params);
-G_GNUC_END_IGNORE_DEPRECATIONS
-
-  return DM_CONTENT (model);
+  return dm_utils_new_model_from_json_node (DM_TYPE_IMAGE,
+                                            &dm_media_json_fields, node);
 }
@@ -0,0 +1,37 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+
+/* Copyright 2020 Endless Mobile, Inc. */
+
+#pragma once
+
+#include "dm-utils-private.h"
+
+G_BEGIN_DECLS
+
+typedef struct _DmJsonPending DmJsonPending;
+
+void
+dm_json_pending_free (DmJsonPending *pending);
+
+void
+dm_json_pending_resolve (DmJsonPending *pending,
+                         gpointer model);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (DmJsonPending, dm_json_pending_free)
+
+gboolean
+dm_json_reader_get_strings (const char *data,
+                            gsize length,
+                            const char * const *keys,
+                            char **values,
+                            GError **error);
+
+gboolean
+dm_json_reader_fill_model (GBytes *bytes,
+                           gpointer model,
+                           const DmJsonFieldTable *table,
+                           const char * const *properties,
+                           DmJsonPending **pending_out,
+                           GError **error);
+
+G_END_DECLS
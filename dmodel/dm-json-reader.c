@@ -0,0 +1,1008 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+
+/* Copyright 2020 Endless Mobile, Inc. */
+
+#include "dm-json-reader-private.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* A minimal pull parser for the JSON metadata stored in shards.
+ *
+ * Building a JsonNode tree for a record costs an allocation for every member,
+ * array element and string in it, and nearly all of them are thrown away as
+ * soon as the model is built. Instead, this walks the top level object of the
+ * metadata once, decoding the members that map to model fields straight into
+ * the model's private structs and stepping over everything else without
+ * allocating. Only values that end up as a tree anyway, such as
+ * DmContent:discovery-feed-content, are handed over to json-glib, and then
+ * just their own slice of the text.
+ */
+
+typedef struct
+{
+  const char *start;
+  const char *pos;
+  const char *end;
+  /* Decoded contents of the last string read */
+  GString *buffer;
+} DmJsonReader;
+
+typedef enum
+{
+  SCALAR_STRING,
+  SCALAR_INT,
+  SCALAR_DOUBLE,
+  SCALAR_BOOLEAN,
+  SCALAR_NULL,
+} ScalarType;
+
+/* A lazy field whose value was stepped over, to be decoded later from its
+ * slice of the metadata.
+ */
+typedef struct
+{
+  const DmJsonFieldTable *table;
+  const DmJsonField *field;
+  gsize offset;
+  gsize length;
+} PendingValue;
+
+struct _DmJsonPending
+{
+  GBytes *bytes;
+  GArray *values;
+};
+
+/* String values are left in the reader's buffer */
+typedef struct
+{
+  ScalarType type;
+  gint64 v_int;
+  gdouble v_double;
+  gboolean v_boolean;
+} Scalar;
+
+/* Characters that end a number or a literal */
+#define VALUE_DELIMITERS ",:{}[]\" \t\n\r"
+
+static void
+reader_init (DmJsonReader *reader,
+             const char *data,
+             gsize length)
+{
+  reader->start = data;
+  reader->pos = data;
+  reader->end = data + length;
+  reader->buffer = g_string_sized_new (64);
+}
+
+static void
+reader_clear (DmJsonReader *reader)
+{
+  g_string_free (reader->buffer, TRUE);
+}
+
+G_DEFINE_AUTO_CLEANUP_CLEAR_FUNC (DmJsonReader, reader_clear)
+
+static gboolean
+reader_error (DmJsonReader *reader,
+              GError **error,
+              const char *message)
+{
+  g_set_error (error, DM_CONTENT_ERROR, DM_CONTENT_ERROR_BAD_FORMAT,
+               "Malformed metadata JSON at offset %" G_GSIZE_FORMAT ": %s",
+               (gsize) (reader->pos - reader->start), message);
+  return FALSE;
+}
+
+static char
+reader_peek (DmJsonReader *reader)
+{
+  return reader->pos < reader->end ? *reader->pos : '\0';
+}
+
+static void
+reader_skip_whitespace (DmJsonReader *reader)
+{
+  while (reader->pos < reader->end &&
+         (*reader->pos == ' ' || *reader->pos == '\t' ||
+          *reader->pos == '\n' || *reader->pos == '\r'))
+    reader->pos++;
+}
+
+/* Skips whitespace, then consumes @c or fails */
+static gboolean
+reader_expect (DmJsonReader *reader,
+               char c,
+               GError **error)
+{
+  reader_skip_whitespace (reader);
+
+  if (reader_peek (reader) != c)
+    {
+      g_autofree char *message = g_strdup_printf ("expected '%c'", c);
+      return reader_error (reader, error, message);
+    }
+
+  reader->pos++;
+  return TRUE;
+}
+
+/* Skips whitespace, then consumes @c if it comes next */
+static gboolean
+reader_accept (DmJsonReader *reader,
+               char c)
+{
+  reader_skip_whitespace (reader);
+
+  if (reader_peek (reader) != c)
+    return FALSE;
+
+  reader->pos++;
+  return TRUE;
+}
+
+static gboolean
+reader_read_hex4 (DmJsonReader *reader,
+                  gunichar *out)
+{
+  if (reader->end - reader->pos < 4)
+    return FALSE;
+
+  gunichar value = 0;
+  for (int i = 0; i < 4; i++)
+    {
+      int digit = g_ascii_xdigit_value (reader->pos[i]);
+      if (digit < 0)
+        return FALSE;
+
+      value = (value << 4) | digit;
+    }
+
+  reader->pos += 4;
+  *out = value;
+  return TRUE;
+}
+
+static gboolean
+reader_read_escape (DmJsonReader *reader,
+                    GError **error)
+{
+  char escape = *reader->pos++;
+  gunichar c, low;
+
+  switch (escape)
+    {
+    case '"':
+    case '\\':
+    case '/':
+      g_string_append_c (reader->buffer, escape);
+      return TRUE;
+
+    case 'b':
+      g_string_append_c (reader->buffer, '\b');
+      return TRUE;
+
+    case 'f':
+      g_string_append_c (reader->buffer, '\f');
+      return TRUE;
+
+    case 'n':
+      g_string_append_c (reader->buffer, '\n');
+      return TRUE;
+
+    case 'r':
+      g_string_append_c (reader->buffer, '\r');
+      return TRUE;
+
+    case 't':
+      g_string_append_c (reader->buffer, '\t');
+      return TRUE;
+
+    case 'u':
+      if (!reader_read_hex4 (reader, &c))
+        return reader_error (reader, error, "invalid unicode escape");
+
+      if (c >= 0xdc00 && c < 0xe000)
+        return reader_error (reader, error, "unpaired surrogate");
+
+      if (c >= 0xd800 && c < 0xdc00)
+        {
+          if (reader->end - reader->pos < 2 ||
+              reader->pos[0] != '\\' || reader->pos[1] != 'u')
+            return reader_error (reader, error, "unpaired surrogate");
+
+          reader->pos += 2;
+          if (!reader_read_hex4 (reader, &low) || low < 0xdc00 || low >= 0xe000)
+            return reader_error (reader, error, "invalid surrogate pair");
+
+          c = 0x10000 + ((c - 0xd800) << 10) + (low - 0xdc00);
+        }
+
+      g_string_append_unichar (reader->buffer, c);
+      return TRUE;
+
+    default:
+      reader->pos--;
+      return reader_error (reader, error, "invalid escape");
+    }
+}
+
+/* Skips whitespace, then reads a string into reader->buffer */
+static gboolean
+reader_read_string (DmJsonReader *reader,
+                    GError **error)
+{
+  if (!reader_expect (reader, '"', error))
+    return FALSE;
+
+  g_string_truncate (reader->buffer, 0);
+
+  for (;;)
+    {
+      const char *run = reader->pos;
+      while (reader->pos < reader->end &&
+             *reader->pos != '"' && *reader->pos != '\\')
+        reader->pos++;
+
+      g_string_append_len (reader->buffer, run, reader->pos - run);
+
+      if (reader->pos >= reader->end)
+        return reader_error (reader, error, "unterminated string");
+
+      if (*reader->pos++ == '"')
+        return TRUE;
+
+      if (reader->pos >= reader->end)
+        return reader_error (reader, error, "unterminated string");
+
+      if (!reader_read_escape (reader, error))
+        return FALSE;
+    }
+}
+
+static gboolean
+reader_skip_string (DmJsonReader *reader,
+                    GError **error)
+{
+  /* Step over the opening quote */
+  reader->pos++;
+
+  while (reader->pos < reader->end)
+    {
+      char c = *reader->pos++;
+
+      if (c == '"')
+        return TRUE;
+      if (c == '\\')
+        reader->pos++;
+    }
+
+  reader->pos = reader->end;
+  return reader_error (reader, error, "unterminated string");
+}
+
+/* Consumes a number or a literal, returning its length */
+static gsize
+reader_skip_bare_value (DmJsonReader *reader)
+{
+  const char *start = reader->pos;
+
+  while (reader->pos < reader->end && strchr (VALUE_DELIMITERS, *reader->pos) == NULL)
+    reader->pos++;
+
+  return reader->pos - start;
+}
+
+/* Skips whitespace, then steps over a value of any kind. Containers are only
+ * checked for balanced brackets, which is all we need to find their end.
+ */
+static gboolean
+reader_skip_value (DmJsonReader *reader,
+                   GError **error)
+{
+  reader_skip_whitespace (reader);
+
+  char c = reader_peek (reader);
+
+  if (c == '"')
+    return reader_skip_string (reader, error);
+
+  if (c == '{' || c == '[')
+    {
+      guint depth = 0;
+
+      while (reader->pos < reader->end)
+        {
+          c = *reader->pos;
+
+          if (c == '"')
+            {
+              if (!reader_skip_string (reader, error))
+                return FALSE;
+              continue;
+            }
+
+          reader->pos++;
+
+          if (c == '{' || c == '[')
+            depth++;
+          else if ((c == '}' || c == ']') && --depth == 0)
+            return TRUE;
+        }
+
+      return reader_error (reader, error, "unterminated container");
+    }
+
+  if (reader_skip_bare_value (reader) == 0)
+    return reader_error (reader, error, "expected a value");
+
+  return TRUE;
+}
+
+/* Skips whitespace, then reads a value which must not be a container */
+static gboolean
+reader_read_scalar (DmJsonReader *reader,
+                    Scalar *scalar,
+                    GError **error)
+{
+  reader_skip_whitespace (reader);
+
+  if (reader_peek (reader) == '"')
+    {
+      scalar->type = SCALAR_STRING;
+      return reader_read_string (reader, error);
+    }
+
+  const char *start = reader->pos;
+  gsize length = reader_skip_bare_value (reader);
+
+  if (length == 4 && memcmp (start, "true", 4) == 0)
+    {
+      scalar->type = SCALAR_BOOLEAN;
+      scalar->v_boolean = TRUE;
+      return TRUE;
+    }
+
+  if (length == 5 && memcmp (start, "false", 5) == 0)
+    {
+      scalar->type = SCALAR_BOOLEAN;
+      scalar->v_boolean = FALSE;
+      return TRUE;
+    }
+
+  if (length == 4 && memcmp (start, "null", 4) == 0)
+    {
+      scalar->type = SCALAR_NULL;
+      return TRUE;
+    }
+
+  char number[64];
+  char *number_end = NULL;
+
+  if (length > 0 && length < sizeof (number) &&
+      (*start == '-' || g_ascii_isdigit (*start)))
+    {
+      memcpy (number, start, length);
+      number[length] = '\0';
+
+      if (strpbrk (number, ".eE") == NULL)
+        {
+          scalar->type = SCALAR_INT;
+          scalar->v_int = g_ascii_strtoll (number, &number_end, 10);
+        }
+      else
+        {
+          scalar->type = SCALAR_DOUBLE;
+          scalar->v_double = g_ascii_strtod (number, &number_end);
+        }
+    }
+
+  if (number_end == NULL || *number_end != '\0')
+    {
+      reader->pos = start;
+      return reader_error (reader, error, "expected a value");
+    }
+
+  return TRUE;
+}
+
+static JsonNode *
+scalar_to_node (DmJsonReader *reader,
+                const Scalar *scalar)
+{
+  JsonNode *node = json_node_alloc ();
+
+  switch (scalar->type)
+    {
+    case SCALAR_STRING:
+      return json_node_init_string (node, reader->buffer->str);
+
+    case SCALAR_INT:
+      return json_node_init_int (node, scalar->v_int);
+
+    case SCALAR_DOUBLE:
+      return json_node_init_double (node, scalar->v_double);
+
+    case SCALAR_BOOLEAN:
+      return json_node_init_boolean (node, scalar->v_boolean);
+
+    case SCALAR_NULL:
+      return json_node_init_null (node);
+
+    default:
+      g_assert_not_reached ();
+    }
+}
+
+/* Reads a value of any kind as a JsonNode. Containers are parsed by
+ * json-glib from their own slice of the text.
+ */
+static JsonNode *
+reader_read_node (DmJsonReader *reader,
+                  GError **error)
+{
+  reader_skip_whitespace (reader);
+
+  char c = reader_peek (reader);
+
+  if (c != '{' && c != '[')
+    {
+      Scalar scalar;
+
+      if (!reader_read_scalar (reader, &scalar, error))
+        return NULL;
+
+      return scalar_to_node (reader, &scalar);
+    }
+
+  const char *start = reader->pos;
+
+  if (!reader_skip_value (reader, error))
+    return NULL;
+
+  g_autoptr(JsonParser) parser = json_parser_new_immutable ();
+  if (!json_parser_load_from_data (parser, start, reader->pos - start, error))
+    return NULL;
+
+  return json_node_copy (json_parser_get_root (parser));
+}
+
+static GVariant *
+scalar_to_variant (DmJsonReader *reader,
+                   const Scalar *scalar)
+{
+  switch (scalar->type)
+    {
+    case SCALAR_STRING:
+      return g_variant_new_string (reader->buffer->str);
+
+    case SCALAR_INT:
+      return g_variant_new_int64 (scalar->v_int);
+
+    case SCALAR_DOUBLE:
+      return g_variant_new_double (scalar->v_double);
+
+    case SCALAR_BOOLEAN:
+      return g_variant_new_boolean (scalar->v_boolean);
+
+    case SCALAR_NULL:
+      return NULL;
+
+    default:
+      g_assert_not_reached ();
+    }
+}
+
+/* Reads an object into an a{sv} variant, the same way as dict_from_json()
+ * in dm-utils.c does from a JsonNode.
+ */
+static GVariant *
+reader_read_dict (DmJsonReader *reader,
+                  GError **error)
+{
+  g_auto(GVariantBuilder) builder;
+  g_variant_builder_init (&builder, G_VARIANT_TYPE ("a{sv}"));
+
+  if (!reader_expect (reader, '{', error))
+    return NULL;
+
+  gboolean more = !reader_accept (reader, '}');
+  while (more)
+    {
+      if (!reader_read_string (reader, error) ||
+          !reader_expect (reader, ':', error))
+        return NULL;
+
+      g_autofree char *key = g_strdup (reader->buffer->str);
+      GVariant *value;
+
+      reader_skip_whitespace (reader);
+      if (reader_peek (reader) == '{' || reader_peek (reader) == '[')
+        {
+          g_autoptr(JsonNode) node = reader_read_node (reader, error);
+          if (node == NULL)
+            return NULL;
+
+          value = json_gvariant_deserialize (node, "v", NULL);
+          if (value == NULL)
+            {
+              g_autofree char *str = json_to_string (node, FALSE);
+              g_critical ("Invalid variant string; type: '%s', value: '%s'",
+                          json_node_type_name (node), str);
+            }
+        }
+      else
+        {
+          Scalar scalar;
+
+          if (!reader_read_scalar (reader, &scalar, error))
+            return NULL;
+
+          value = scalar_to_variant (reader, &scalar);
+        }
+
+      if (value != NULL)
+        g_variant_builder_add (&builder, "{sv}", key, value);
+
+      if (!reader_accept (reader, ','))
+        {
+          if (!reader_expect (reader, '}', error))
+            return NULL;
+          more = FALSE;
+        }
+    }
+
+  return g_variant_builder_end (&builder);
+}
+
+/* Reads an array of objects into an aa{sv} variant. Returns %NULL without
+ * setting @error if the value is well formed but not an array of objects.
+ */
+static GVariant *
+reader_read_dict_array (DmJsonReader *reader,
+                        GError **error)
+{
+  g_auto(GVariantBuilder) builder;
+  g_variant_builder_init (&builder, G_VARIANT_TYPE ("aa{sv}"));
+
+  if (!reader_accept (reader, '['))
+    return NULL;
+
+  gboolean more = !reader_accept (reader, ']');
+  while (more)
+    {
+      reader_skip_whitespace (reader);
+      if (reader_peek (reader) != '{')
+        return NULL;
+
+      GVariant *dict = reader_read_dict (reader, error);
+      if (dict == NULL)
+        return NULL;
+
+      g_variant_builder_add_value (&builder, dict);
+
+      if (!reader_accept (reader, ','))
+        {
+          if (!reader_expect (reader, ']', error))
+            return NULL;
+          more = FALSE;
+        }
+    }
+
+  return g_variant_builder_end (&builder);
+}
+
+/* Reads an array into a string vector, dropping anything that is not a
+ * non-empty string.
+ */
+static gboolean
+reader_read_strv (DmJsonReader *reader,
+                  char ***out,
+                  GError **error)
+{
+  g_autoptr(GPtrArray) array = g_ptr_array_new_with_free_func (g_free);
+
+  if (!reader_expect (reader, '[', error))
+    return FALSE;
+
+  gboolean more = !reader_accept (reader, ']');
+  while (more)
+    {
+      reader_skip_whitespace (reader);
+      if (reader_peek (reader) == '"')
+        {
+          if (!reader_read_string (reader, error))
+            return FALSE;
+
+          if (reader->buffer->len > 0)
+            g_ptr_array_add (array, g_strdup (reader->buffer->str));
+        }
+      else if (!reader_skip_value (reader, error))
+        {
+          return FALSE;
+        }
+
+      if (!reader_accept (reader, ','))
+        {
+          if (!reader_expect (reader, ']', error))
+            return FALSE;
+          more = FALSE;
+        }
+    }
+
+  g_ptr_array_add (array, NULL);
+  *out = (char **) g_ptr_array_free (g_steal_pointer (&array), FALSE);
+  return TRUE;
+}
+
+/* Anything the fast paths below don't cover goes through a JsonNode, so that
+ * conversions and warnings are the same as for models built from one.
+ */
+static gboolean
+reader_read_field_from_node (DmJsonReader *reader,
+                             gpointer priv,
+                             const DmJsonField *field,
+                             GError **error)
+{
+  g_autoptr(JsonNode) node = reader_read_node (reader, error);
+
+  if (node == NULL)
+    return FALSE;
+
+  if (!JSON_NODE_HOLDS_NULL (node))
+    dm_utils_set_field_from_json_node (priv, field, node);
+
+  return TRUE;
+}
+
+static gboolean
+reader_read_field (DmJsonReader *reader,
+                   gpointer priv,
+                   const DmJsonField *field,
+                   GError **error)
+{
+  gpointer location = G_STRUCT_MEMBER_P (priv, field->offset);
+
+  reader_skip_whitespace (reader);
+
+  const char *start = reader->pos;
+  char c = reader_peek (reader);
+  Scalar scalar;
+
+  switch (field->type)
+    {
+    case DM_JSON_FIELD_STRING:
+      if (c != '"')
+        break;
+
+      if (!reader_read_string (reader, error))
+        return FALSE;
+
+      g_free (*(char **) location);
+      *(char **) location = g_strdup (reader->buffer->str);
+      return TRUE;
+
+    case DM_JSON_FIELD_BOOLEAN:
+      if (c != 't' && c != 'f')
+        break;
+
+      if (!reader_read_scalar (reader, &scalar, error))
+        return FALSE;
+
+      *(gboolean *) location = scalar.v_boolean;
+      return TRUE;
+
+    case DM_JSON_FIELD_UINT:
+      /* Most of these are stored as strings, see dm-utils.c */
+      if (c == '"')
+        {
+          if (!reader_read_string (reader, error))
+            return FALSE;
+
+          *(guint *) location = atoi (reader->buffer->str);
+          return TRUE;
+        }
+
+      if (c != '-' && !g_ascii_isdigit (c))
+        break;
+
+      if (!reader_read_scalar (reader, &scalar, error))
+        return FALSE;
+
+      if (scalar.type != SCALAR_INT)
+        {
+          reader->pos = start;
+          break;
+        }
+
+      *(guint *) location = scalar.v_int;
+      return TRUE;
+
+    case DM_JSON_FIELD_STRV:
+      if (c != '[')
+        break;
+
+      {
+        char **strv;
+
+        if (!reader_read_strv (reader, &strv, error))
+          return FALSE;
+
+        g_strfreev (*(char ***) location);
+        *(char ***) location = strv;
+      }
+      return TRUE;
+
+    case DM_JSON_FIELD_DICT_ARRAY:
+      {
+        GError *internal_error = NULL;
+        GVariant *variant = reader_read_dict_array (reader, &internal_error);
+
+        if (internal_error != NULL)
+          {
+            g_propagate_error (error, internal_error);
+            return FALSE;
+          }
+
+        if (variant == NULL)
+          {
+            reader->pos = start;
+            break;
+          }
+
+        g_clear_pointer ((GVariant **) location, g_variant_unref);
+        *(GVariant **) location = g_variant_ref_sink (variant);
+      }
+      return TRUE;
+
+    case DM_JSON_FIELD_JSON_OBJECT:
+    default:
+      break;
+    }
+
+  return reader_read_field_from_node (reader, priv, field, error);
+}
+
+static DmJsonPending *
+dm_json_pending_new (GBytes *bytes)
+{
+  DmJsonPending *pending = g_slice_new0 (DmJsonPending);
+
+  pending->bytes = g_bytes_ref (bytes);
+  pending->values = g_array_sized_new (FALSE, FALSE, sizeof (PendingValue), 4);
+
+  return pending;
+}
+
+void
+dm_json_pending_free (DmJsonPending *pending)
+{
+  g_return_if_fail (pending != NULL);
+
+  g_bytes_unref (pending->bytes);
+  g_array_unref (pending->values);
+
+  g_slice_free (DmJsonPending, pending);
+}
+
+/*< private >
+ * dm_json_pending_resolve:
+ * @pending: the pending fields
+ * @model: the model they belong to
+ *
+ * Decodes the fields of @model which were left pending when it was filled in
+ * by dm_json_reader_fill_model(). The caller must make sure nothing else is
+ * reading or resolving those fields at the same time.
+ */
+void
+dm_json_pending_resolve (DmJsonPending *pending,
+                         gpointer model)
+{
+  g_return_if_fail (pending != NULL);
+
+  gsize length;
+  const char *data = g_bytes_get_data (pending->bytes, &length);
+
+  g_auto(DmJsonReader) reader;
+  reader_init (&reader, data, length);
+
+  for (guint i = 0; i < pending->values->len; i++)
+    {
+      const PendingValue *value = &g_array_index (pending->values, PendingValue, i);
+      g_autoptr(GError) error = NULL;
+
+      reader.pos = data + value->offset;
+      reader.end = reader.pos + value->length;
+
+      if (!reader_read_field (&reader, value->table->get_private (model),
+                              value->field, &error))
+        g_critical ("Unable to read field '%s' from metadata: %s",
+                    value->field->property, error->message);
+    }
+}
+
+static const DmJsonField *
+find_field (const DmJsonFieldTable *table,
+            const char *json_key,
+            const DmJsonFieldTable **owner)
+{
+  for (; table != NULL; table = table->parent)
+    {
+      for (guint i = 0; i < table->n_fields; i++)
+        {
+          if (strcmp (table->fields[i].json_key, json_key) == 0)
+            {
+              *owner = table;
+              return &table->fields[i];
+            }
+        }
+    }
+
+  return NULL;
+}
+
+/*< private >
+ * dm_json_reader_get_strings:
+ * @data: JSON text holding an object
+ * @length: length of @data
+ * @keys: (array zero-terminated=1): members of the object to look for
+ * @values: (out caller-allocates): a %NULL-filled array with as many
+ *   elements as @keys
+ * @error: return location for an error, or %NULL
+ *
+ * Finds the string values of some members of a JSON object, without looking
+ * any further into the object than needed. Members which are missing or not
+ * strings are left %NULL in @values. Strings found are stored in @values even
+ * if an error occurs later on, and must be freed by the caller.
+ *
+ * Returns: %TRUE on success, %FALSE if @data is malformed
+ */
+gboolean
+dm_json_reader_get_strings (const char *data,
+                            gsize length,
+                            const char * const *keys,
+                            char **values,
+                            GError **error)
+{
+  g_auto(DmJsonReader) reader;
+  reader_init (&reader, data, length);
+
+  guint n_keys = g_strv_length ((char **) keys);
+  guint n_found = 0;
+
+  if (!reader_expect (&reader, '{', error))
+    return FALSE;
+
+  gboolean more = !reader_accept (&reader, '}');
+  while (more && n_found < n_keys)
+    {
+      if (!reader_read_string (&reader, error) ||
+          !reader_expect (&reader, ':', error))
+        return FALSE;
+
+      int index = -1;
+      for (guint i = 0; i < n_keys && index < 0; i++)
+        {
+          if (values[i] == NULL && strcmp (keys[i], reader.buffer->str) == 0)
+            index = i;
+        }
+
+      reader_skip_whitespace (&reader);
+      if (index >= 0 && reader_peek (&reader) == '"')
+        {
+          if (!reader_read_string (&reader, error))
+            return FALSE;
+
+          values[index] = g_strdup (reader.buffer->str);
+          n_found++;
+        }
+      else if (!reader_skip_value (&reader, error))
+        {
+          return FALSE;
+        }
+
+      if (!reader_accept (&reader, ','))
+        {
+          if (!reader_expect (&reader, '}', error))
+            return FALSE;
+          more = FALSE;
+        }
+    }
+
+  return TRUE;
+}
+
+/*< private >
+ * dm_json_reader_fill_model:
+ * @bytes: JSON text holding the model metadata
+ * @model: a newly created model
+ * @table: the JSON fields of @model's type
+ * @properties: (nullable): names of the properties to fill in, or %NULL for
+ *   all of them
+ * @pending_out: (out) (optional) (nullable): return location for the lazy
+ *   fields left to decode, or %NULL to decode them straight away
+ * @error: return location for an error, or %NULL
+ *
+ * Stores the members of the metadata object which are described by @table,
+ * or its parent tables, into @model. Members not described by @table, or
+ * whose property is not listed in @properties, are skipped over.
+ *
+ * Lazy fields are only checked for balanced brackets and noted down in
+ * @pending_out, together with a reference to @bytes, to be decoded with
+ * dm_json_pending_resolve() when they are first needed.
+ *
+ * Returns: %TRUE on success, %FALSE if @bytes is malformed
+ */
+gboolean
+dm_json_reader_fill_model (GBytes *bytes,
+                           gpointer model,
+                           const DmJsonFieldTable *table,
+                           const char * const *properties,
+                           DmJsonPending **pending_out,
+                           GError **error)
+{
+  g_autoptr(DmJsonPending) pending = NULL;
+  gsize length;
+  const char *data = g_bytes_get_data (bytes, &length);
+
+  g_auto(DmJsonReader) reader;
+  reader_init (&reader, data, length);
+
+  if (!reader_expect (&reader, '{', error))
+    return FALSE;
+
+  gboolean more = !reader_accept (&reader, '}');
+  while (more)
+    {
+      if (!reader_read_string (&reader, error) ||
+          !reader_expect (&reader, ':', error))
+        return FALSE;
+
+      const DmJsonFieldTable *owner = NULL;
+      const DmJsonField *field = find_field (table, reader.buffer->str, &owner);
+
+      if (field != NULL && field->lazy && pending_out != NULL &&
+          (properties == NULL || g_strv_contains (properties, field->property)))
+        {
+          reader_skip_whitespace (&reader);
+          const char *start = reader.pos;
+
+          if (!reader_skip_value (&reader, error))
+            return FALSE;
+
+          if (pending == NULL)
+            pending = dm_json_pending_new (bytes);
+
+          PendingValue value = { owner, field, start - data, reader.pos - start };
+          g_array_append_val (pending->values, value);
+        }
+      else if (field != NULL &&
+               (properties == NULL || g_strv_contains (properties, field->property)))
+        {
+          if (!reader_read_field (&reader, owner->get_private (model), field, error))
+            return FALSE;
+        }
+      else if (!reader_skip_value (&reader, error))
+        {
+          return FALSE;
+        }
+
+      if (!reader_accept (&reader, ','))
+        {
+          if (!reader_expect (&reader, '}', error))
+            return FALSE;
+          more = FALSE;
+        }
+    }
+
+  reader_skip_whitespace (&reader);
+  if (reader.pos < reader.end && *reader.pos != '\0')
+    return reader_error (&reader, error, "unexpected data after the object");
+
+  if (pending_out != NULL)
+    *pending_out = g_steal_pointer (&pending);
+
+  return TRUE;
+}
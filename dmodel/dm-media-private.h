@@ -2,10 +2,10 @@
 
 #pragma once
 
+#include "dm-utils-private.h"
+
 G_BEGIN_DECLS
 
-void
-dm_media_add_json_to_params (JsonNode *node,
-                             GArray *params);
+extern const DmJsonFieldTable dm_media_json_fields;
 
 G_END_DECLS
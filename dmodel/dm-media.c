@@ -174,44 +174,26 @@ dm_media_init (G_GNUC_UNUSED DmMedia *self)
 {
 }
 
-/**
- * dm_media_add_json_to_params: (skip)
- * @node: a json node
- * @params: a caller owned array a gparams
- *
- * Private function. Appends GParameters to the array with DmArticle
- * property values parsed from the json node metadata.
- */
-void
-dm_media_add_json_to_params (JsonNode *node,
-                             GArray *params)
+static gpointer
+dm_media_get_private (gpointer self)
 {
-  if (!JSON_NODE_HOLDS_OBJECT (node))
-    {
-      g_critical ("Trying to instantiate a DmMedia from a non json object.");
-      return;
-    }
-
-  dm_content_add_json_to_params (node, params);
-
-  JsonObject *object = json_node_get_object (node);
-  GObjectClass *klass = g_type_class_ref (DM_TYPE_MEDIA);
-
-  dm_utils_append_gparam_from_json_node (json_object_get_member (object, "caption"),
-                                         g_object_class_find_property (klass, "caption"),
-                                         params);
-  dm_utils_append_gparam_from_json_node (json_object_get_member (object, "width"),
-                                         g_object_class_find_property (klass, "width"),
-                                         params);
-  dm_utils_append_gparam_from_json_node (json_object_get_member (object, "height"),
-                                         g_object_class_find_property (klass, "height"),
-                                         params);
-  dm_utils_append_gparam_from_json_node (json_object_get_member (object, "parent"),
-                                         g_object_class_find_property (klass, "parent-uri"),
-                                         params);
-  g_type_class_unref (klass);
+  return dm_media_get_instance_private (self);
 }
 
+static const DmJsonField media_fields[] = {
+  DM_JSON_FIELD ("caption", "caption", STRING, DmMediaPrivate, caption),
+  DM_JSON_FIELD ("width", "width", UINT, DmMediaPrivate, width),
+  DM_JSON_FIELD ("height", "height", UINT, DmMediaPrivate, height),
+  DM_JSON_FIELD ("parent", "parent-uri", STRING, DmMediaPrivate, parent_uri),
+};
+
+const DmJsonFieldTable dm_media_json_fields = {
+  &dm_content_json_fields,
+  dm_media_get_private,
+  media_fields,
+  G_N_ELEMENTS (media_fields),
+};
+
 /**
  * dm_media_new_from_json_node:
  * @node: a json node with the model metadata
@@ -226,13 +208,6 @@ dm_media_new_from_json_node (JsonNode *node)
 {
   g_autoptr(EosProfileProbe) probe = EOS_PROFILE_PROBE ("/dmodel/object/media");
 
-G_GNUC_BEGIN_IGNORE_DEPRECATIONS
-  GArray *params = g_array_new (FALSE, TRUE, sizeof (GParameter));
-  dm_media_add_json_to_params (node, params);
-  DmMedia *model = g_object_newv (DM_TYPE_MEDIA, params->len,
-                                  (GParameter *)params->data);
-  dm_utils_free_gparam_array (params);
-G_GNUC_END_IGNORE_DEPRECATIONS
-
-  return DM_CONTENT (model);
+  return dm_utils_new_model_from_json_node (DM_TYPE_MEDIA,
+                                            &dm_media_json_fields, node);
 }
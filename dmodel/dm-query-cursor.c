@@ -0,0 +1,418 @@
+/* Copyright 2020 Endless Mobile, Inc. */
+
+#include "dm-query-cursor.h"
+
+#include "dm-domain-private.h"
+
+#include <endless/endless.h>
+
+/* Results are fetched from the search database in chunks that start at
+ * CHUNK_MIN_SIZE and double with every refill up to CHUNK_MAX_SIZE, so that
+ * paging through N results only runs the match O(log N) times.
+ */
+#define CHUNK_MIN_SIZE 32
+#define CHUNK_MAX_SIZE 1024
+
+/**
+ * SECTION:query-cursor
+ * @title: Query Cursor
+ * @short_description: Page through the results of a query
+ *
+ * A #DmQueryCursor hands out the results of a #DmQuery one page at a time,
+ * for example for lists that load more results as the user scrolls.
+ *
+ * Rather than running the query again with a growing #DmQuery:offset for
+ * every page, the cursor reads ahead from the search database in
+ * increasingly large chunks and serves the following pages from what it
+ * already read, so asking for the next page does not get slower the deeper
+ * into the results it is.
+ *
+ * The #DmQuery:offset and #DmQuery:limit of the query set the position of
+ * the first result and the maximum total number of results.
+ *
+ * Since: 0.2
+ */
+struct _DmQueryCursor
+{
+  GObject parent_instance;
+
+  DmDomain *domain;
+  DmQuery *query;
+
+  /* Protects everything below; held for the whole of a page request, so
+   * that pages are handed out in order.
+   */
+  GMutex lock;
+
+  /* URIs read from the database but not returned yet */
+  GPtrArray *pending;
+  /* number of results read from the database so far */
+  guint fetched;
+  /* number of results returned so far */
+  guint position;
+  guint chunk_size;
+  int upper_bound;
+  /* whether the database has no more results after the ones in pending */
+  gboolean end_reached;
+};
+
+G_DEFINE_TYPE (DmQueryCursor, dm_query_cursor, G_TYPE_OBJECT)
+
+enum {
+  PROP_0,
+  PROP_DOMAIN,
+  PROP_QUERY,
+  NPROPS
+};
+
+static GParamSpec *dm_query_cursor_props[NPROPS] = { NULL, };
+
+static void
+dm_query_cursor_get_property (GObject *object,
+                              guint prop_id,
+                              GValue *value,
+                              GParamSpec *pspec)
+{
+  DmQueryCursor *self = DM_QUERY_CURSOR (object);
+
+  switch (prop_id)
+    {
+    case PROP_DOMAIN:
+      g_value_set_object (value, self->domain);
+      break;
+
+    case PROP_QUERY:
+      g_value_set_object (value, self->query);
+      break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+    }
+}
+
+static void
+dm_query_cursor_set_property (GObject *object,
+                              guint prop_id,
+                              const GValue *value,
+                              GParamSpec *pspec)
+{
+  DmQueryCursor *self = DM_QUERY_CURSOR (object);
+
+  switch (prop_id)
+    {
+    case PROP_DOMAIN:
+      g_assert (self->domain == NULL);
+      self->domain = g_value_dup_object (value);
+      break;
+
+    case PROP_QUERY:
+      g_assert (self->query == NULL);
+      self->query = g_value_dup_object (value);
+      break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+    }
+}
+
+static void
+dm_query_cursor_finalize (GObject *object)
+{
+  DmQueryCursor *self = DM_QUERY_CURSOR (object);
+
+  g_clear_object (&self->domain);
+  g_clear_object (&self->query);
+  g_clear_pointer (&self->pending, g_ptr_array_unref);
+  g_mutex_clear (&self->lock);
+
+  G_OBJECT_CLASS (dm_query_cursor_parent_class)->finalize (object);
+}
+
+static void
+dm_query_cursor_class_init (DmQueryCursorClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->get_property = dm_query_cursor_get_property;
+  object_class->set_property = dm_query_cursor_set_property;
+  object_class->finalize = dm_query_cursor_finalize;
+
+  /**
+   * DmQueryCursor:domain:
+   *
+   * The domain whose content is being queried.
+   *
+   * Since: 0.2
+   */
+  dm_query_cursor_props[PROP_DOMAIN] =
+    g_param_spec_object ("domain", "Domain",
+      "Domain whose content is being queried",
+      DM_TYPE_DOMAIN,
+      G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY | G_PARAM_STATIC_STRINGS);
+
+  /**
+   * DmQueryCursor:query:
+   *
+   * The query whose results are being paged through.
+   *
+   * Since: 0.2
+   */
+  dm_query_cursor_props[PROP_QUERY] =
+    g_param_spec_object ("query", "Query",
+      "Query whose results are being paged through",
+      DM_TYPE_QUERY,
+      G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY | G_PARAM_STATIC_STRINGS);
+
+  g_object_class_install_properties (object_class, NPROPS,
+                                     dm_query_cursor_props);
+}
+
+static void
+dm_query_cursor_init (DmQueryCursor *self)
+{
+  g_mutex_init (&self->lock);
+
+  self->pending = g_ptr_array_new_with_free_func (g_free);
+  self->chunk_size = CHUNK_MIN_SIZE;
+}
+
+/**
+ * dm_query_cursor_new:
+ * @domain: the domain to query
+ * @query: the query to page through
+ *
+ * Creates a cursor over the results of @query. Nothing is read from the
+ * search database until the first page is requested.
+ *
+ * Returns: (transfer full): a new #DmQueryCursor
+ *
+ * Since: 0.2
+ */
+DmQueryCursor *
+dm_query_cursor_new (DmDomain *domain,
+                     DmQuery *query)
+{
+  g_return_val_if_fail (DM_IS_DOMAIN (domain), NULL);
+  g_return_val_if_fail (DM_IS_QUERY (query), NULL);
+
+  return g_object_new (DM_TYPE_QUERY_CURSOR,
+                       "domain", domain,
+                       "query", query,
+                       NULL);
+}
+
+/**
+ * dm_query_cursor_get_query:
+ * @self: the cursor
+ *
+ * See #DmQueryCursor:query.
+ *
+ * Returns: (transfer none): the query
+ *
+ * Since: 0.2
+ */
+DmQuery *
+dm_query_cursor_get_query (DmQueryCursor *self)
+{
+  g_return_val_if_fail (DM_IS_QUERY_CURSOR (self), NULL);
+  return self->query;
+}
+
+/**
+ * dm_query_cursor_get_position:
+ * @self: the cursor
+ *
+ * Gets the number of results handed out by the cursor so far, not counting
+ * the #DmQuery:offset of its query.
+ *
+ * Returns: the number of results returned so far
+ *
+ * Since: 0.2
+ */
+guint
+dm_query_cursor_get_position (DmQueryCursor *self)
+{
+  g_return_val_if_fail (DM_IS_QUERY_CURSOR (self), 0);
+
+  g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&self->lock);
+  return self->position;
+}
+
+/**
+ * dm_query_cursor_is_exhausted:
+ * @self: the cursor
+ *
+ * Checks whether all the results of the query have been handed out, in
+ * which case further pages will be empty.
+ *
+ * Returns: %TRUE if there are no more results
+ *
+ * Since: 0.2
+ */
+gboolean
+dm_query_cursor_is_exhausted (DmQueryCursor *self)
+{
+  g_return_val_if_fail (DM_IS_QUERY_CURSOR (self), TRUE);
+
+  g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&self->lock);
+  return self->end_reached && self->pending->len == 0;
+}
+
+/* Reads the next chunk of results from the database into the pending list.
+ * Must be called with the lock held.
+ */
+static gboolean
+dm_query_cursor_refill (DmQueryCursor *self,
+                        guint n_wanted,
+                        GError **error)
+{
+  g_autoptr(EosProfileProbe) probe = EOS_PROFILE_PROBE ("/dmodel/cursor/refill");
+
+  guint limit = dm_query_get_limit (self->query);
+  guint remaining = limit - MIN (limit, self->fetched);
+  guint chunk = MIN (MAX (self->chunk_size, n_wanted), remaining);
+
+  if (chunk == 0)
+    {
+      self->end_reached = TRUE;
+      return TRUE;
+    }
+
+  guint offset = dm_query_get_offset (self->query) + self->fetched;
+  g_autoptr(DmQuery) chunk_query = dm_query_new_from_object (self->query,
+                                                             "offset", offset,
+                                                             "limit", chunk,
+                                                             NULL);
+  int upper_bound;
+  g_autoptr(GPtrArray) uris = dm_domain_run_query (self->domain, chunk_query,
+                                                   &upper_bound, error);
+  if (uris == NULL)
+    return FALSE;
+
+  for (guint i = 0; i < uris->len; i++)
+    g_ptr_array_add (self->pending, g_strdup (g_ptr_array_index (uris, i)));
+
+  self->fetched += chunk;
+  self->upper_bound = upper_bound;
+  self->chunk_size = MIN (self->chunk_size * 2, CHUNK_MAX_SIZE);
+
+  /* Documents that can't be read are left out of uris, so its length says
+   * nothing about the end of the matches. The upper bound does: it is exact
+   * once the match set comes back short of the chunk, and it can't be
+   * beyond this chunk if there are no more matches after it.
+   */
+  if ((gint64) offset + chunk >= upper_bound)
+    self->end_reached = TRUE;
+
+  return TRUE;
+}
+
+static void
+next_page_task (GTask *task,
+                gpointer source_object,
+                gpointer task_data,
+                GCancellable *cancellable)
+{
+  DmQueryCursor *self = source_object;
+  guint n_results = GPOINTER_TO_UINT (task_data);
+  GError *error = NULL;
+
+  if (g_task_return_error_if_cancelled (task))
+    return;
+
+  g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&self->lock);
+
+  while (self->pending->len < n_results && !self->end_reached)
+    {
+      if (!dm_query_cursor_refill (self, n_results - self->pending->len, &error))
+        {
+          g_task_return_error (task, error);
+          return;
+        }
+    }
+
+  guint n_page = MIN (n_results, self->pending->len);
+  g_autoptr(GPtrArray) page = g_ptr_array_new_full (n_page, g_free);
+  for (guint i = 0; i < n_page; i++)
+    g_ptr_array_add (page, g_strdup (g_ptr_array_index (self->pending, i)));
+  g_ptr_array_remove_range (self->pending, 0, n_page);
+
+  self->position += n_page;
+  int upper_bound = self->upper_bound;
+
+  g_clear_pointer (&locker, g_mutex_locker_free);
+
+  GSList *models = NULL;
+  const char * const *fields = (const char * const *) dm_query_get_fields (self->query);
+
+  if (!dm_domain_get_objects_sync (self->domain, page, fields, &models,
+                                   cancellable, &error))
+    {
+      g_task_return_error (task, error);
+      return;
+    }
+
+  DmQueryResults *results = g_object_new (DM_TYPE_QUERY_RESULTS,
+                                          "upper-bound", upper_bound,
+                                          "models", models,
+                                          NULL);
+
+  g_slist_free_full (models, g_object_unref);
+
+  g_task_return_pointer (task, results, g_object_unref);
+}
+
+/**
+ * dm_query_cursor_next_page:
+ * @self: the cursor
+ * @n_results: the maximum number of results in the page
+ * @cancellable: (allow-none): optional #GCancellable object, %NULL to ignore.
+ * @callback: (scope async): callback to call when the request is satisfied.
+ * @user_data: (closure): the data to pass to callback function.
+ *
+ * Asynchronously fetches the next @n_results results of the query. Pages
+ * are handed out in the order they are requested, but it only makes sense
+ * to ask for a page once the previous one has been received.
+ *
+ * Since: 0.2
+ */
+void
+dm_query_cursor_next_page (DmQueryCursor *self,
+                           guint n_results,
+                           GCancellable *cancellable,
+                           GAsyncReadyCallback callback,
+                           gpointer user_data)
+{
+  g_return_if_fail (DM_IS_QUERY_CURSOR (self));
+  g_return_if_fail (G_IS_CANCELLABLE (cancellable) || cancellable == NULL);
+
+  g_autoptr(GTask) task = g_task_new (self, cancellable, callback, user_data);
+  g_task_set_source_tag (task, dm_query_cursor_next_page);
+  g_task_set_task_data (task, GUINT_TO_POINTER (n_results), NULL);
+
+  g_task_run_in_thread (task, next_page_task);
+}
+
+/**
+ * dm_query_cursor_next_page_finish:
+ * @self: the cursor
+ * @result: the #GAsyncResult that was provided to the callback.
+ * @error: #GError for error reporting.
+ *
+ * Finishes a dm_query_cursor_next_page() call. Once the cursor is exhausted
+ * the results contain no models.
+ *
+ * Returns: (transfer full): the results object for the page
+ *
+ * Since: 0.2
+ */
+DmQueryResults *
+dm_query_cursor_next_page_finish (DmQueryCursor *self,
+                                  GAsyncResult *result,
+                                  GError **error)
+{
+  g_return_val_if_fail (DM_IS_QUERY_CURSOR (self), NULL);
+  g_return_val_if_fail (g_task_is_valid (result, self), NULL);
+
+  return g_task_propagate_pointer (G_TASK (result), error);
+}
@@ -0,0 +1,51 @@
+/* Copyright 2020 Endless Mobile, Inc. */
+
+#pragma once
+
+#include <gio/gio.h>
+
+#include "dm-domain.h"
+#include "dm-macros.h"
+#include "dm-query.h"
+#include "dm-query-results.h"
+
+G_BEGIN_DECLS
+
+#define DM_TYPE_QUERY_CURSOR dm_query_cursor_get_type ()
+
+DM_AVAILABLE_IN_0_2
+G_DECLARE_FINAL_TYPE (DmQueryCursor, dm_query_cursor, DM, QUERY_CURSOR,
+                      GObject)
+
+DM_AVAILABLE_IN_0_2
+DmQueryCursor *
+dm_query_cursor_new (DmDomain *domain,
+                     DmQuery *query);
+
+DM_AVAILABLE_IN_0_2
+DmQuery *
+dm_query_cursor_get_query (DmQueryCursor *self);
+
+DM_AVAILABLE_IN_0_2
+guint
+dm_query_cursor_get_position (DmQueryCursor *self);
+
+DM_AVAILABLE_IN_0_2
+gboolean
+dm_query_cursor_is_exhausted (DmQueryCursor *self);
+
+DM_AVAILABLE_IN_0_2
+void
+dm_query_cursor_next_page (DmQueryCursor *self,
+                           guint n_results,
+                           GCancellable *cancellable,
+                           GAsyncReadyCallback callback,
+                           gpointer user_data);
+
+DM_AVAILABLE_IN_0_2
+DmQueryResults *
+dm_query_cursor_next_page_finish (DmQueryCursor *self,
+                                  GAsyncResult *result,
+                                  GError **error);
+
+G_END_DECLS
@@ -5,6 +5,7 @@
 #include <glib.h>
 #include <xapian-glib.h>
 
+#include "dm-cache-private.h"
 #include "dm-query.h"
 
 G_BEGIN_DECLS
@@ -13,4 +14,24 @@ void
 dm_query_configure_enquire (DmQuery *self,
                             XapianEnquire *enquire);
 
+DmCache *
+dm_query_clause_cache_new (void);
+
+XapianQuery *
+dm_query_get_query_full (DmQuery *self,
+                         XapianQueryParser *qp,
+                         DmCache *clause_cache,
+                         GError **error_out);
+
+char *
+dm_query_get_cache_key (DmQuery *self);
+
+char **
+dm_query_split_terms (const char *query);
+
+DmQuery *
+dm_query_new_fixed (DmQuery *self,
+                    const char *stop_fixed_terms,
+                    const char *spell_fixed_terms);
+
 G_END_DECLS
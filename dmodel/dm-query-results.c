@@ -24,6 +24,7 @@ struct _DmQueryResults
   GObject parent_instance;
 
   GSList *models;
+  char **ids;
   gint upper_bound;  /* One would think guint, but Xapian::doccount == int */
 };
 
@@ -33,6 +34,7 @@ enum {
   PROP_0,
   PROP_MODELS,
   PROP_UPPER_BOUND,
+  PROP_IDS,
   NPROPS
 };
 
@@ -57,6 +59,10 @@ dm_query_results_get_property (GObject *object,
       g_value_set_int (value, self->upper_bound);
       break;
 
+    case PROP_IDS:
+      g_value_set_boxed (value, self->ids);
+      break;
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
     }
@@ -83,6 +89,11 @@ dm_query_results_set_property (GObject *object,
       self->upper_bound = g_value_get_int (value);
       break;
 
+    case PROP_IDS:
+      g_assert (self->ids == NULL);
+      self->ids = g_value_dup_boxed (value);
+      break;
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
     }
@@ -94,6 +105,7 @@ dm_query_results_finalize (GObject *object)
   DmQueryResults *self = DM_QUERY_RESULTS (object);
 
   g_slist_free_full (self->models, g_object_unref);
+  g_strfreev (self->ids);
 
   G_OBJECT_CLASS (dm_query_results_parent_class)->finalize (object);
 }
@@ -132,6 +144,20 @@ dm_query_results_class_init (DmQueryResultsClass *klass)
       G_MININT, G_MAXINT, 0,
       G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY | G_PARAM_STATIC_STRINGS);
 
+  /**
+   * DmQueryResults:ids:
+   *
+   * The IDs of the content in the search results, in order, if the query
+   * asked for %DM_QUERY_OUTPUT_IDS. Otherwise %NULL.
+   *
+   * Since: 0.2
+   */
+  dm_query_results_props[PROP_IDS] =
+    g_param_spec_boxed ("ids", "IDs",
+      "IDs of the content in search results",
+      G_TYPE_STRV,
+      G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY | G_PARAM_STATIC_STRINGS);
+
   g_object_class_install_properties (object_class, NPROPS,
                                      dm_query_results_props);
 }
@@ -171,6 +197,24 @@ dm_query_results_get_upper_bound (DmQueryResults *self)
   return self->upper_bound;
 }
 
+/**
+ * dm_query_results_get_ids:
+ * @self: the #DmQueryResults
+ *
+ * See #DmQueryResults:ids.
+ *
+ * Returns: (transfer none) (array zero-terminated=1) (nullable): the IDs of
+ *   the results, or %NULL if the query did not ask for them
+ *
+ * Since: 0.2
+ */
+char * const *
+dm_query_results_get_ids (DmQueryResults *self)
+{
+  g_return_val_if_fail (DM_IS_QUERY_RESULTS (self), NULL);
+  return self->ids;
+}
+
 /**
  * dm_query_results_new_for_testing:
  * @models: (element-type DmContent) (transfer none):
@@ -22,6 +22,10 @@ DM_AVAILABLE_IN_ALL
 gint
 dm_query_results_get_upper_bound (DmQueryResults *self);
 
+DM_AVAILABLE_IN_0_2
+char * const *
+dm_query_results_get_ids (DmQueryResults *self);
+
 DM_AVAILABLE_IN_ALL
 DmQueryResults *
 dm_query_results_new_for_testing (GSList *models);
@@ -15,6 +15,7 @@
 #define XAPIAN_PUBLISHED_DATE_VALUE_NO 1
 #define XAPIAN_ALPHABETICAL_VALUE_NO 2
 #define MAX_TERM_LENGTH 245
+#define CLAUSE_CACHE_SIZE 128
 
 #define XAPIAN_PREFIX_EXACT_TITLE "XEXACTS"
 #define XAPIAN_PREFIX_TITLE "S"
@@ -22,10 +23,6 @@
 #define XAPIAN_PREFIX_ID "Q"
 #define XAPIAN_PREFIX_TAG "K"
 
-#define XAPIAN_SYNTAX_REGEX "\\(|\\)|\\+|\\-|\\'|\\\""
-#define XAPIAN_TERM_REGEX "AND|OR|NOT|XOR|NEAR|ADJ"
-#define XAPIAN_DELIMITER_REGEX "[\\s\\-;]+"
-
 /**
  * SECTION:query
  * @title: Query
@@ -58,6 +55,7 @@ struct _DmQuery
   DmQueryMatch match;
   DmQuerySort sort;
   DmQueryOrder order;
+  DmQueryOutput output;
   guint limit;
   guint offset;
   gint cutoff;
@@ -66,6 +64,7 @@ struct _DmQuery
   char **ids;
   char **excluded_ids;
   char **excluded_tags;
+  char **fields;
 };
 
 G_DEFINE_TYPE (DmQuery, dm_query, G_TYPE_OBJECT)
@@ -91,6 +90,8 @@ enum {
   PROP_CORRECTED_TERMS,
   PROP_CONTENT_TYPE,
   PROP_EXCLUDED_CONTENT_TYPE,
+  PROP_FIELDS,
+  PROP_OUTPUT,
   NPROPS
 };
 
@@ -182,6 +183,14 @@ dm_query_get_property (GObject *object,
       g_value_set_string (value, self->excluded_content_type);
       break;
 
+    case PROP_FIELDS:
+      g_value_set_boxed (value, self->fields);
+      break;
+
+    case PROP_OUTPUT:
+      g_value_set_enum (value, self->output);
+      break;
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
     }
@@ -285,6 +294,15 @@ dm_query_set_property (GObject *object,
       self->excluded_content_type = g_value_dup_string (value);
       break;
 
+    case PROP_FIELDS:
+      g_clear_pointer (&self->fields, g_strfreev);
+      self->fields = g_value_dup_boxed (value);
+      break;
+
+    case PROP_OUTPUT:
+      self->output = g_value_get_enum (value);
+      break;
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
     }
@@ -307,6 +325,7 @@ dm_query_finalize (GObject *object)
   g_clear_pointer (&self->ids, g_strfreev);
   g_clear_pointer (&self->excluded_ids, g_strfreev);
   g_clear_pointer (&self->excluded_tags, g_strfreev);
+  g_clear_pointer (&self->fields, g_strfreev);
 
   G_OBJECT_CLASS (dm_query_parent_class)->finalize (object);
 }
@@ -522,6 +541,37 @@ dm_query_class_init (DmQueryClass *klass)
       NULL,
       G_PARAM_READWRITE | G_PARAM_CONSTRUCT | G_PARAM_STATIC_STRINGS);
 
+  /**
+   * DmQuery:fields:
+   *
+   * A list of model property names that the caller is interested in, for
+   * example `id`, `title` and `thumbnail-uri`. When set, the models in the
+   * results of the query only have these properties filled in, and the
+   * remaining properties keep their default values. This makes listings
+   * with large limits much cheaper to build.
+   *
+   * If not set, the models are complete.
+   *
+   * Since: 0.2
+   */
+  dm_query_props[PROP_FIELDS] =
+    g_param_spec_boxed ("fields", "Fields",
+      "A list of model properties to fill in for the results",
+      G_TYPE_STRV,
+      G_PARAM_READWRITE | G_PARAM_CONSTRUCT | G_PARAM_STATIC_STRINGS);
+
+  /**
+   * DmQuery:output:
+   *
+   * What the results of the query should contain, see #DmQueryOutput.
+   *
+   * Since: 0.2
+   */
+  dm_query_props[PROP_OUTPUT] =
+    g_param_spec_enum ("output", "Output", "What the results of the query contain",
+      DM_TYPE_QUERY_OUTPUT, DM_QUERY_OUTPUT_MODELS,
+      G_PARAM_READWRITE | G_PARAM_CONSTRUCT | G_PARAM_STATIC_STRINGS);
+
   g_object_class_install_properties (object_class, NPROPS, dm_query_props);
 }
 
@@ -530,38 +580,148 @@ dm_query_init (G_GNUC_UNUSED DmQuery *self)
 {
 }
 
-// Limit term length we sent to xapian
+// Characters with a meaning in Xapian query syntax, which are dropped
+static inline gboolean
+is_syntax_char (char c)
+{
+  return c == '(' || c == ')' || c == '+' || c == '-' || c == '\'' || c == '"';
+}
+
+// Characters that separate terms: any Unicode whitespace, or a semicolon
+static inline gboolean
+is_delimiter_char (gunichar c)
+{
+  return c == ';' || c == '\v' || g_unichar_isspace (c);
+}
+
+static const char * const xapian_operators[] = {
+  "AND", "OR", "NOT", "XOR", "NEAR", "ADJ",
+};
+
+// Lowercase any xapian operators in a term, so that they are not parsed as
+// operators. Like a regex match, at each position the first operator in the
+// list that matches wins, and scanning resumes after it.
 static void
-chomp_term (gchar *term)
+lowercase_operators (char *term,
+                     gsize length)
+{
+  gsize i = 0;
+
+  while (i < length)
+    {
+      gsize match_length = 0;
+
+      if (term[i] == 'A' || term[i] == 'O' || term[i] == 'N' || term[i] == 'X')
+        {
+          for (guint j = 0; j < G_N_ELEMENTS (xapian_operators); j++)
+            {
+              gsize op_length = strlen (xapian_operators[j]);
+              if (op_length <= length - i &&
+                  memcmp (term + i, xapian_operators[j], op_length) == 0)
+                {
+                  match_length = op_length;
+                  break;
+                }
+            }
+        }
+
+      if (match_length == 0)
+        {
+          i++;
+          continue;
+        }
+
+      for (gsize k = 0; k < match_length; k++)
+        term[i + k] = g_ascii_tolower (term[i + k]);
+      i += match_length;
+    }
+}
+
+// Copy out a term, limiting the term length we send to xapian
+static char *
+finish_term (char *term,
+             gsize length)
 {
-  // Just dupe if the term is short
-  if (strlen (term) <= MAX_TERM_LENGTH)
-    return;
-  // Find the first utf character before our cutoff
-  gchar *end = g_utf8_prev_char (term + MAX_TERM_LENGTH + 1);
-  *end = '\0';
+  lowercase_operators (term, length);
+
+  // Cut at the first utf character before our cutoff
+  if (length > MAX_TERM_LENGTH)
+    length = g_utf8_prev_char (term + MAX_TERM_LENGTH + 1) - term;
+
+  return g_strndup (term, length);
 }
 
-// Sanitize and split terms from a user query
-static gchar **
-get_terms (const gchar *query)
+/*< private >
+ * dm_query_split_terms:
+ * @query: search terms as typed in by a user
+ *
+ * Sanitizes and splits terms from a user query in a single pass: Xapian
+ * syntax characters are dropped, Xapian operators are lowercased, and the
+ * rest is split at runs of whitespace and semicolons. A leading or trailing
+ * delimiter yields an empty first or last term.
+ *
+ * Returns: (transfer full): a %NULL-terminated array of terms
+ */
+char **
+dm_query_split_terms (const char *query)
 {
-  // Remove any xapian syntax characters, e.g. parenthesis
-  g_autoptr(GRegex) syntax_regex = g_regex_new (XAPIAN_SYNTAX_REGEX, 0, 0, NULL);
-  g_autofree gchar *without_syntax = g_regex_replace (syntax_regex, query, -1, 0, "", 0, NULL);
-  // Lowercase any xapian terms e.g. AND, OR
-  g_autoptr(GRegex) term_regex = g_regex_new (XAPIAN_TERM_REGEX, 0, 0, NULL);
-  g_autofree gchar *without_terms = g_regex_replace (term_regex, without_syntax, -1, 0, "\\L\\0\\E", 0, NULL);
-  // Split the query
-  g_autoptr(GRegex) delimiter_regex = g_regex_new (XAPIAN_DELIMITER_REGEX, 0, 0, NULL);
-  gchar **terms = g_regex_split (delimiter_regex, without_terms, 0);
-  // Chomp the terms
-  guint length = g_strv_length (terms);
-  for (guint i = 0; i < length; i++)
+  gsize length = strlen (query);
+  const char *end = query + length;
+
+  /* Terms are assembled in place in a single buffer, which never needs to
+   * be larger than the query since characters are only ever dropped.
+   */
+  g_autofree char *buffer = g_malloc (length + 1);
+  char *out = buffer;
+  char *term_start = buffer;
+
+  GPtrArray *terms = g_ptr_array_new ();
+  gboolean empty = TRUE;
+  gboolean in_delimiter = FALSE;
+
+  for (const char *p = query; p < end;)
     {
-      chomp_term (terms[i]);
+      if (is_syntax_char (*p))
+        {
+          p++;
+          continue;
+        }
+
+      empty = FALSE;
+
+      gunichar c = (guchar) *p;
+      const char *next = p + 1;
+      if (c >= 0x80)
+        {
+          c = g_utf8_get_char_validated (p, end - p);
+          if (c < (gunichar) -2)
+            next = g_utf8_next_char (p);
+        }
+
+      if (is_delimiter_char (c))
+        {
+          if (!in_delimiter)
+            {
+              g_ptr_array_add (terms, finish_term (term_start, out - term_start));
+              term_start = out;
+            }
+          in_delimiter = TRUE;
+        }
+      else
+        {
+          memcpy (out, p, next - p);
+          out += next - p;
+          in_delimiter = FALSE;
+        }
+
+      p = next;
     }
-  return terms;
+
+  if (!empty)
+    g_ptr_array_add (terms, finish_term (term_start, out - term_start));
+
+  g_ptr_array_add (terms, NULL);
+  return (char **) g_ptr_array_free (terms, FALSE);
 }
 
 static XapianQuery *
@@ -681,6 +841,66 @@ get_ids_clause (char **ids,
   return xapian_query_new_for_terms (join_op, (const char **) prefixed_ids);
 }
 
+/* Each tag is length-prefixed, so that no two lists share a key */
+static char *
+get_tags_clause_cache_key (char **tags,
+                           XapianQueryOp join_op)
+{
+  GString *key = g_string_new (NULL);
+
+  g_string_append_printf (key, "%d:", join_op);
+  for (char **iter = tags; *iter != NULL; iter++)
+    g_string_append_printf (key, "%zu:%s", strlen (*iter), *iter);
+
+  return g_string_free (key, FALSE);
+}
+
+/* Builds the clause for @tags, or reuses one built before for the same tags
+ * and operator if @clause_cache is not %NULL. Tag lists come from the app's
+ * layout and recur from one query to the next; ID lists are rarely asked
+ * for twice, so those are not worth caching. */
+static XapianQuery *
+get_cached_tags_clause (DmCache *clause_cache,
+                        char **tags,
+                        XapianQueryOp join_op)
+{
+  if (clause_cache == NULL || tags == NULL || *tags == NULL)
+    return get_tags_clause (tags, join_op);
+
+  g_autofree char *key = get_tags_clause_cache_key (tags, join_op);
+
+  XapianQuery *clause = dm_cache_lookup (clause_cache, key);
+  if (clause != NULL)
+    return clause;
+
+  clause = get_tags_clause (tags, join_op);
+  if (clause != NULL)
+    dm_cache_insert (clause_cache, key, clause, strlen (key));
+
+  return clause;
+}
+
+/*< private >
+ * dm_query_clause_cache_new:
+ *
+ * Creates a cache for the tag filter clauses of queries, to pass to
+ * dm_query_get_query_full().
+ *
+ * The #XapianQuery objects in it share state that is not safe to touch from
+ * more than one thread at a time, so a clause cache must only be used by one
+ * thread at a time, like the #XapianQueryParser it is used with.
+ *
+ * Returns: (transfer full): a new #DmCache
+ */
+DmCache *
+dm_query_clause_cache_new (void)
+{
+  return dm_cache_new (g_str_hash, g_str_equal,
+                       (GBoxedCopyFunc) g_strdup, g_free,
+                       g_object_ref, g_object_unref,
+                       CLAUSE_CACHE_SIZE, 0);
+}
+
 /**
  * dm_query_get_tags_match_all:
  * @self: the model
@@ -801,6 +1021,41 @@ dm_query_get_excluded_content_type (DmQuery *self)
   return self->excluded_content_type;
 }
 
+/**
+ * dm_query_get_fields:
+ * @self: the model
+ *
+ * Accessor function for #DmQuery:fields.
+ *
+ * Returns: (transfer none) (array zero-terminated=1) (nullable): an array of
+ *   strings, or %NULL if the query results should be complete models
+ *
+ * Since: 0.2
+ */
+char * const *
+dm_query_get_fields (DmQuery *self)
+{
+  g_return_val_if_fail (DM_IS_QUERY (self), NULL);
+  return self->fields;
+}
+
+/**
+ * dm_query_get_output:
+ * @self: the model
+ *
+ * Accessor function for #DmQuery:output.
+ *
+ * Returns: what the results of the query should contain
+ *
+ * Since: 0.2
+ */
+DmQueryOutput
+dm_query_get_output (DmQuery *self)
+{
+  g_return_val_if_fail (DM_IS_QUERY (self), DM_QUERY_OUTPUT_MODELS);
+  return self->output;
+}
+
 /*
  * get_corrected_query:
  * @self: a #DmQuery
@@ -816,7 +1071,7 @@ get_corrected_query (DmQuery *self,
                      GError **error_out)
 {
   g_autoptr(GError) error = NULL;
-  g_auto(GStrv) raw_terms = get_terms (self->search_terms);
+  g_auto(GStrv) raw_terms = dm_query_split_terms (self->search_terms);
 
   if (g_strv_length (raw_terms) == 0)
     return NULL;
@@ -844,7 +1099,7 @@ get_corrected_query (DmQuery *self,
    */
   g_auto(GStrv) corrected_terms = NULL;
   if (self->corrected_terms != NULL)
-    corrected_terms = get_terms (self->corrected_terms);
+    corrected_terms = dm_query_split_terms (self->corrected_terms);
 
   g_autoptr(XapianQuery) title_clause =
     get_title_clause (qp, raw_terms, corrected_terms, &error);
@@ -929,7 +1184,8 @@ get_content_type_clause (const char *content_type)
  * Returns: (transfer full) (nullable): a #XapianQuery object
  */
 static XapianQuery *
-get_filter_clause (DmQuery *self)
+get_filter_clause (DmQuery *self,
+                   DmCache *clause_cache)
 {
   if (self->tags_match_any == NULL &&
       self->tags_match_all == NULL &&
@@ -938,11 +1194,13 @@ get_filter_clause (DmQuery *self)
     return NULL;
 
   GSList *clauses = NULL;
-  XapianQuery *match_any = get_tags_clause (self->tags_match_any, XAPIAN_QUERY_OP_OR);
+  XapianQuery *match_any = get_cached_tags_clause (clause_cache, self->tags_match_any,
+                                                   XAPIAN_QUERY_OP_OR);
   if (match_any != NULL)
     clauses = g_slist_prepend (clauses, match_any);
 
-  XapianQuery *match_all = get_tags_clause (self->tags_match_all, XAPIAN_QUERY_OP_AND);
+  XapianQuery *match_all = get_cached_tags_clause (clause_cache, self->tags_match_all,
+                                                   XAPIAN_QUERY_OP_AND);
   if (match_all != NULL)
     clauses = g_slist_prepend (clauses, match_all);
 
@@ -972,7 +1230,8 @@ get_filter_clause (DmQuery *self)
  * Returns: (transfer full) (nullable): a #XapianQuery object
  */
 static XapianQuery *
-get_filter_out_clause (DmQuery *self)
+get_filter_out_clause (DmQuery *self,
+                       DmCache *clause_cache)
 {
   GSList *clauses = NULL;
 
@@ -985,7 +1244,8 @@ get_filter_out_clause (DmQuery *self)
   if (excluded_ids != NULL)
     clauses = g_slist_prepend (clauses, excluded_ids);
 
-  XapianQuery *excluded_tags = get_tags_clause (self->excluded_tags, XAPIAN_QUERY_OP_OR);
+  XapianQuery *excluded_tags = get_cached_tags_clause (clause_cache, self->excluded_tags,
+                                                       XAPIAN_QUERY_OP_OR);
   if (excluded_tags != NULL)
     clauses = g_slist_prepend (clauses, excluded_tags);
 
@@ -1201,6 +1461,27 @@ XapianQuery *
 dm_query_get_query (DmQuery *self,
                     XapianQueryParser *qp,
                     GError **error_out)
+{
+  return dm_query_get_query_full (self, qp, NULL, error_out);
+}
+
+/*< private >
+ * dm_query_get_query_full:
+ * @self: the query object
+ * @qp: a #XapianQueryParser
+ * @clause_cache: (nullable): a cache from dm_query_clause_cache_new()
+ * @error_out: (nullable): return location for an error, or %NULL.
+ *
+ * Like dm_query_get_query(), but reuses the tag filter clauses built for
+ * earlier queries from @clause_cache, if given.
+ *
+ * Returns: (transfer full): The constructed #XapianQuery, or %NULL on error.
+ */
+XapianQuery *
+dm_query_get_query_full (DmQuery *self,
+                         XapianQueryParser *qp,
+                         DmCache *clause_cache,
+                         GError **error_out)
 {
   g_autoptr(EosProfileProbe) probe = EOS_PROFILE_PROBE ("/dmodel/query");
 
@@ -1233,7 +1514,7 @@ dm_query_get_query (DmQuery *self,
   /* If no search terms, then query was match-all; parsed_query remains NULL */
 
   /* Fetch the filter clauses (if any) and combine. */
-  g_autoptr(XapianQuery) filter_query = get_filter_clause (self);
+  g_autoptr(XapianQuery) filter_query = get_filter_clause (self, clause_cache);
   if (filter_query != NULL)
     {
       if (parsed_query == NULL)
@@ -1255,7 +1536,7 @@ dm_query_get_query (DmQuery *self,
       parsed_query = xapian_query_new_match_all ();
     }
 
-  g_autoptr(XapianQuery) filterout_query = get_filter_out_clause (self);
+  g_autoptr(XapianQuery) filterout_query = get_filter_out_clause (self, clause_cache);
   if (filterout_query != NULL)
     {
       g_autoptr(XapianQuery) full_query =
@@ -1300,24 +1581,27 @@ dm_query_get_limit (DmQuery *self)
   return self->limit;
 }
 
-/**
- * dm_query_to_string:
- * @self: the query object
- *
- * Dumps a representation of @self to a string, for debugging only.
- * The format of this string may change at any time, so it should not be parsed.
- *
- * Returns: a string
+/* Serializes the properties of @self that differ from their defaults, in a
+ * fixed order. With @for_cache_key, string values are escaped so that two
+ * different queries can never produce the same string, and #DmQuery:fields
+ * is left out since it does not change which documents match.
  */
-char *
-dm_query_to_string (DmQuery *self)
+static char *
+dm_query_serialize (DmQuery *self,
+                    gboolean for_cache_key)
 {
   g_auto(GStrv) props = g_new0 (char *, NPROPS);
   size_t ix = 0;
 
+#define QUOTE(str) \
+  (for_cache_key ? g_strescape ((str), NULL) : g_strdup (str))
+
 #define DUMP_STRING(propname) \
   if (self->propname) \
-    props[ix++] = g_strdup_printf (#propname ": \"%s\"", self->propname);
+    { \
+      g_autofree char *prop = QUOTE (self->propname); \
+      props[ix++] = g_strdup_printf (#propname ": \"%s\"", prop); \
+    }
 
 #define DUMP_ENUM(propname, type, default_val) \
   if (self->propname != default_val) \
@@ -1337,7 +1621,11 @@ dm_query_to_string (DmQuery *self)
 #define DUMP_STRV(propname) \
   if (self->propname && *self->propname) \
     { \
-      g_autofree char *prop = g_strjoinv ("\", \"", self->propname); \
+      guint len = g_strv_length (self->propname); \
+      g_auto(GStrv) quoted = g_new0 (char *, len + 1); \
+      for (guint i = 0; i < len; i++) \
+        quoted[i] = QUOTE (self->propname[i]); \
+      g_autofree char *prop = g_strjoinv ("\", \"", quoted); \
       props[ix++] = g_strdup_printf (#propname ": [\"%s\"]", prop); \
     }
 
@@ -1360,12 +1648,88 @@ dm_query_to_string (DmQuery *self)
   DUMP_STRV(ids)
   DUMP_STRV(excluded_ids)
   DUMP_STRV(excluded_tags)
+  if (!for_cache_key)
+    {
+      DUMP_STRV(fields)
+      DUMP_ENUM(output, DM_TYPE_QUERY_OUTPUT, DM_QUERY_OUTPUT_MODELS)
+    }
 
+#undef QUOTE
 #undef DUMP_STRING
 #undef DUMP_ENUM
 #undef DUMP_UINT
+#undef DUMP_INT
 #undef DUMP_STRV
 
-  g_autofree char *props_string = g_strjoinv(", ", props);
+  return g_strjoinv (", ", props);
+}
+
+/**
+ * dm_query_to_string:
+ * @self: the query object
+ *
+ * Dumps a representation of @self to a string, for debugging only.
+ * The format of this string may change at any time, so it should not be parsed.
+ *
+ * Returns: a string
+ */
+char *
+dm_query_to_string (DmQuery *self)
+{
+  g_autofree char *props_string = dm_query_serialize (self, FALSE);
   return g_strdup_printf ("DModel.Query({%s})", props_string);
 }
+
+/*< private >
+ * dm_query_get_cache_key:
+ * @self: the query object
+ *
+ * Gets a string that is equal for two queries exactly when they match the
+ * same documents in the same order, so that their results can be cached.
+ *
+ * Returns: (transfer full): a string
+ */
+char *
+dm_query_get_cache_key (DmQuery *self)
+{
+  g_return_val_if_fail (DM_IS_QUERY (self), NULL);
+
+  return dm_query_serialize (self, TRUE);
+}
+
+/*< private >
+ * dm_query_new_fixed:
+ * @self: the query object that was fixed
+ * @stop_fixed_terms: (nullable): the search terms with stop words removed
+ * @spell_fixed_terms: (nullable): the spelling-corrected search terms
+ *
+ * Builds the query to run from the results of fixing @self's search terms.
+ *
+ * Returns: (transfer full): a new query object, or @self itself if there was
+ *   nothing to fix
+ */
+DmQuery *
+dm_query_new_fixed (DmQuery *self,
+                    const char *stop_fixed_terms,
+                    const char *spell_fixed_terms)
+{
+  g_return_val_if_fail (DM_IS_QUERY (self), NULL);
+
+  /* If we didn't get a corrected query, we can just reuse the existing query object */
+  if (stop_fixed_terms == NULL && spell_fixed_terms == NULL)
+    return g_object_ref (self);
+
+  if (stop_fixed_terms != NULL && spell_fixed_terms != NULL)
+    return dm_query_new_from_object (self,
+                                     "stopword-free-terms", stop_fixed_terms,
+                                     "corrected-terms", spell_fixed_terms,
+                                     NULL);
+  else if (stop_fixed_terms != NULL)
+    return dm_query_new_from_object (self,
+                                     "stopword-free-terms", stop_fixed_terms,
+                                     NULL);
+  else
+    return dm_query_new_from_object (self,
+                                     "corrected-terms", spell_fixed_terms,
+                                     NULL);
+}
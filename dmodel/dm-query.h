@@ -71,6 +71,26 @@ typedef enum {
   DM_QUERY_ORDER_DESCENDING,
 } DmQueryOrder;
 
+/**
+ * DmQueryOutput:
+ * @DM_QUERY_OUTPUT_MODELS: Return the models of the matching content.
+ * @DM_QUERY_OUTPUT_IDS: Return only the IDs of the matching content, see
+ *   dm_query_results_get_ids(). No models are loaded.
+ * @DM_QUERY_OUTPUT_COUNT: Return only the number of matches, see
+ *   #DmQueryResults:upper-bound, which is exact for this output. The offset
+ *   and limit of the query are ignored, no documents are fetched and no
+ *   models are loaded.
+ *
+ * Enumeration of what the results of a query contain.
+ *
+ * Since: 0.2
+ */
+typedef enum {
+  DM_QUERY_OUTPUT_MODELS,
+  DM_QUERY_OUTPUT_IDS,
+  DM_QUERY_OUTPUT_COUNT,
+} DmQueryOutput;
+
 DM_AVAILABLE_IN_ALL
 char * const *
 dm_query_get_tags_match_all (DmQuery *self);
@@ -123,6 +143,14 @@ DM_AVAILABLE_IN_ALL
 const char *
 dm_query_get_excluded_content_type (DmQuery *self);
 
+DM_AVAILABLE_IN_0_2
+char * const *
+dm_query_get_fields (DmQuery *self);
+
+DM_AVAILABLE_IN_0_2
+DmQueryOutput
+dm_query_get_output (DmQuery *self);
+
 DM_AVAILABLE_IN_ALL
 XapianQuery *
 dm_query_get_query (DmQuery *self,
@@ -0,0 +1,19 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+
+/* Copyright 2020 Endless Mobile, Inc. */
+
+#pragma once
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+#define DM_TYPE_RANGE_INPUT_STREAM (dm_range_input_stream_get_type())
+
+G_DECLARE_FINAL_TYPE (DmRangeInputStream, dm_range_input_stream, DM, RANGE_INPUT_STREAM, GInputStream)
+
+GInputStream *dm_range_input_stream_new (GInputStream *base_stream,
+                                         goffset start,
+                                         goffset length);
+
+G_END_DECLS
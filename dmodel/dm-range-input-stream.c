@@ -0,0 +1,214 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+
+/* Copyright 2020 Endless Mobile, Inc. */
+
+#include "dm-range-input-stream-private.h"
+
+/* A seekable input stream over the bytes between @start and @start + @length
+ * of a seekable base stream, usually a file. Nothing is buffered: each read
+ * goes straight to the base stream, so memory use is bounded by what the
+ * caller asks for no matter how large the range is.
+ */
+struct _DmRangeInputStream {
+  GInputStream parent_instance;
+
+  GInputStream *base_stream;
+  goffset start;
+  goffset length;
+  /* relative to start */
+  goffset position;
+  /* whether the base stream has to be moved to position before reading */
+  gboolean needs_seek;
+};
+
+static void dm_range_input_stream_seekable_iface_init (GSeekableIface *iface);
+
+G_DEFINE_TYPE_WITH_CODE (DmRangeInputStream, dm_range_input_stream, G_TYPE_INPUT_STREAM,
+                         G_IMPLEMENT_INTERFACE (G_TYPE_SEEKABLE,
+                                                dm_range_input_stream_seekable_iface_init))
+
+/**
+ * dm_range_input_stream_new:
+ * @base_stream: a seekable #GInputStream
+ * @start: offset in @base_stream where the range starts
+ * @length: size of the range in bytes
+ *
+ * Returns: (transfer full): The newly created #DmRangeInputStream.
+ */
+GInputStream *
+dm_range_input_stream_new (GInputStream *base_stream,
+                           goffset start,
+                           goffset length)
+{
+  g_return_val_if_fail (G_IS_SEEKABLE (base_stream), NULL);
+  g_return_val_if_fail (start >= 0 && length >= 0, NULL);
+
+  DmRangeInputStream *self = g_object_new (DM_TYPE_RANGE_INPUT_STREAM, NULL);
+  self->base_stream = g_object_ref (base_stream);
+  self->start = start;
+  self->length = length;
+
+  return G_INPUT_STREAM (self);
+}
+
+static void
+dm_range_input_stream_finalize (GObject *object)
+{
+  DmRangeInputStream *self = DM_RANGE_INPUT_STREAM (object);
+
+  g_clear_object (&self->base_stream);
+
+  G_OBJECT_CLASS (dm_range_input_stream_parent_class)->finalize (object);
+}
+
+static gssize
+dm_range_input_stream_read (GInputStream *stream,
+                            void *buffer,
+                            gsize count,
+                            GCancellable *cancellable,
+                            GError **error)
+{
+  DmRangeInputStream *self = DM_RANGE_INPUT_STREAM (stream);
+
+  goffset remaining = self->length - self->position;
+  if (remaining <= 0)
+    return 0;
+
+  if (self->needs_seek)
+    {
+      if (!g_seekable_seek (G_SEEKABLE (self->base_stream),
+                            self->start + self->position, G_SEEK_SET,
+                            cancellable, error))
+        return -1;
+      self->needs_seek = FALSE;
+    }
+
+  gssize n_read = g_input_stream_read (self->base_stream, buffer,
+                                       MIN (count, (gsize) remaining),
+                                       cancellable, error);
+  if (n_read > 0)
+    self->position += n_read;
+
+  return n_read;
+}
+
+static gssize
+dm_range_input_stream_skip (GInputStream *stream,
+                            gsize count,
+                            G_GNUC_UNUSED GCancellable *cancellable,
+                            G_GNUC_UNUSED GError **error)
+{
+  DmRangeInputStream *self = DM_RANGE_INPUT_STREAM (stream);
+
+  goffset skipped = MIN ((goffset) count, self->length - self->position);
+  self->position += skipped;
+  self->needs_seek = TRUE;
+
+  return skipped;
+}
+
+static gboolean
+dm_range_input_stream_close (GInputStream *stream,
+                             GCancellable *cancellable,
+                             GError **error)
+{
+  DmRangeInputStream *self = DM_RANGE_INPUT_STREAM (stream);
+
+  return g_input_stream_close (self->base_stream, cancellable, error);
+}
+
+static goffset
+dm_range_input_stream_tell (GSeekable *seekable)
+{
+  return DM_RANGE_INPUT_STREAM (seekable)->position;
+}
+
+static gboolean
+dm_range_input_stream_can_seek (G_GNUC_UNUSED GSeekable *seekable)
+{
+  return TRUE;
+}
+
+static gboolean
+dm_range_input_stream_seek (GSeekable *seekable,
+                            goffset offset,
+                            GSeekType type,
+                            G_GNUC_UNUSED GCancellable *cancellable,
+                            GError **error)
+{
+  DmRangeInputStream *self = DM_RANGE_INPUT_STREAM (seekable);
+  goffset position;
+
+  switch (type)
+    {
+    case G_SEEK_SET:
+      position = offset;
+      break;
+    case G_SEEK_CUR:
+      position = self->position + offset;
+      break;
+    case G_SEEK_END:
+      position = self->length + offset;
+      break;
+    default:
+      g_assert_not_reached ();
+    }
+
+  if (position < 0 || position > self->length)
+    {
+      g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT,
+                           "Invalid seek request");
+      return FALSE;
+    }
+
+  self->position = position;
+  self->needs_seek = TRUE;
+
+  return TRUE;
+}
+
+static gboolean
+dm_range_input_stream_can_truncate (G_GNUC_UNUSED GSeekable *seekable)
+{
+  return FALSE;
+}
+
+static gboolean
+dm_range_input_stream_truncate (G_GNUC_UNUSED GSeekable *seekable,
+                                G_GNUC_UNUSED goffset offset,
+                                G_GNUC_UNUSED GCancellable *cancellable,
+                                GError **error)
+{
+  g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED,
+                       "Cannot truncate a read-only stream");
+  return FALSE;
+}
+
+static void
+dm_range_input_stream_class_init (DmRangeInputStreamClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+  GInputStreamClass *input_stream_class = G_INPUT_STREAM_CLASS (klass);
+
+  object_class->finalize = dm_range_input_stream_finalize;
+
+  input_stream_class->read_fn = dm_range_input_stream_read;
+  input_stream_class->skip = dm_range_input_stream_skip;
+  input_stream_class->close_fn = dm_range_input_stream_close;
+}
+
+static void
+dm_range_input_stream_seekable_iface_init (GSeekableIface *iface)
+{
+  iface->tell = dm_range_input_stream_tell;
+  iface->can_seek = dm_range_input_stream_can_seek;
+  iface->seek = dm_range_input_stream_seek;
+  iface->can_truncate = dm_range_input_stream_can_truncate;
+  iface->truncate_fn = dm_range_input_stream_truncate;
+}
+
+static void
+dm_range_input_stream_init (DmRangeInputStream *self)
+{
+  self->needs_seek = TRUE;
+}
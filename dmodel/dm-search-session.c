@@ -0,0 +1,594 @@
+/* Copyright 2020 Endless Mobile, Inc. */
+
+#include "dm-search-session.h"
+
+#include "dm-domain-private.h"
+#include "dm-query-private.h"
+
+#include <endless/endless.h>
+#include <string.h>
+
+#define DEFAULT_MAX_CANDIDATES 200
+#define MAX_FIXED_QUERIES 64
+
+/**
+ * SECTION:search-session
+ * @title: Search Session
+ * @short_description: Type-ahead search that reuses work between keystrokes
+ *
+ * A #DmSearchSession runs a search each time the user changes the search
+ * terms, for example on every keystroke in a search box, and is cheaper
+ * than running an unrelated #DmQuery each time:
+ *
+ * - Starting a search cancels the one still in progress, whose callback
+ *   receives %G_IO_ERROR_CANCELLED right away.
+ * - Spelling and stop word corrections are remembered for the search terms
+ *   already seen in the session, for example when deleting characters.
+ * - When the new terms only extend the last of the previous ones, for
+ *   example by typing another letter, the new matches can only be among the
+ *   previous ones. If the session knows all of those (see
+ *   #DmSearchSession:max-candidates), it restricts the search to them.
+ *
+ * All other properties of the searches, such as tags, sorting and
+ * pagination, come from the #DmSearchSession:query given at construction.
+ *
+ * Since: 0.2
+ */
+struct _DmSearchSession
+{
+  GObject parent_instance;
+
+  DmDomain *domain;
+  DmQuery *query;
+
+  /* Protects everything below */
+  GMutex lock;
+
+  guint max_candidates;
+
+  GCancellable *current_cancellable;
+  guint64 generation;
+
+  /* Terms of the last search that finished, if it had no spelling
+   * correction, and the URIs of all its matches, if they are known.
+   */
+  char **last_terms;
+  char **candidates;
+
+  /* search terms => DmQuery, the query fixed for those terms */
+  GHashTable *fixed_queries;
+};
+
+G_DEFINE_TYPE (DmSearchSession, dm_search_session, G_TYPE_OBJECT)
+
+enum {
+  PROP_0,
+  PROP_DOMAIN,
+  PROP_QUERY,
+  PROP_MAX_CANDIDATES,
+  NPROPS
+};
+
+static GParamSpec *dm_search_session_props[NPROPS] = { NULL, };
+
+static void
+dm_search_session_get_property (GObject *object,
+                                guint prop_id,
+                                GValue *value,
+                                GParamSpec *pspec)
+{
+  DmSearchSession *self = DM_SEARCH_SESSION (object);
+
+  switch (prop_id)
+    {
+    case PROP_DOMAIN:
+      g_value_set_object (value, self->domain);
+      break;
+
+    case PROP_QUERY:
+      g_value_set_object (value, self->query);
+      break;
+
+    case PROP_MAX_CANDIDATES:
+      g_mutex_lock (&self->lock);
+      g_value_set_uint (value, self->max_candidates);
+      g_mutex_unlock (&self->lock);
+      break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+    }
+}
+
+static void
+dm_search_session_set_property (GObject *object,
+                                guint prop_id,
+                                const GValue *value,
+                                GParamSpec *pspec)
+{
+  DmSearchSession *self = DM_SEARCH_SESSION (object);
+
+  switch (prop_id)
+    {
+    case PROP_DOMAIN:
+      g_assert (self->domain == NULL);
+      self->domain = g_value_dup_object (value);
+      break;
+
+    case PROP_QUERY:
+      g_assert (self->query == NULL);
+      self->query = g_value_dup_object (value);
+      break;
+
+    case PROP_MAX_CANDIDATES:
+      g_mutex_lock (&self->lock);
+      self->max_candidates = g_value_get_uint (value);
+      g_mutex_unlock (&self->lock);
+      break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+    }
+}
+
+static void
+dm_search_session_constructed (GObject *object)
+{
+  DmSearchSession *self = DM_SEARCH_SESSION (object);
+
+  G_OBJECT_CLASS (dm_search_session_parent_class)->constructed (object);
+
+  if (self->query == NULL)
+    self->query = g_object_new (DM_TYPE_QUERY, NULL);
+}
+
+static void
+dm_search_session_finalize (GObject *object)
+{
+  DmSearchSession *self = DM_SEARCH_SESSION (object);
+
+  g_clear_object (&self->domain);
+  g_clear_object (&self->query);
+  g_clear_object (&self->current_cancellable);
+  g_clear_pointer (&self->last_terms, g_strfreev);
+  g_clear_pointer (&self->candidates, g_strfreev);
+  g_clear_pointer (&self->fixed_queries, g_hash_table_unref);
+  g_mutex_clear (&self->lock);
+
+  G_OBJECT_CLASS (dm_search_session_parent_class)->finalize (object);
+}
+
+static void
+dm_search_session_class_init (DmSearchSessionClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->get_property = dm_search_session_get_property;
+  object_class->set_property = dm_search_session_set_property;
+  object_class->constructed = dm_search_session_constructed;
+  object_class->finalize = dm_search_session_finalize;
+
+  /**
+   * DmSearchSession:domain:
+   *
+   * The domain whose content is being searched.
+   *
+   * Since: 0.2
+   */
+  dm_search_session_props[PROP_DOMAIN] =
+    g_param_spec_object ("domain", "Domain",
+      "Domain whose content is being searched",
+      DM_TYPE_DOMAIN,
+      G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY | G_PARAM_STATIC_STRINGS);
+
+  /**
+   * DmSearchSession:query:
+   *
+   * The query that every search in the session is based on. Its
+   * #DmQuery:search-terms are replaced by the terms passed to
+   * dm_search_session_search(). If not set, a default #DmQuery is used.
+   *
+   * Since: 0.2
+   */
+  dm_search_session_props[PROP_QUERY] =
+    g_param_spec_object ("query", "Query",
+      "Query that every search in the session is based on",
+      DM_TYPE_QUERY,
+      G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY | G_PARAM_STATIC_STRINGS);
+
+  /**
+   * DmSearchSession:max-candidates:
+   *
+   * Each search reads up to this many matches, even if the
+   * #DmQuery:limit of the query is smaller, so that the session knows all
+   * the matches of searches that have fewer of them, and can restrict the
+   * following searches to them. Set to 0 to turn that off.
+   *
+   * Since: 0.2
+   */
+  dm_search_session_props[PROP_MAX_CANDIDATES] =
+    g_param_spec_uint ("max-candidates", "Maximum candidates",
+      "Maximum number of matches to remember between searches",
+      0, G_MAXUINT, DEFAULT_MAX_CANDIDATES,
+      G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+
+  g_object_class_install_properties (object_class, NPROPS,
+                                     dm_search_session_props);
+}
+
+static void
+dm_search_session_init (DmSearchSession *self)
+{
+  g_mutex_init (&self->lock);
+
+  self->max_candidates = DEFAULT_MAX_CANDIDATES;
+  self->fixed_queries = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                               g_free, g_object_unref);
+}
+
+/**
+ * dm_search_session_new:
+ * @domain: the domain to search
+ * @query: (nullable): the query to base searches on, or %NULL
+ *
+ * Creates a new search session. See #DmSearchSession:query.
+ *
+ * Returns: (transfer full): a new #DmSearchSession
+ *
+ * Since: 0.2
+ */
+DmSearchSession *
+dm_search_session_new (DmDomain *domain,
+                       DmQuery *query)
+{
+  g_return_val_if_fail (DM_IS_DOMAIN (domain), NULL);
+  g_return_val_if_fail (query == NULL || DM_IS_QUERY (query), NULL);
+
+  return g_object_new (DM_TYPE_SEARCH_SESSION,
+                       "domain", domain,
+                       "query", query,
+                       NULL);
+}
+
+typedef struct
+{
+  char *search_terms;
+  guint64 generation;
+
+  GCancellable *caller_cancellable;
+  gulong cancelled_id;
+} SearchData;
+
+static void
+search_data_free (gpointer data)
+{
+  SearchData *search = data;
+
+  if (search->caller_cancellable != NULL)
+    g_cancellable_disconnect (search->caller_cancellable, search->cancelled_id);
+  g_clear_object (&search->caller_cancellable);
+  g_free (search->search_terms);
+
+  g_slice_free (SearchData, search);
+}
+
+/* Whether every document matching @new_terms also matches @old_terms, which
+ * is the case when the new terms only extend the last of the old ones, since
+ * the last term matches as a prefix. Adding terms is not enough: the old last
+ * term then stops being a prefix and is stemmed instead, so "generalization"
+ * followed by another term matches "general", which the prefix "generaliz"
+ * did not. Neither list may have had stop words removed, see search_task().
+ */
+static gboolean
+terms_narrow (char **old_terms,
+              char **new_terms)
+{
+  guint n_old = g_strv_length (old_terms);
+  guint n_new = g_strv_length (new_terms);
+
+  if (n_old == 0 || n_new != n_old)
+    return FALSE;
+
+  /* A single character only matches exact titles, so it can't be narrowed */
+  if (n_old == 1 && g_utf8_strlen (old_terms[0], -1) == 1)
+    return FALSE;
+
+  for (guint i = 0; i < n_old - 1; i++)
+    {
+      if (strcmp (old_terms[i], new_terms[i]) != 0)
+        return FALSE;
+    }
+
+  return g_str_has_prefix (new_terms[n_old - 1], old_terms[n_old - 1]);
+}
+
+/* Returns the session query for @search_terms, with spelling and stop word
+ * corrections, remembering them for the rest of the session.
+ */
+static DmQuery *
+dm_search_session_get_fixed_query (DmSearchSession *self,
+                                   const char *search_terms,
+                                   GError **error)
+{
+  g_mutex_lock (&self->lock);
+  DmQuery *fixed_query = g_hash_table_lookup (self->fixed_queries, search_terms);
+  if (fixed_query != NULL)
+    g_object_ref (fixed_query);
+  g_mutex_unlock (&self->lock);
+
+  if (fixed_query != NULL)
+    return fixed_query;
+
+  g_autoptr(DmQuery) query = dm_query_new_from_object (self->query,
+                                                       "search-terms", search_terms,
+                                                       NULL);
+  if (*search_terms == '\0')
+    return g_steal_pointer (&query);
+
+  fixed_query = dm_domain_fix_query_sync (self->domain, query, error);
+  if (fixed_query == NULL)
+    return NULL;
+
+  g_mutex_lock (&self->lock);
+  if (g_hash_table_size (self->fixed_queries) >= MAX_FIXED_QUERIES)
+    g_hash_table_remove_all (self->fixed_queries);
+  g_hash_table_insert (self->fixed_queries, g_strdup (search_terms),
+                       g_object_ref (fixed_query));
+  g_mutex_unlock (&self->lock);
+
+  return fixed_query;
+}
+
+static void
+search_task (GTask *task,
+             gpointer source_object,
+             gpointer task_data,
+             GCancellable *cancellable)
+{
+  DmSearchSession *self = source_object;
+  SearchData *search = task_data;
+  GError *error = NULL;
+
+  g_autoptr(EosProfileProbe) probe = EOS_PROFILE_PROBE ("/dmodel/search-session");
+
+  if (g_task_return_error_if_cancelled (task))
+    return;
+
+  g_autoptr(DmQuery) query = dm_search_session_get_fixed_query (self,
+                                                                search->search_terms,
+                                                                &error);
+  if (query == NULL)
+    {
+      g_task_return_error (task, error);
+      return;
+    }
+
+  if (g_task_return_error_if_cancelled (task))
+    return;
+
+  g_autofree char *corrected_terms = NULL;
+  g_autofree char *stopword_free_terms = NULL;
+  g_autofree char *literal_query = NULL;
+  g_object_get (query,
+                "corrected-terms", &corrected_terms,
+                "stopword-free-terms", &stopword_free_terms,
+                "literal-query", &literal_query,
+                NULL);
+
+  /* Spelling corrections add alternatives, so only searches without them
+   * can be narrowed down or narrow down the next one.
+   */
+  g_auto(GStrv) terms = NULL;
+  if (*search->search_terms != '\0' && literal_query == NULL &&
+      (corrected_terms == NULL || *corrected_terms == '\0'))
+    terms = dm_query_split_terms (search->search_terms);
+
+  /* Neither can searches with stop words: the parser keeps a stop word as
+   * the last term, which is matched as a prefix, but drops it once another
+   * term follows, so "the foo" matches documents that "the" did not.
+   */
+  if (terms != NULL && stopword_free_terms != NULL)
+    {
+      g_auto(GStrv) kept_terms = dm_query_split_terms (stopword_free_terms);
+      if (g_strv_length (kept_terms) != g_strv_length (terms))
+        g_clear_pointer (&terms, g_strfreev);
+    }
+
+  g_auto(GStrv) candidates = NULL;
+  g_mutex_lock (&self->lock);
+  if (terms != NULL && self->last_terms != NULL && self->candidates != NULL &&
+      terms_narrow (self->last_terms, terms))
+    candidates = g_strdupv (self->candidates);
+  guint max_candidates = self->max_candidates;
+  g_mutex_unlock (&self->lock);
+
+  guint offset = dm_query_get_offset (query);
+  guint limit = dm_query_get_limit (query);
+
+  g_autoptr(GPtrArray) uris = NULL;
+  int upper_bound = 0;
+
+  if (candidates != NULL && *candidates == NULL)
+    {
+      /* Nothing matched before, so nothing can match now */
+      uris = g_ptr_array_new_with_free_func (g_free);
+    }
+  else
+    {
+      /* Read from the first match on, so that we know all matches if there
+       * are few of them
+       */
+      guint wanted = limit > G_MAXUINT - offset ? G_MAXUINT : offset + limit;
+      g_autoptr(DmQuery) run_query =
+        dm_query_new_from_object (query,
+                                  "offset", 0,
+                                  "limit", MAX (wanted, max_candidates),
+                                  NULL);
+      if (candidates != NULL)
+        g_object_set (run_query, "ids", candidates, NULL);
+
+      uris = dm_domain_run_query (self->domain, run_query, &upper_bound, &error);
+      if (uris == NULL)
+        {
+          g_task_return_error (task, error);
+          return;
+        }
+    }
+
+  /* Only documents with an object ID can be searched for by ID */
+  gboolean complete = uris->len >= (guint) MAX (upper_bound, 0);
+  for (guint i = 0; complete && i < uris->len; i++)
+    complete = g_str_has_prefix (g_ptr_array_index (uris, i), "ekn://");
+
+  g_mutex_lock (&self->lock);
+  if (search->generation == self->generation)
+    {
+      g_clear_pointer (&self->last_terms, g_strfreev);
+      g_clear_pointer (&self->candidates, g_strfreev);
+
+      self->last_terms = g_steal_pointer (&terms);
+      if (complete)
+        {
+          self->candidates = g_new0 (char *, uris->len + 1);
+          for (guint i = 0; i < uris->len; i++)
+            self->candidates[i] = g_strdup (g_ptr_array_index (uris, i));
+        }
+    }
+  g_mutex_unlock (&self->lock);
+
+  if (g_task_return_error_if_cancelled (task))
+    return;
+
+  g_autoptr(GPtrArray) page = g_ptr_array_new_with_free_func (g_free);
+  for (guint i = offset; i < uris->len && i - offset < limit; i++)
+    g_ptr_array_add (page, g_strdup (g_ptr_array_index (uris, i)));
+
+  GSList *models = NULL;
+  const char * const *fields = (const char * const *) dm_query_get_fields (query);
+
+  if (!dm_domain_get_objects_sync (self->domain, page, fields, &models,
+                                   cancellable, &error))
+    {
+      g_task_return_error (task, error);
+      return;
+    }
+
+  DmQueryResults *results = g_object_new (DM_TYPE_QUERY_RESULTS,
+                                          "upper-bound", upper_bound,
+                                          "models", models,
+                                          NULL);
+
+  g_slist_free_full (models, g_object_unref);
+
+  g_task_return_pointer (task, results, g_object_unref);
+}
+
+static void
+on_caller_cancelled (G_GNUC_UNUSED GCancellable *caller_cancellable,
+                     gpointer user_data)
+{
+  g_cancellable_cancel (G_CANCELLABLE (user_data));
+}
+
+/**
+ * dm_search_session_search:
+ * @self: the search session
+ * @search_terms: the search terms, as typed in by the user
+ * @cancellable: (allow-none): optional #GCancellable object, %NULL to ignore.
+ * @callback: (scope async): callback to call when the request is satisfied.
+ * @user_data: (closure): the data to pass to callback function.
+ *
+ * Asynchronously searches for @search_terms, cancelling the previous search
+ * of the session if it is still in progress.
+ *
+ * Since: 0.2
+ */
+void
+dm_search_session_search (DmSearchSession *self,
+                          const char *search_terms,
+                          GCancellable *cancellable,
+                          GAsyncReadyCallback callback,
+                          gpointer user_data)
+{
+  g_return_if_fail (DM_IS_SEARCH_SESSION (self));
+  g_return_if_fail (search_terms != NULL);
+  g_return_if_fail (G_IS_CANCELLABLE (cancellable) || cancellable == NULL);
+
+  g_autoptr(GCancellable) search_cancellable = g_cancellable_new ();
+
+  g_mutex_lock (&self->lock);
+  g_autoptr(GCancellable) superseded = g_steal_pointer (&self->current_cancellable);
+  self->current_cancellable = g_object_ref (search_cancellable);
+  guint64 generation = ++self->generation;
+  g_mutex_unlock (&self->lock);
+
+  if (superseded != NULL)
+    g_cancellable_cancel (superseded);
+
+  SearchData *search = g_slice_new0 (SearchData);
+  search->search_terms = g_strdup (search_terms);
+  search->generation = generation;
+
+  if (cancellable != NULL)
+    {
+      search->caller_cancellable = g_object_ref (cancellable);
+      search->cancelled_id = g_cancellable_connect (cancellable,
+                                                    G_CALLBACK (on_caller_cancelled),
+                                                    g_object_ref (search_cancellable),
+                                                    g_object_unref);
+    }
+
+  g_autoptr(GTask) task = g_task_new (self, search_cancellable, callback, user_data);
+  g_task_set_source_tag (task, dm_search_session_search);
+  g_task_set_task_data (task, search, search_data_free);
+  g_task_set_return_on_cancel (task, TRUE);
+
+  g_task_run_in_thread (task, search_task);
+}
+
+/**
+ * dm_search_session_search_finish:
+ * @self: the search session
+ * @result: the #GAsyncResult that was provided to the callback.
+ * @error: #GError for error reporting.
+ *
+ * Finishes a dm_search_session_search() call. If another search was started
+ * before this one finished, this throws %G_IO_ERROR_CANCELLED.
+ *
+ * Returns: (transfer full): the results object
+ *
+ * Since: 0.2
+ */
+DmQueryResults *
+dm_search_session_search_finish (DmSearchSession *self,
+                                 GAsyncResult *result,
+                                 GError **error)
+{
+  g_return_val_if_fail (DM_IS_SEARCH_SESSION (self), NULL);
+  g_return_val_if_fail (g_task_is_valid (result, self), NULL);
+
+  return g_task_propagate_pointer (G_TASK (result), error);
+}
+
+/**
+ * dm_search_session_cancel:
+ * @self: the search session
+ *
+ * Cancels the search in progress, if any, for example when the user closes
+ * the search box.
+ *
+ * Since: 0.2
+ */
+void
+dm_search_session_cancel (DmSearchSession *self)
+{
+  g_return_if_fail (DM_IS_SEARCH_SESSION (self));
+
+  g_mutex_lock (&self->lock);
+  g_autoptr(GCancellable) current = g_steal_pointer (&self->current_cancellable);
+  self->generation++;
+  g_mutex_unlock (&self->lock);
+
+  if (current != NULL)
+    g_cancellable_cancel (current);
+}
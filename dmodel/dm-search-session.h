@@ -0,0 +1,43 @@
+/* Copyright 2020 Endless Mobile, Inc. */
+
+#pragma once
+
+#include <gio/gio.h>
+
+#include "dm-domain.h"
+#include "dm-macros.h"
+#include "dm-query.h"
+#include "dm-query-results.h"
+
+G_BEGIN_DECLS
+
+#define DM_TYPE_SEARCH_SESSION dm_search_session_get_type ()
+
+DM_AVAILABLE_IN_0_2
+G_DECLARE_FINAL_TYPE (DmSearchSession, dm_search_session, DM, SEARCH_SESSION,
+                      GObject)
+
+DM_AVAILABLE_IN_0_2
+DmSearchSession *
+dm_search_session_new (DmDomain *domain,
+                       DmQuery *query);
+
+DM_AVAILABLE_IN_0_2
+void
+dm_search_session_search (DmSearchSession *self,
+                          const char *search_terms,
+                          GCancellable *cancellable,
+                          GAsyncReadyCallback callback,
+                          gpointer user_data);
+
+DM_AVAILABLE_IN_0_2
+DmQueryResults *
+dm_search_session_search_finish (DmSearchSession *self,
+                                 GAsyncResult *result,
+                                 GError **error);
+
+DM_AVAILABLE_IN_0_2
+void
+dm_search_session_cancel (DmSearchSession *self);
+
+G_END_DECLS
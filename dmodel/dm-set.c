@@ -2,6 +2,7 @@
 
 #include "dm-set.h"
 
+#include "dm-base-private.h"
 #include "dm-utils-private.h"
 #include "dm-content-private.h"
 
@@ -116,26 +117,22 @@ dm_set_init (G_GNUC_UNUSED DmSet *self)
 {
 }
 
-static void
-dm_set_add_json_to_params (JsonNode *node,
-                           GArray *params)
+static gpointer
+dm_set_get_private (gpointer self)
 {
-  if (!JSON_NODE_HOLDS_OBJECT (node))
-    {
-      g_critical ("Trying to instantiate a DmSet from a non json object.");
-      return;
-    }
-
-  dm_content_add_json_to_params (node, params);
+  return dm_set_get_instance_private (self);
+}
 
-  JsonObject *object = json_node_get_object (node);
-  GObjectClass *klass = g_type_class_ref (DM_TYPE_SET);
+static const DmJsonField set_fields[] = {
+  DM_JSON_FIELD ("childTags", "child-tags", STRV, DmSetPrivate, child_tags),
+};
 
-  dm_utils_append_gparam_from_json_node (json_object_get_member (object, "childTags"),
-                                         g_object_class_find_property (klass, "child-tags"),
-                                         params);
-  g_type_class_unref (klass);
-}
+const DmJsonFieldTable dm_set_json_fields = {
+  &dm_content_json_fields,
+  dm_set_get_private,
+  set_fields,
+  G_N_ELEMENTS (set_fields),
+};
 
 /**
  * dm_set_get_child_tags:
@@ -168,13 +165,6 @@ dm_set_new_from_json_node (JsonNode *node)
 {
   g_autoptr(EosProfileProbe) probe = EOS_PROFILE_PROBE ("/dmodel/object/set");
 
-G_GNUC_BEGIN_IGNORE_DEPRECATIONS
-  GArray *params = g_array_new (FALSE, TRUE, sizeof (GParameter));
-  dm_set_add_json_to_params (node, params);
-  DmSet *model = g_object_newv (DM_TYPE_SET, params->len,
-                                (GParameter *)params->data);
-  dm_utils_free_gparam_array (params);
-G_GNUC_END_IGNORE_DEPRECATIONS
-
-  return DM_CONTENT (model);
+  return dm_utils_new_model_from_json_node (DM_TYPE_SET,
+                                            &dm_set_json_fields, node);
 }
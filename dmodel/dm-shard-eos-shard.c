@@ -29,6 +29,8 @@ struct _DmShardEosShard {
   DmShard parent_instance;
   EosShardShardFile *shard_file;
   EosShardDictionary *link_table;
+  /* the whole shard file, mapped once the shard file is initialized */
+  GMappedFile *mapped_file;
 };
 
 static void g_async_initable_interface_init (GAsyncInitableIface *iface);
@@ -56,6 +58,7 @@ dm_shard_eos_shard_finalize (GObject *object)
 
   g_clear_pointer (&self->shard_file, g_object_unref);
   g_clear_pointer (&self->link_table, eos_shard_dictionary_unref);
+  g_clear_pointer (&self->mapped_file, g_mapped_file_unref);
 
   G_OBJECT_CLASS (dm_shard_eos_shard_parent_class)->finalize (object);
 }
@@ -85,22 +88,46 @@ dm_shard_eos_shard_find_by_id (DmShard *self,
   return NULL;
 }
 
+static GBytes *
+load_blob_bytes (EosShardBlob *blob,
+                 GCancellable *cancellable,
+                 GError **error)
+{
+  g_autoptr(GInputStream) stream = eos_shard_blob_get_stream (blob);
+  gsize size = eos_shard_blob_get_content_size (blob);
+  g_autofree char *data = g_malloc (size);
+  gsize n_read;
+
+  if (!g_input_stream_read_all (stream, data, size, &n_read, cancellable, error))
+    return NULL;
+
+  return g_bytes_new_take (g_steal_pointer (&data), n_read);
+}
+
 static DmContent *
-dm_shard_eos_shard_get_model (G_GNUC_UNUSED DmShard *self,
-                              DmShardRecord *record,
-                              GCancellable *cancellable,
-                              GError **error)
+dm_shard_eos_shard_get_model_with_fields (G_GNUC_UNUSED DmShard *self,
+                                          DmShardRecord *record,
+                                          const char * const *fields,
+                                          GCancellable *cancellable,
+                                          GError **error)
 {
   EosShardRecord *eos_shard_record = (EosShardRecord *) dm_shard_record_get_native (record);
-  g_autoptr(GInputStream) stream = eos_shard_blob_get_stream (eos_shard_record->metadata);
-
-  g_autoptr(JsonParser) parser = json_parser_new_immutable ();
-  gboolean parse_success =
-    json_parser_load_from_stream (parser, stream, cancellable, error);
-  if (!parse_success)
+  g_autoptr(GBytes) metadata = load_blob_bytes (eos_shard_record->metadata,
+                                                cancellable, error);
+  if (metadata == NULL)
     return NULL;
 
-  return dm_model_from_json_node (json_parser_get_root (parser), error);
+  return dm_model_from_json_bytes (metadata, fields, error);
+}
+
+static DmContent *
+dm_shard_eos_shard_get_model (DmShard *self,
+                              DmShardRecord *record,
+                              GCancellable *cancellable,
+                              GError **error)
+{
+  return dm_shard_eos_shard_get_model_with_fields (self, record, NULL,
+                                                   cancellable, error);
 }
 
 static GInputStream *
@@ -118,6 +145,39 @@ dm_shard_eos_shard_stream_data (G_GNUC_UNUSED DmShard *self,
   return eos_shard_blob_get_stream (blob);
 }
 
+/* Uncompressed blobs are stored as they are in the shard file, so they can
+ * be handed out as a slice of the mapping. Compressed ones, or any blob if the
+ * file couldn't be mapped, are loaded into a new buffer instead. */
+static GBytes *
+dm_shard_eos_shard_get_data_bytes (DmShard *self,
+                                   DmShardRecord *record,
+                                   G_GNUC_UNUSED GCancellable *cancellable,
+                                   GError **error)
+{
+  DmShardEosShard *_self = DM_SHARD_EOS_SHARD (self);
+  EosShardRecord *eos_shard_record = (EosShardRecord *) dm_shard_record_get_native (record);
+  EosShardBlob *blob = eos_shard_record->data;
+
+  if (!blob)
+    return NULL;
+
+  if (_self->mapped_file != NULL &&
+      !(eos_shard_blob_get_flags (blob) & EOS_SHARD_BLOB_FLAG_COMPRESSED_ZLIB))
+    {
+      gsize offset = eos_shard_blob_get_offset (blob);
+      gsize size = eos_shard_blob_get_content_size (blob);
+      gsize length = g_mapped_file_get_length (_self->mapped_file);
+
+      if (offset <= length && size <= length - offset)
+        {
+          g_autoptr(GBytes) bytes = g_mapped_file_get_bytes (_self->mapped_file);
+          return g_bytes_new_from_bytes (bytes, offset, size);
+        }
+    }
+
+  return eos_shard_blob_load_contents (blob, error);
+}
+
 static gsize
 dm_shard_eos_shard_get_data_size (G_GNUC_UNUSED DmShard *self,
                                   DmShardRecord *record)
@@ -168,6 +228,10 @@ dm_shard_eos_shard_init_callback (GObject *source_object,
       if (record)
         self->link_table = eos_shard_blob_load_as_dictionary (record->data, NULL);
 
+      /* Not being able to map the file only means data gets copied */
+      self->mapped_file = g_mapped_file_new (dm_shard_get_path (DM_SHARD (self)),
+                                             FALSE, NULL);
+
       g_task_return_boolean (task, TRUE);
     }
   else
@@ -218,8 +282,10 @@ dm_shard_eos_shard_class_init (DmShardEosShardClass *klass)
 
   dm_shard_class->find_by_id = dm_shard_eos_shard_find_by_id;
   dm_shard_class->get_model = dm_shard_eos_shard_get_model;
+  dm_shard_class->get_model_with_fields = dm_shard_eos_shard_get_model_with_fields;
   dm_shard_class->stream_data = dm_shard_eos_shard_stream_data;
   dm_shard_class->get_data_size = dm_shard_eos_shard_get_data_size;
+  dm_shard_class->get_data_bytes = dm_shard_eos_shard_get_data_bytes;
   dm_shard_class->test_link = dm_shard_eos_shard_test_link;
 
   GObjectClass *object_class = G_OBJECT_CLASS (klass);
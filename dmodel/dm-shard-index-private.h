@@ -0,0 +1,30 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+
+/* Copyright 2020 Endless Mobile, Inc. */
+
+#pragma once
+
+#include "dm-shard.h"
+
+G_BEGIN_DECLS
+
+typedef struct _DmShardIndex DmShardIndex;
+
+DmShardIndex *
+dm_shard_index_new (GSList *shards);
+
+void
+dm_shard_index_free (DmShardIndex *index);
+
+DmShardRecord *
+dm_shard_index_find_by_id (DmShardIndex *index,
+                           const char *object_id);
+
+gchar *
+dm_shard_index_test_link (DmShardIndex *index,
+                          const gchar *link,
+                          GError **error);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (DmShardIndex, dm_shard_index_free)
+
+G_END_DECLS
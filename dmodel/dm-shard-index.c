@@ -0,0 +1,191 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+
+/* Copyright 2020 Endless Mobile, Inc. */
+
+#include "dm-shard-index-private.h"
+
+/* Shards have no cheap way to enumerate the objects they contain, so the
+ * index is filled in lazily: the first lookup of an ID probes every shard,
+ * and remembers which one owns it (or that none does). Later lookups go
+ * straight to the owning shard.
+ *
+ * The set of shards is fixed for the lifetime of the index, so entries never
+ * go stale; the tables are simply emptied when they grow too large.
+ */
+#define MAX_INDEX_ENTRIES 16384
+
+/* Marks IDs and links known not to be in any shard */
+#define NOT_FOUND ((gpointer) &not_found_marker)
+static const char not_found_marker = 0;
+
+struct _DmShardIndex
+{
+  GSList *shards;
+
+  GRWLock lock;
+  /* object ID => owning DmShard, or NOT_FOUND */
+  GHashTable *owners;
+  /* link => object URI, or NOT_FOUND */
+  GHashTable *links;
+};
+
+static void
+link_value_free (gpointer value)
+{
+  if (value != NOT_FOUND)
+    g_free (value);
+}
+
+/*< private >
+ * dm_shard_index_new:
+ * @shards: (element-type DmShard): the shards to index
+ *
+ * Creates an index to look up records in a set of shards.
+ *
+ * Returns: (transfer full): a new #DmShardIndex
+ */
+DmShardIndex *
+dm_shard_index_new (GSList *shards)
+{
+  DmShardIndex *index = g_slice_new0 (DmShardIndex);
+
+  index->shards = g_slist_copy_deep (shards, (GCopyFunc) g_object_ref, NULL);
+
+  g_rw_lock_init (&index->lock);
+  index->owners = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+  index->links = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+                                        link_value_free);
+
+  return index;
+}
+
+void
+dm_shard_index_free (DmShardIndex *index)
+{
+  g_return_if_fail (index != NULL);
+
+  g_clear_pointer (&index->owners, g_hash_table_unref);
+  g_clear_pointer (&index->links, g_hash_table_unref);
+  g_rw_lock_clear (&index->lock);
+
+  g_slist_free_full (index->shards, g_object_unref);
+
+  g_slice_free (DmShardIndex, index);
+}
+
+static void
+index_insert (DmShardIndex *index,
+              GHashTable *table,
+              const char *key,
+              gpointer value,
+              GDestroyNotify value_free)
+{
+  g_rw_lock_writer_lock (&index->lock);
+
+  /* Another thread may have got there first, with the same answer */
+  if (g_hash_table_contains (table, key))
+    {
+      g_rw_lock_writer_unlock (&index->lock);
+
+      if (value_free != NULL)
+        value_free (value);
+      return;
+    }
+
+  if (g_hash_table_size (table) >= MAX_INDEX_ENTRIES)
+    g_hash_table_remove_all (table);
+
+  g_hash_table_insert (table, g_strdup (key), value);
+
+  g_rw_lock_writer_unlock (&index->lock);
+}
+
+/*< private >
+ * dm_shard_index_find_by_id:
+ * @index: the index
+ * @object_id: the object ID to look for
+ *
+ * Finds the record for @object_id in whichever shard holds it.
+ *
+ * Returns: (transfer full) (nullable): the record, or %NULL if no shard has it
+ */
+DmShardRecord *
+dm_shard_index_find_by_id (DmShardIndex *index,
+                           const char *object_id)
+{
+  g_return_val_if_fail (index != NULL, NULL);
+  g_return_val_if_fail (object_id != NULL, NULL);
+
+  g_rw_lock_reader_lock (&index->lock);
+  DmShard *owner = g_hash_table_lookup (index->owners, object_id);
+  g_rw_lock_reader_unlock (&index->lock);
+
+  if (owner == NOT_FOUND)
+    return NULL;
+
+  if (owner != NULL)
+    return dm_shard_find_by_id (owner, object_id);
+
+  DmShardRecord *record = NULL;
+  for (GSList *l = index->shards; l && !record; l = g_slist_next (l))
+    record = dm_shard_find_by_id (l->data, object_id);
+
+  index_insert (index, index->owners, object_id,
+                record ? (gpointer) dm_shard_record_get_shard (record) : NOT_FOUND,
+                NULL);
+
+  return record;
+}
+
+/*< private >
+ * dm_shard_index_test_link:
+ * @index: the index
+ * @link: the link to test
+ * @error: return location for an error, or %NULL
+ *
+ * Looks up @link in the link tables of every shard that has one.
+ *
+ * Returns: (transfer full) (nullable): the object URI matching the link, or
+ *   %NULL if there is none or on error
+ */
+gchar *
+dm_shard_index_test_link (DmShardIndex *index,
+                          const gchar *link,
+                          GError **error)
+{
+  g_return_val_if_fail (index != NULL, NULL);
+  g_return_val_if_fail (link != NULL, NULL);
+
+  gchar *object_uri = NULL;
+
+  g_rw_lock_reader_lock (&index->lock);
+  gpointer cached = g_hash_table_lookup (index->links, link);
+  if (cached != NULL && cached != NOT_FOUND)
+    object_uri = g_strdup (cached);
+  g_rw_lock_reader_unlock (&index->lock);
+
+  if (cached != NULL)
+    return object_uri;
+
+  for (GSList *l = index->shards; l && !object_uri; l = g_slist_next (l))
+    {
+      GError *internal_error = NULL;
+
+      if (DM_SHARD_GET_CLASS (l->data)->test_link == NULL)
+        continue;
+
+      object_uri = dm_shard_test_link (l->data, link, &internal_error);
+      if (internal_error != NULL)
+        {
+          /* Don't remember failures, they might not happen next time */
+          g_propagate_error (error, internal_error);
+          return NULL;
+        }
+    }
+
+  index_insert (index, index->links, link,
+                object_uri ? g_strdup (object_uri) : NOT_FOUND,
+                link_value_free);
+
+  return object_uri;
+}
@@ -16,4 +16,15 @@ G_DECLARE_FINAL_TYPE (DmShardOpenZim, dm_shard_open_zim, DM, SHARD_OPEN_ZIM, DmS
 
 DmShardOpenZim *dm_shard_open_zim_new (const gchar *path);
 
+void dm_shard_open_zim_set_data_cache_max_bytes (DmShardOpenZim *self,
+                                                 gsize max_bytes);
+
+void dm_shard_open_zim_get_data_cache_stats (DmShardOpenZim *self,
+                                             guint64 *hits,
+                                             guint64 *misses);
+
+void dm_shard_open_zim_get_redirect_cache_stats (DmShardOpenZim *self,
+                                                 guint64 *hits,
+                                                 guint64 *misses);
+
 G_END_DECLS
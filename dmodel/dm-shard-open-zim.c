@@ -5,14 +5,21 @@
 #include <zim-glib-3.0/file.h>
 
 #include "dm-base.h"
+#include "dm-cache-private.h"
 
 #include "dm-shard.h"
 #include "dm-shard-open-zim-private.h"
+#include "dm-range-input-stream-private.h"
 #include "stdio.h"
 
 #define XAPIAN_TITLE_INDEX_URL "X/title/xapian"
 #define XAPIAN_FULLTEXT_INDEX_URL "X/fulltext/xapian"
 
+#define DATA_CACHE_SIZE 64
+#define REDIRECT_CACHE_SIZE 1024
+/* Longer chains than this are most likely loops */
+#define MAX_REDIRECT_CHAIN 8
+
 /**
  * SECTION:shard-open-zim
  * @title: libzim shard implementation
@@ -25,6 +32,11 @@ struct _DmShardOpenZim {
   GObject parent_instance;
   gchar *path;
   ZimFile *zim_file;
+
+  /* "namespace/url" => GBytes of the decompressed data of an article */
+  DmCache *data_cache;
+  /* object ID of a redirect => ZimArticle at the end of its chain */
+  DmCache *redirect_cache;
 };
 
 static void g_async_initable_interface_init (GAsyncInitableIface *iface);
@@ -51,10 +63,61 @@ dm_shard_open_zim_finalize (GObject *object)
   DmShardOpenZim *self = (DmShardOpenZim *)object;
 
   g_clear_pointer (&self->zim_file, g_object_unref);
+  g_clear_pointer (&self->data_cache, dm_cache_free);
+  g_clear_pointer (&self->redirect_cache, dm_cache_free);
 
   G_OBJECT_CLASS (dm_shard_open_zim_parent_class)->finalize (object);
 }
 
+/* The native record of a ZIM shard record. Redirects are resolved once, when
+ * the record is found, instead of on every access to its data; the record
+ * is immutable after that, so it can be used from any thread */
+typedef struct {
+  ZimArticle *article;
+  /* the article the data comes from: the redirect target, or article */
+  ZimArticle *target;
+} ZimRecord;
+
+static void
+zim_record_free (ZimRecord *zim_record)
+{
+  g_clear_object (&zim_record->article);
+  g_clear_object (&zim_record->target);
+
+  g_slice_free (ZimRecord, zim_record);
+}
+
+/* Follows the chain of redirects starting at @article, which was found as
+ * @object_id, to the article that has the data. Links keep going to the
+ * same few popular redirects, so where they lead is remembered. */
+static ZimArticle *
+resolve_redirect (DmShardOpenZim *self,
+                  const char *object_id,
+                  ZimArticle *article)
+{
+  if (!zim_article_is_redirect (article))
+    return g_object_ref (article);
+
+  ZimArticle *target = dm_cache_lookup (self->redirect_cache, object_id);
+  if (target != NULL)
+    return target;
+
+  target = g_object_ref (article);
+  for (guint i = 0; i < MAX_REDIRECT_CHAIN && zim_article_is_redirect (target); i++)
+    {
+      ZimArticle *next = zim_article_get_redirect_article (target);
+      if (next == NULL)
+        break;
+
+      g_object_unref (target);
+      target = next;
+    }
+
+  dm_cache_insert (self->redirect_cache, object_id, target, 0);
+
+  return target;
+}
+
 static DmShardRecord *
 dm_shard_open_zim_find_by_id (DmShard *self,
                               const char *object_id)
@@ -69,7 +132,11 @@ dm_shard_open_zim_find_by_id (DmShard *self,
   if (!zim_article_good (article))
     return NULL;
 
-  return dm_shard_record_new (_self, article, g_object_unref);
+  ZimRecord *zim_record = g_slice_new0 (ZimRecord);
+  zim_record->article = article;
+  zim_record->target = resolve_redirect (_self, object_id, article);
+
+  return dm_shard_record_new (_self, zim_record, (GDestroyNotify) zim_record_free);
 }
 
 static DmContent *
@@ -78,14 +145,11 @@ dm_shard_open_zim_get_model (G_GNUC_UNUSED DmShard *self,
                              G_GNUC_UNUSED GCancellable *cancellable,
                              GError **error)
 {
-  ZimArticle *zim_article = (ZimArticle *) dm_shard_record_get_native (record);
-  ZimArticle *redirect_article = NULL;
+  ZimRecord *zim_record = (ZimRecord *) dm_shard_record_get_native (record);
+  ZimArticle *zim_article = zim_record->article;
   JsonBuilder *builder = json_builder_new ();
   GSList *tags = NULL;
 
-  if (zim_article_is_redirect (zim_article))
-    redirect_article = zim_article_get_redirect_article (zim_article);
-
   json_builder_begin_object (builder);
 
   gchar namespace = zim_article_get_namespace (zim_article);
@@ -119,7 +183,7 @@ dm_shard_open_zim_get_model (G_GNUC_UNUSED DmShard *self,
   json_builder_add_string_value (builder, zim_article_get_title (zim_article));
 
   json_builder_set_member_name (builder, "contentType");
-  json_builder_add_string_value (builder, zim_article_get_mime_type (redirect_article ? redirect_article : zim_article));
+  json_builder_add_string_value (builder, zim_article_get_mime_type (zim_record->target));
 
   json_builder_set_member_name (builder, "isServerTemplated");
   json_builder_add_boolean_value (builder, TRUE);
@@ -133,47 +197,57 @@ dm_shard_open_zim_get_model (G_GNUC_UNUSED DmShard *self,
 
   json_builder_end_object (builder);
 
-  g_clear_object (&redirect_article);
-
   return dm_model_from_json_node (json_builder_get_root (builder), error);
 }
 
 static GInputStream *
-dm_shard_open_zim_stream_data (G_GNUC_UNUSED DmShard *self,
+dm_shard_open_zim_stream_data (DmShard *self,
                                DmShardRecord *record,
-                               G_GNUC_UNUSED GCancellable *cancellable,
-                               G_GNUC_UNUSED GError **error)
+                               GCancellable *cancellable,
+                               GError **error)
 {
-  ZimArticle *zim_article = (ZimArticle *) dm_shard_record_get_native (record);
-  ZimArticle *redirect_article = NULL;
-
-  if (zim_article_is_redirect (zim_article))
-    redirect_article = zim_article_get_redirect_article (zim_article);
+  DmShardOpenZim *_self = DM_SHARD_OPEN_ZIM (self);
+  ZimRecord *zim_record = (ZimRecord *) dm_shard_record_get_native (record);
+  gsize size = zim_article_get_data_size (zim_record->target);
+
+  /* libzim only knows the offset in the file of blobs in uncompressed
+     clusters, which is where media ends up. Those are read from the file as
+     they are asked for, so a large video is never in memory at once; the
+     rest have to be decompressed in one go */
+  gint64 offset = zim_article_get_offset (zim_record->target);
+  if (offset > 0)
+    {
+      g_autoptr(GFile) file = g_file_new_for_path (dm_shard_get_path (self));
+      g_autoptr(GFileInputStream) file_stream = g_file_read (file, cancellable, error);
+      if (file_stream == NULL)
+        return NULL;
 
-  gsize size;
-  const char *data =
-    zim_article_get_data (redirect_article ? redirect_article : zim_article, &size);
+      return dm_range_input_stream_new (G_INPUT_STREAM (file_stream), offset, size);
+    }
 
-  g_clear_object (&redirect_article);
+  /* A page and the styles and images it pulls in are often read more than
+     once in a row, and each read would decompress the cluster again */
+  g_autofree char *key = g_strdup_printf ("%c/%s",
+                                          zim_article_get_namespace (zim_record->target),
+                                          zim_article_get_url (zim_record->target));
+  g_autoptr(GBytes) bytes = dm_cache_lookup (_self->data_cache, key);
+  if (bytes == NULL)
+    {
+      char *data = (char *) zim_article_get_data (zim_record->target, &size);
+      bytes = g_bytes_new_take (data, size);
+      dm_cache_insert (_self->data_cache, key, bytes, size);
+    }
 
-  return g_memory_input_stream_new_from_data (data, size, g_free);
+  return g_memory_input_stream_new_from_bytes (bytes);
 }
 
 static gsize
 dm_shard_open_zim_get_data_size (G_GNUC_UNUSED DmShard *self,
                                  DmShardRecord *record)
 {
-  ZimArticle *zim_article = (ZimArticle *) dm_shard_record_get_native (record);
-  ZimArticle *redirect_article = NULL;
-
-  if (zim_article_is_redirect (zim_article))
-    redirect_article = zim_article_get_redirect_article (zim_article);
-
-  gsize size = zim_article_get_data_size (redirect_article ? redirect_article : zim_article);
-
-  g_clear_object (&redirect_article);
+  ZimRecord *zim_record = (ZimRecord *) dm_shard_record_get_native (record);
 
-  return size;
+  return zim_article_get_data_size (zim_record->target);
 }
 
 static gint64
@@ -193,8 +267,8 @@ dm_shard_open_zim_calculate_db_offset (DmShard *self)
     }
   }
 
-  ZimArticle *zim_article = (ZimArticle *) dm_shard_record_get_native (record);
-  return zim_article_get_offset (zim_article);
+  ZimRecord *zim_record = (ZimRecord *) dm_shard_record_get_native (record);
+  return zim_article_get_offset (zim_record->article);
 }
 
 static void
@@ -250,6 +324,73 @@ g_async_initable_interface_init (GAsyncInitableIface *iface)
 }
 
 static void
-dm_shard_open_zim_init (G_GNUC_UNUSED DmShardOpenZim *self)
+dm_shard_open_zim_init (DmShardOpenZim *self)
+{
+  self->data_cache = dm_cache_new (g_str_hash, g_str_equal,
+                                   (GBoxedCopyFunc) g_strdup, g_free,
+                                   (GBoxedCopyFunc) g_bytes_ref,
+                                   (GDestroyNotify) g_bytes_unref,
+                                   0, 0);
+  self->redirect_cache = dm_cache_new (g_str_hash, g_str_equal,
+                                       (GBoxedCopyFunc) g_strdup, g_free,
+                                       (GBoxedCopyFunc) g_object_ref,
+                                       g_object_unref,
+                                       REDIRECT_CACHE_SIZE, 0);
+}
+
+/*< private >
+ * dm_shard_open_zim_set_data_cache_max_bytes:
+ * @self: the #DmShardOpenZim object
+ * @max_bytes: memory budget for the cache, or 0 to disable it
+ *
+ * Sets how much decompressed article data the shard may keep around, so
+ * that reading the same article again does not need to decompress it.
+ * The cache starts out disabled.
+ */
+void
+dm_shard_open_zim_set_data_cache_max_bytes (DmShardOpenZim *self,
+                                            gsize max_bytes)
+{
+  g_return_if_fail (DM_IS_SHARD_OPEN_ZIM (self));
+
+  dm_cache_set_limits (self->data_cache, max_bytes > 0 ? DATA_CACHE_SIZE : 0,
+                       max_bytes);
+}
+
+/*< private >
+ * dm_shard_open_zim_get_data_cache_stats:
+ * @self: the #DmShardOpenZim object
+ * @hits: (out) (optional): return location for the number of cache hits
+ * @misses: (out) (optional): return location for the number of cache misses
+ *
+ * Gets the number of times compressed article data was read and was, or was
+ * not, already in the shard's data cache.
+ */
+void
+dm_shard_open_zim_get_data_cache_stats (DmShardOpenZim *self,
+                                        guint64 *hits,
+                                        guint64 *misses)
+{
+  g_return_if_fail (DM_IS_SHARD_OPEN_ZIM (self));
+
+  dm_cache_get_stats (self->data_cache, hits, misses, NULL, NULL);
+}
+
+/*< private >
+ * dm_shard_open_zim_get_redirect_cache_stats:
+ * @self: the #DmShardOpenZim object
+ * @hits: (out) (optional): return location for the number of cache hits
+ * @misses: (out) (optional): return location for the number of cache misses
+ *
+ * Gets the number of times a redirect was found and where it leads was, or
+ * was not, already known.
+ */
+void
+dm_shard_open_zim_get_redirect_cache_stats (DmShardOpenZim *self,
+                                            guint64 *hits,
+                                            guint64 *misses)
 {
+  g_return_if_fail (DM_IS_SHARD_OPEN_ZIM (self));
+
+  dm_cache_get_stats (self->redirect_cache, hits, misses, NULL, NULL);
 }
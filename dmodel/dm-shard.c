@@ -3,6 +3,7 @@
 /* Copyright 2020 Endless Mobile, Inc. */
 
 #include "dm-shard.h"
+#include "dm-utils-private.h"
 
 /**
  * SECTION:shard
@@ -174,6 +175,117 @@ dm_shard_get_model (DmShard *self, DmShardRecord *record,
   return klass->get_model (self, record, cancellable, error);
 }
 
+static void
+get_model_thread (GTask *task,
+                  gpointer source_object,
+                  gpointer task_data,
+                  GCancellable *cancellable)
+{
+  DmShardRecord *record = task_data;
+  GError *error = NULL;
+
+  DmContent *model = dm_shard_get_model (DM_SHARD (source_object), record,
+                                         cancellable, &error);
+  if (error != NULL)
+    {
+      g_task_return_error (task, error);
+      return;
+    }
+
+  g_task_return_pointer (task, model, g_object_unref);
+}
+
+/**
+ * dm_shard_get_model_async:
+ * @self: the #DmShard object
+ * @record: the #DmShardRecord belonged by the shard
+ * @io_priority: the I/O priority of the request
+ * @cancellable: (nullable): a #GCancellable
+ * @callback: (scope async): callback to call when the request is satisfied
+ * @user_data: (closure): the data to pass to callback function
+ *
+ * Asynchronously get the #DmContent for a found shard record. The model is
+ * loaded on a pool of threads dedicated to reading content, where requests
+ * with a higher @io_priority are started first.
+ */
+void
+dm_shard_get_model_async (DmShard *self,
+                          DmShardRecord *record,
+                          int io_priority,
+                          GCancellable *cancellable,
+                          GAsyncReadyCallback callback,
+                          gpointer user_data)
+{
+  g_return_if_fail (DM_IS_SHARD (self));
+  g_return_if_fail (record != NULL);
+  g_return_if_fail (G_IS_CANCELLABLE (cancellable) || cancellable == NULL);
+
+  g_autoptr(GTask) task = g_task_new (self, cancellable, callback, user_data);
+  g_task_set_source_tag (task, dm_shard_get_model_async);
+  g_task_set_priority (task, io_priority);
+  g_task_set_task_data (task, dm_shard_record_ref (record),
+                        (GDestroyNotify) dm_shard_record_unref);
+
+  dm_utils_run_io_task (task, get_model_thread);
+}
+
+/**
+ * dm_shard_get_model_finish:
+ * @self: the #DmShard object
+ * @result: the #GAsyncResult that was provided to the callback
+ * @error: (nullable): return location for an error, or %NULL
+ *
+ * Finish a dm_shard_get_model_async() call.
+ *
+ * Returns: (transfer full): The #DmContent representing the content
+ *   of the record.
+ */
+DmContent *
+dm_shard_get_model_finish (DmShard *self,
+                           GAsyncResult *result,
+                           GError **error)
+{
+  g_return_val_if_fail (DM_IS_SHARD (self), NULL);
+  g_return_val_if_fail (g_task_is_valid (result, self), NULL);
+
+  return g_task_propagate_pointer (G_TASK (result), error);
+}
+
+/**
+ * dm_shard_get_model_with_fields:
+ * @self: the #DmShard object
+ * @record: the #DmShardRecord belonged by the shard
+ * @fields: (nullable) (array zero-terminated=1): names of the model
+ *   properties to fill in, or %NULL for all of them
+ * @cancellable: (nullable): a #GCancellable
+ * @error: (nullable): return location for an error, or %NULL
+ *
+ * Like dm_shard_get_model(), but only the properties listed in @fields need
+ * to be filled in; the rest may keep their default values. Shards that
+ * cannot do better than building the complete model fall back to
+ * dm_shard_get_model().
+ *
+ * Returns: (transfer full): The #DmContent representing the content
+ *   of %record.
+ */
+DmContent *
+dm_shard_get_model_with_fields (DmShard *self,
+                                DmShardRecord *record,
+                                const char * const *fields,
+                                GCancellable *cancellable,
+                                GError **error)
+{
+  DmShardClass *klass;
+
+  g_return_val_if_fail (DM_IS_SHARD (self), NULL);
+
+  klass = DM_SHARD_GET_CLASS (self);
+  if (fields == NULL || klass->get_model_with_fields == NULL)
+    return dm_shard_get_model (self, record, cancellable, error);
+
+  return klass->get_model_with_fields (self, record, fields, cancellable, error);
+}
+
 /**
  * dm_shard_stream_data:
  * @self: the #DmShard object
@@ -198,6 +310,81 @@ dm_shard_stream_data (DmShard *self, DmShardRecord *record,
   return klass->stream_data (self, record, cancellable, error);
 }
 
+static void
+stream_data_thread (GTask *task,
+                    gpointer source_object,
+                    gpointer task_data,
+                    GCancellable *cancellable)
+{
+  DmShardRecord *record = task_data;
+  GError *error = NULL;
+
+  GInputStream *stream = dm_shard_stream_data (DM_SHARD (source_object), record,
+                                               cancellable, &error);
+  if (error != NULL)
+    {
+      g_task_return_error (task, error);
+      return;
+    }
+
+  g_task_return_pointer (task, stream, g_object_unref);
+}
+
+/**
+ * dm_shard_stream_data_async:
+ * @self: the #DmShard object
+ * @record: the #DmShardRecord belonged by the shard
+ * @io_priority: the I/O priority of the request
+ * @cancellable: (nullable): a #GCancellable
+ * @callback: (scope async): callback to call when the request is satisfied
+ * @user_data: (closure): the data to pass to callback function
+ *
+ * Asynchronously get a stream to read the record data. The stream is opened
+ * on a pool of threads dedicated to reading content, where requests with a
+ * higher @io_priority are started first.
+ */
+void
+dm_shard_stream_data_async (DmShard *self,
+                            DmShardRecord *record,
+                            int io_priority,
+                            GCancellable *cancellable,
+                            GAsyncReadyCallback callback,
+                            gpointer user_data)
+{
+  g_return_if_fail (DM_IS_SHARD (self));
+  g_return_if_fail (record != NULL);
+  g_return_if_fail (G_IS_CANCELLABLE (cancellable) || cancellable == NULL);
+
+  g_autoptr(GTask) task = g_task_new (self, cancellable, callback, user_data);
+  g_task_set_source_tag (task, dm_shard_stream_data_async);
+  g_task_set_priority (task, io_priority);
+  g_task_set_task_data (task, dm_shard_record_ref (record),
+                        (GDestroyNotify) dm_shard_record_unref);
+
+  dm_utils_run_io_task (task, stream_data_thread);
+}
+
+/**
+ * dm_shard_stream_data_finish:
+ * @self: the #DmShard object
+ * @result: the #GAsyncResult that was provided to the callback
+ * @error: (nullable): return location for an error, or %NULL
+ *
+ * Finish a dm_shard_stream_data_async() call.
+ *
+ * Returns: (transfer full): A stream to read the record data.
+ */
+GInputStream *
+dm_shard_stream_data_finish (DmShard *self,
+                             GAsyncResult *result,
+                             GError **error)
+{
+  g_return_val_if_fail (DM_IS_SHARD (self), NULL);
+  g_return_val_if_fail (g_task_is_valid (result, self), NULL);
+
+  return g_task_propagate_pointer (G_TASK (result), error);
+}
+
 /**
  * dm_shard_get_data_size:
  * @self: the #DmShard object
@@ -220,6 +407,43 @@ dm_shard_get_data_size (DmShard *self,
   return klass->get_data_size (self, record);
 }
 
+/**
+ * dm_shard_get_data_bytes:
+ * @self: the #DmShard object
+ * @record: the #DmShardRecord belonged by the shard
+ * @cancellable: (nullable): a #GCancellable
+ * @error: (nullable): return location for an error, or %NULL
+ *
+ * Get the whole record data at once. Shards that keep their data mapped in
+ * memory can return it without copying; the others fall back to reading
+ * all of dm_shard_stream_data() into a new buffer.
+ *
+ * Returns: (transfer full) (nullable): The record data, or %NULL if the
+ *   record has no data or an error occurred.
+ */
+GBytes *
+dm_shard_get_data_bytes (DmShard *self,
+                         DmShardRecord *record,
+                         GCancellable *cancellable,
+                         GError **error)
+{
+  DmShardClass *klass;
+
+  g_return_val_if_fail (DM_IS_SHARD (self), NULL);
+
+  klass = DM_SHARD_GET_CLASS (self);
+  if (klass->get_data_bytes != NULL)
+    return klass->get_data_bytes (self, record, cancellable, error);
+
+  g_autoptr(GInputStream) stream = dm_shard_stream_data (self, record,
+                                                         cancellable, error);
+  if (stream == NULL)
+    return NULL;
+
+  gsize size = dm_shard_get_data_size (self, record);
+  return g_input_stream_read_bytes (stream, size, cancellable, error);
+}
+
 /**
  * dm_shard_test_link:
  * @self: the #DmShard object
@@ -42,7 +42,18 @@ struct _DmShardClass
 
   gint64 (*calculate_db_offset) (DmShard *self);
 
-  gpointer padding[12];
+  DmContent * (*get_model_with_fields) (DmShard *self,
+                                        DmShardRecord *record,
+                                        const char * const *fields,
+                                        GCancellable *cancellable,
+                                        GError **error);
+
+  GBytes * (*get_data_bytes) (DmShard *self,
+                              DmShardRecord *record,
+                              GCancellable *cancellable,
+                              GError **error);
+
+  gpointer padding[10];
 };
 
 DmShardRecord *dm_shard_find_by_id (DmShard *self,
@@ -51,12 +62,45 @@ DmShardRecord *dm_shard_find_by_id (DmShard *self,
 DmContent *dm_shard_get_model (DmShard *self, DmShardRecord *record,
                                GCancellable *cancellable, GError **error);
 
+void dm_shard_get_model_async (DmShard *self,
+                               DmShardRecord *record,
+                               int io_priority,
+                               GCancellable *cancellable,
+                               GAsyncReadyCallback callback,
+                               gpointer user_data);
+
+DmContent *dm_shard_get_model_finish (DmShard *self,
+                                      GAsyncResult *result,
+                                      GError **error);
+
+DmContent *dm_shard_get_model_with_fields (DmShard *self,
+                                           DmShardRecord *record,
+                                           const char * const *fields,
+                                           GCancellable *cancellable,
+                                           GError **error);
+
 GInputStream *dm_shard_stream_data (DmShard *self, DmShardRecord *record,
                                     GCancellable *cancellable, GError **error);
 
+void dm_shard_stream_data_async (DmShard *self,
+                                 DmShardRecord *record,
+                                 int io_priority,
+                                 GCancellable *cancellable,
+                                 GAsyncReadyCallback callback,
+                                 gpointer user_data);
+
+GInputStream *dm_shard_stream_data_finish (DmShard *self,
+                                           GAsyncResult *result,
+                                           GError **error);
+
 gsize dm_shard_get_data_size (DmShard *self,
                               DmShardRecord *record);
 
+GBytes *dm_shard_get_data_bytes (DmShard *self,
+                                 DmShardRecord *record,
+                                 GCancellable *cancellable,
+                                 GError **error);
+
 gchar *dm_shard_test_link (DmShard *self,
                            const gchar *link,
                            GError **error);
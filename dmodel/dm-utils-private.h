@@ -22,12 +22,73 @@ G_BEGIN_DECLS
       }                                                                          \
   }G_STMT_END;
 
+typedef enum {
+  DM_JSON_FIELD_STRING,
+  DM_JSON_FIELD_BOOLEAN,
+  DM_JSON_FIELD_UINT,
+  DM_JSON_FIELD_STRV,
+  DM_JSON_FIELD_JSON_OBJECT,
+  DM_JSON_FIELD_DICT_ARRAY,
+} DmJsonFieldType;
+
+/* Where a member of the JSON metadata is stored in a model's private struct.
+ * Lazy fields may be left undecoded until they are first read, see
+ * dm_content_resolve_pending_fields().
+ */
+typedef struct {
+  const char *json_key;
+  const char *property;
+  DmJsonFieldType type;
+  gsize offset;
+  gboolean lazy;
+} DmJsonField;
+
+#define DM_JSON_FIELD(json_key, property, field_type, priv_type, member) \
+  { (json_key), (property), DM_JSON_FIELD_ ## field_type,              \
+    G_STRUCT_OFFSET (priv_type, member), FALSE }
+
+#define DM_JSON_LAZY_FIELD(json_key, property, field_type, priv_type, member) \
+  { (json_key), (property), DM_JSON_FIELD_ ## field_type,                   \
+    G_STRUCT_OFFSET (priv_type, member), TRUE }
+
+typedef struct _DmJsonFieldTable DmJsonFieldTable;
+
+/* The JSON fields of one model class, chained to those of its parent class */
+struct _DmJsonFieldTable {
+  const DmJsonFieldTable *parent;
+  gpointer (*get_private) (gpointer instance);
+  const DmJsonField *fields;
+  guint n_fields;
+};
+
 void
-dm_utils_append_gparam_from_json_node (JsonNode *node,
-                                       GParamSpec *pspec,
-                                       GArray *params);
+dm_utils_set_field_from_json_node (gpointer priv,
+                                   const DmJsonField *field,
+                                   JsonNode *node);
+
+gpointer
+dm_utils_new_model_from_json_node (GType type,
+                                   const DmJsonFieldTable *table,
+                                   JsonNode *node);
+
+typedef void (*DmUtilsParallelFunc) (guint index,
+                                     gpointer user_data);
+
+void
+dm_utils_parallel_for (guint n_items,
+                       DmUtilsParallelFunc func,
+                       gpointer user_data);
+
+/* Reading content is mostly waiting on the disk, so a few threads are enough
+ * to keep it busy without fighting the parallel_for pool for the CPU */
+#define DM_UTILS_IO_POOL_THREADS 4
 
 void
-dm_utils_free_gparam_array (GArray *params);
+dm_utils_run_io_task (GTask *task,
+                      GTaskThreadFunc func);
+
+GList *
+dm_utils_get_extensions_dirs_full (const char *app_id,
+                                   GPtrArray *probed_paths);
 
 G_END_DECLS
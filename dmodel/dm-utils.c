@@ -36,15 +36,21 @@ string_array_from_json (JsonNode *node)
   JsonArray *array = json_node_get_array (node);
   guint n_elements = json_array_get_length (array);
   char **retval = g_new0 (char *, n_elements + 1);
+  guint n_strings = 0;
 
   for (guint i = 0; i < n_elements; i++)
     {
-      const char *str = json_array_get_string_element (array, i);
+      JsonNode *element = json_array_get_element (array, i);
 
-      if (str == NULL || *str == '\0')
+      if (!JSON_NODE_HOLDS_VALUE (element) ||
+          json_node_get_value_type (element) != G_TYPE_STRING)
         continue;
 
-      retval[i] = g_strdup (str);
+      const char *str = json_node_get_string (element);
+      if (*str == '\0')
+        continue;
+
+      retval[n_strings++] = g_strdup (str);
     }
 
   return retval;
@@ -142,123 +148,197 @@ dict_array_from_json (JsonNode *node,
   return g_variant_builder_end (&builder);
 }
 
-/**
- * dm_utils_append_gparam_from_json_node:
- *
- * For use instantiating a GObject from json data. Marshals the contents
- * of a JsonNode into a GParameter matching the GParamSpec pspec. Appends
- * that GParameter to a GArray, for eventual use with g_object_newv.
+/* Non-string JSON scalars are rare in metadata; convert them the same way
+ * GValue would rather than special-casing each combination.
  */
-void
-dm_utils_append_gparam_from_json_node (JsonNode *node,
-                                         GParamSpec *pspec,
-                                         GArray *params)
+static gboolean
+transform_json_value (JsonNode *node,
+                      const DmJsonField *field,
+                      GType type,
+                      GValue *out)
 {
-G_GNUC_BEGIN_IGNORE_DEPRECATIONS
-  GParameter param = { NULL, G_VALUE_INIT };
-G_GNUC_END_IGNORE_DEPRECATIONS
+  g_auto(GValue) value = G_VALUE_INIT;
 
-  if (node == NULL)
-    return;
-
-  param.name = pspec->name;
+  if (!JSON_NODE_HOLDS_VALUE (node))
+    {
+      g_critical ("Unexpected JSON type '%s' for field '%s'",
+                  json_node_type_name (node), field->property);
+      return FALSE;
+    }
 
-  g_value_init (&param.value, pspec->value_type);
+  json_node_get_value (node, &value);
+  g_value_init (out, type);
 
-  if (G_IS_PARAM_SPEC_VARIANT (pspec))
+  if (!g_value_transform (&value, out))
     {
-      GVariantType *type = G_PARAM_SPEC_VARIANT (pspec)->type;
-      GVariant *variant = NULL;
+      g_critical ("Unexpected type '%s' for field '%s', expected '%s'",
+                  G_VALUE_TYPE_NAME (&value), field->property,
+                  g_type_name (type));
+      g_value_unset (out);
+      return FALSE;
+    }
 
-      g_autoptr(GError) error = NULL;
+  return TRUE;
+}
 
-      if (g_variant_type_equal (type, G_VARIANT_TYPE ("aa{sv}")))
-        variant = dict_array_from_json (node, &error);
-      else
-        variant = json_gvariant_deserialize (node, g_variant_type_peek_string (type), &error);
+/*< private >
+ * dm_utils_set_field_from_json_node:
+ * @priv: the private struct holding @field
+ * @field: the field to set
+ * @node: the JSON value for @field
+ *
+ * Stores @node into @field, converting it to the field's type. Logs a
+ * critical and leaves the field alone if it can't be converted.
+ */
+void
+dm_utils_set_field_from_json_node (gpointer priv,
+                                   const DmJsonField *field,
+                                   JsonNode *node)
+{
+  gpointer location = G_STRUCT_MEMBER_P (priv, field->offset);
+  g_auto(GValue) value = G_VALUE_INIT;
 
-      if (error != NULL)
-        {
-          g_critical ("Unable to convert field '%s' from JSON to a '%s' variant: %s",
-                      pspec->name,
-                      g_variant_type_peek_string (type),
-                      error->message);
+  switch (field->type)
+    {
+    case DM_JSON_FIELD_STRING:
+      {
+        char *str;
+
+        if (JSON_NODE_HOLDS_VALUE (node) &&
+            json_node_get_value_type (node) == G_TYPE_STRING)
+          str = json_node_dup_string (node);
+        else if (transform_json_value (node, field, G_TYPE_STRING, &value))
+          str = g_value_dup_string (&value);
+        else
           return;
-        }
 
-      g_value_set_variant (&param.value, variant);
-    }
-  else if (pspec->value_type == G_TYPE_STRV)
-    {
-      char **array = string_array_from_json (node);
-      g_value_take_boxed (&param.value, array);
-    }
-  else if (JSON_NODE_HOLDS_OBJECT (node) && pspec->value_type == JSON_TYPE_OBJECT)
-    {
-      g_value_set_boxed (&param.value, json_node_get_object (node));
-    }
-  else if (JSON_NODE_HOLDS_VALUE (node))
-    {
-      GType type = json_node_get_value_type (node);
-      GValue value = G_VALUE_INIT;
+        g_free (*(char **) location);
+        *(char **) location = str;
+      }
+      break;
 
+    case DM_JSON_FIELD_BOOLEAN:
+      if (JSON_NODE_HOLDS_VALUE (node) &&
+          json_node_get_value_type (node) == G_TYPE_BOOLEAN)
+        *(gboolean *) location = json_node_get_boolean (node);
+      else if (transform_json_value (node, field, G_TYPE_BOOLEAN, &value))
+        *(gboolean *) location = g_value_get_boolean (&value);
+      break;
+
+    case DM_JSON_FIELD_UINT:
       // Most of our integer properties are stored in json as strings.
       // ImageObject for example was originally trying to follow
       // https://schema.org/ImageObject for its width and height properties,
       // though in practice it is always a string. May be worth a future cleanup,
       // but for now try to parse if we hit this case.
-      if (type == G_TYPE_STRING &&
-          (pspec->value_type == G_TYPE_INT || pspec->value_type == G_TYPE_UINT))
-        {
-          g_value_init (&value, G_TYPE_INT);
-          g_value_set_int (&value, atoi (json_node_get_string (node)));
-        }
-      else
-        {
-          json_node_get_value (node, &value);
-        }
+      if (JSON_NODE_HOLDS_VALUE (node) &&
+          json_node_get_value_type (node) == G_TYPE_STRING)
+        *(guint *) location = atoi (json_node_get_string (node));
+      else if (JSON_NODE_HOLDS_VALUE (node) &&
+               json_node_get_value_type (node) == G_TYPE_INT64)
+        *(guint *) location = json_node_get_int (node);
+      else if (transform_json_value (node, field, G_TYPE_UINT, &value))
+        *(guint *) location = g_value_get_uint (&value);
+      break;
+
+    case DM_JSON_FIELD_STRV:
+      {
+        char **array = string_array_from_json (node);
+        if (array == NULL)
+          return;
+
+        g_strfreev (*(char ***) location);
+        *(char ***) location = array;
+      }
+      break;
 
-      if (!g_type_is_a (type, pspec->value_type))
+    case DM_JSON_FIELD_JSON_OBJECT:
+      if (!JSON_NODE_HOLDS_OBJECT (node))
         {
-          if (!g_value_transform (&value, &param.value))
-            {
-              g_value_unset (&value);
-              g_critical ("Unexpected type '%s', expected '%s'",
-                          g_type_name (type),
-                          g_type_name (pspec->value_type));
-              return;
-            }
+          g_critical ("Unexpected JSON type '%s' for field '%s', expected an object",
+                      json_node_type_name (node), field->property);
+          return;
         }
-      else
-        g_value_copy (&value, &param.value);
 
-      g_value_unset (&value);
-    }
-  else
-    {
-      g_critical ("Unexpected JSON type '%s'",
-                  g_type_name (json_node_get_value_type (node)));
-      return;
+      g_clear_pointer ((JsonObject **) location, json_object_unref);
+      *(JsonObject **) location = json_object_ref (json_node_get_object (node));
+      break;
+
+    case DM_JSON_FIELD_DICT_ARRAY:
+      {
+        g_autoptr(GError) error = NULL;
+        GVariant *variant = dict_array_from_json (node, &error);
+
+        if (variant == NULL)
+          {
+            g_critical ("Unable to convert field '%s' from JSON to a 'aa{sv}' variant: %s",
+                        field->property, error->message);
+            return;
+          }
+
+        g_clear_pointer ((GVariant **) location, g_variant_unref);
+        *(GVariant **) location = g_variant_ref_sink (variant);
+      }
+      break;
+
+    default:
+      g_assert_not_reached ();
     }
-
-  g_array_append_val (params, param);
 }
 
-/**
- * dm_utils_free_gparam_array:
+/*< private >
+ * dm_utils_new_model_from_json_node:
+ * @type: the #GType of the model, a #DmContent subclass
+ * @table: the JSON fields of @type
+ * @node: a JSON node with the model metadata
+ *
+ * Instantiates a model from a JsonNode of object metadata. Only the ID goes
+ * through the property system, since DmContent needs it while constructing;
+ * the rest of the metadata is stored straight into the private structs of
+ * @type and its parents, as described by @table and its parent tables.
+ * Properties missing from the metadata keep their default values.
  *
- * Frees a GArray of GParameters.
+ * Returns: (transfer full): the newly created model
  */
-void
-dm_utils_free_gparam_array (GArray *params)
+gpointer
+dm_utils_new_model_from_json_node (GType type,
+                                   const DmJsonFieldTable *table,
+                                   JsonNode *node)
 {
-G_GNUC_BEGIN_IGNORE_DEPRECATIONS
-  for (guint i = 0; i < params->len; i++) {
-    GParameter *param = &g_array_index (params, GParameter, i);
-    g_value_unset (&param->value);
-  }
-  g_array_free (params, TRUE);
-G_GNUC_END_IGNORE_DEPRECATIONS
+  if (!JSON_NODE_HOLDS_OBJECT (node))
+    {
+      g_critical ("Trying to instantiate a %s from a non json object.",
+                  g_type_name (type));
+      return g_object_new (type, NULL);
+    }
+
+  JsonObject *object = json_node_get_object (node);
+
+  const char *id = NULL;
+  JsonNode *id_node = json_object_get_member (object, "@id");
+  if (id_node != NULL && JSON_NODE_HOLDS_VALUE (id_node))
+    id = json_node_get_string (id_node);
+
+  gpointer model = id != NULL ? g_object_new (type, "id", id, NULL) :
+                                g_object_new (type, NULL);
+
+  for (; table != NULL; table = table->parent)
+    {
+      gpointer priv = table->get_private (model);
+
+      for (guint i = 0; i < table->n_fields; i++)
+        {
+          const DmJsonField *field = &table->fields[i];
+          JsonNode *member = json_object_get_member (object, field->json_key);
+
+          if (member == NULL || JSON_NODE_HOLDS_NULL (member))
+            continue;
+
+          dm_utils_set_field_from_json_node (priv, field, member);
+        }
+    }
+
+  return model;
 }
 
 /**
@@ -462,6 +542,217 @@ dm_utils_parallel_init (GSList *initables,
     }
 }
 
+struct parallel_for_data {
+  guint n_items;
+  DmUtilsParallelFunc func;
+  gpointer user_data;
+
+  /* atomic */
+  int next_index;
+
+  GMutex lock;
+  GCond cond;
+  guint n_workers;
+};
+
+static void
+parallel_for_run_items (struct parallel_for_data *data)
+{
+  guint index;
+
+  while ((index = (guint) g_atomic_int_add (&data->next_index, 1)) < data->n_items)
+    data->func (index, data->user_data);
+}
+
+static void
+parallel_for_worker (gpointer pool_data,
+                     G_GNUC_UNUSED gpointer user_data)
+{
+  struct parallel_for_data *data = pool_data;
+
+  parallel_for_run_items (data);
+
+  g_mutex_lock (&data->lock);
+  data->n_workers--;
+  g_cond_signal (&data->cond);
+  g_mutex_unlock (&data->lock);
+}
+
+static GThreadPool *
+get_parallel_for_pool (void)
+{
+  static GThreadPool *pool = NULL;
+
+  if (g_once_init_enter (&pool))
+    {
+      GThreadPool *new_pool = g_thread_pool_new (parallel_for_worker, NULL,
+                                                 MAX (g_get_num_processors (), 1),
+                                                 FALSE, NULL);
+      g_once_init_leave (&pool, new_pool);
+    }
+
+  return pool;
+}
+
+/*< private >
+ * dm_utils_parallel_for:
+ * @n_items: the number of items to process
+ * @func: function to call for each item index
+ * @user_data: data to pass to @func
+ *
+ * Calls @func once for every index from 0 to @n_items - 1, spreading the
+ * calls across a shared, bounded pool of worker threads, and waits for all
+ * of them to finish. The calling thread processes items too, so this
+ * always makes progress even when the pool is busy.
+ *
+ * @func may be called from several threads at once, with different indices.
+ * It must not call dm_utils_parallel_for() itself.
+ */
+void
+dm_utils_parallel_for (guint n_items,
+                       DmUtilsParallelFunc func,
+                       gpointer user_data)
+{
+  g_return_if_fail (func != NULL);
+
+  if (n_items == 0)
+    return;
+
+  struct parallel_for_data data = {
+    .n_items = n_items,
+    .func = func,
+    .user_data = user_data,
+  };
+
+  g_mutex_init (&data.lock);
+  g_cond_init (&data.cond);
+
+  GThreadPool *pool = get_parallel_for_pool ();
+  guint n_helpers = MIN (n_items, (guint) g_thread_pool_get_max_threads (pool)) - 1;
+
+  for (guint i = 0; i < n_helpers; i++)
+    {
+      g_mutex_lock (&data.lock);
+      data.n_workers++;
+      g_mutex_unlock (&data.lock);
+
+      if (!g_thread_pool_push (pool, &data, NULL))
+        {
+          g_mutex_lock (&data.lock);
+          data.n_workers--;
+          g_mutex_unlock (&data.lock);
+          break;
+        }
+    }
+
+  parallel_for_run_items (&data);
+
+  /* Helpers that never got to run still hold a pointer to our stack frame,
+   * so wait for every one of them, not just for the items to be done.
+   */
+  g_mutex_lock (&data.lock);
+  while (data.n_workers > 0)
+    g_cond_wait (&data.cond, &data.lock);
+  g_mutex_unlock (&data.lock);
+
+  g_mutex_clear (&data.lock);
+  g_cond_clear (&data.cond);
+}
+
+struct io_task {
+  GTask *task;
+  GTaskThreadFunc func;
+  /* order in which tasks of the same priority were queued; 64 bits so that
+   * it never wraps around and puts new tasks ahead of older ones */
+  guint64 serial;
+};
+
+G_LOCK_DEFINE_STATIC (io_serial);
+
+static void
+io_pool_worker (gpointer pool_data,
+                G_GNUC_UNUSED gpointer user_data)
+{
+  struct io_task *io_task = pool_data;
+  GTask *task = io_task->task;
+
+  if (!g_task_return_error_if_cancelled (task))
+    io_task->func (task, g_task_get_source_object (task),
+                   g_task_get_task_data (task),
+                   g_task_get_cancellable (task));
+
+  g_object_unref (task);
+  g_slice_free (struct io_task, io_task);
+}
+
+static gint
+io_task_compare (gconstpointer a,
+                 gconstpointer b,
+                 G_GNUC_UNUSED gpointer user_data)
+{
+  const struct io_task *io_task_a = a;
+  const struct io_task *io_task_b = b;
+  int priority_a = g_task_get_priority (io_task_a->task);
+  int priority_b = g_task_get_priority (io_task_b->task);
+
+  if (priority_a != priority_b)
+    return (priority_a > priority_b) - (priority_a < priority_b);
+
+  /* Not a subtraction, which would not fit in the return value */
+  return (io_task_a->serial > io_task_b->serial) -
+    (io_task_a->serial < io_task_b->serial);
+}
+
+static GThreadPool *
+get_io_pool (void)
+{
+  static GThreadPool *pool = NULL;
+
+  if (g_once_init_enter (&pool))
+    {
+      GThreadPool *new_pool = g_thread_pool_new (io_pool_worker, NULL,
+                                                 DM_UTILS_IO_POOL_THREADS,
+                                                 FALSE, NULL);
+      g_thread_pool_set_sort_function (new_pool, io_task_compare, NULL);
+      g_once_init_leave (&pool, new_pool);
+    }
+
+  return pool;
+}
+
+/*< private >
+ * dm_utils_run_io_task:
+ * @task: a #GTask
+ * @func: function to run @task with
+ *
+ * Like g_task_run_in_thread(), but on a small pool of threads set aside for
+ * reading content. Queued tasks are started in order of
+ * g_task_get_priority(), and then in the order they were queued, so that
+ * what the user is waiting for can go ahead of prefetching.
+ *
+ * If @task is cancelled before it gets to run, it returns
+ * %G_IO_ERROR_CANCELLED without calling @func.
+ */
+void
+dm_utils_run_io_task (GTask *task,
+                      GTaskThreadFunc func)
+{
+  static guint64 next_serial = 0;
+
+  g_return_if_fail (G_IS_TASK (task));
+  g_return_if_fail (func != NULL);
+
+  struct io_task *io_task = g_slice_new (struct io_task);
+  io_task->task = g_object_ref (task);
+  io_task->func = func;
+
+  G_LOCK (io_serial);
+  io_task->serial = next_serial++;
+  G_UNLOCK (io_serial);
+
+  g_thread_pool_push (get_io_pool (), io_task, NULL);
+}
+
 static GFile *
 database_dir_from_data_dir (const gchar *data_dir, const gchar *app_id)
 {
@@ -538,7 +829,9 @@ dm_get_data_dir (const char *app_id)
 }
 
 static GList *
-databases_dirs_from_metadata (const gchar *flatpak_path, const gchar *app_id)
+databases_dirs_from_metadata (const gchar *flatpak_path,
+                              const gchar *app_id,
+                              GPtrArray *probed_paths)
 {
   GList *list = NULL;
   g_autoptr(GKeyFile) metakey = NULL;
@@ -552,6 +845,7 @@ databases_dirs_from_metadata (const gchar *flatpak_path, const gchar *app_id)
                                     "app", app_id,
                                     "current", "active", "metadata",
                                     NULL);
+  g_ptr_array_add (probed_paths, g_strdup (metadata_path));
   metakey = g_key_file_new ();
   if (!g_key_file_load_from_file (metakey, metadata_path, G_KEY_FILE_NONE, NULL))
     return NULL;
@@ -588,6 +882,7 @@ databases_dirs_from_metadata (const gchar *flatpak_path, const gchar *app_id)
                                                  "active", "files",
                                                  NULL);
 
+      g_ptr_array_add (probed_paths, g_file_get_path (extension_dir));
       if (g_file_query_exists (extension_dir, NULL))
         list = g_list_prepend (list, g_object_ref (extension_dir));
 
@@ -598,6 +893,7 @@ databases_dirs_from_metadata (const gchar *flatpak_path, const gchar *app_id)
                                                  arch, extension_version,
                                                  NULL);
 
+      g_ptr_array_add (probed_paths, g_file_get_path (extension_dir));
       if (g_file_query_exists (extension_dir, NULL))
         list = g_list_prepend (list, g_object_ref (extension_dir));
     }
@@ -605,6 +901,78 @@ databases_dirs_from_metadata (const gchar *flatpak_path, const gchar *app_id)
   return list;
 }
 
+struct extensions_dirs_probe {
+  const char *app_id;
+  const char * const *flatpak_paths;
+  GList **dirs;
+  GPtrArray **probed_paths;
+};
+
+static void
+probe_extensions_dirs (guint index,
+                       gpointer user_data)
+{
+  struct extensions_dirs_probe *probe = user_data;
+
+  probe->probed_paths[index] = g_ptr_array_new_with_free_func (g_free);
+  probe->dirs[index] = databases_dirs_from_metadata (probe->flatpak_paths[index],
+                                                     probe->app_id,
+                                                     probe->probed_paths[index]);
+}
+
+/*< private >
+ * dm_utils_get_extensions_dirs_full:
+ * @app_id: knowledge app ID, such as "com.endlessm.health-es"
+ * @probed_paths: (element-type filename) (nullable): array to append to
+ *
+ * Like dm_get_extensions_dirs(), but also appends to @probed_paths every
+ * path that was looked at on disk to come up with the answer, whether it
+ * existed or not. If none of those paths change, the answer won't either.
+ *
+ * Return value: (element-type GFile) (transfer full): list of #GFile
+ */
+GList *
+dm_utils_get_extensions_dirs_full (const char *app_id,
+                                   GPtrArray *probed_paths)
+{
+  g_autofree gchar *user_path = g_build_filename (g_get_home_dir (), ".local",
+                                                  "share", NULL);
+
+  /* In order of preference; the first one that has the app wins */
+  const char *flatpak_paths[] = { user_path, "/var/lib", "/var/endless-extra" };
+  GList *dirs[G_N_ELEMENTS (flatpak_paths)] = { NULL, };
+  GPtrArray *probed[G_N_ELEMENTS (flatpak_paths)] = { NULL, };
+
+  struct extensions_dirs_probe probe = {
+    .app_id = app_id,
+    .flatpak_paths = flatpak_paths,
+    .dirs = dirs,
+    .probed_paths = probed,
+  };
+
+  /* Each installation is probed on disk, so look at all of them at once */
+  dm_utils_parallel_for (G_N_ELEMENTS (flatpak_paths), probe_extensions_dirs,
+                         &probe);
+
+  GList *list = NULL;
+  for (guint i = 0; i < G_N_ELEMENTS (flatpak_paths); i++)
+    {
+      if (list == NULL)
+        list = g_steal_pointer (&dirs[i]);
+      else
+        g_list_free_full (dirs[i], g_object_unref);
+
+      if (probed_paths != NULL)
+        {
+          for (guint j = 0; j < probed[i]->len; j++)
+            g_ptr_array_add (probed_paths, g_steal_pointer (&probed[i]->pdata[j]));
+        }
+      g_ptr_array_unref (probed[i]);
+    }
+
+  return list;
+}
+
 /**
  * dm_get_extensions_dirs:
  * @app_id: knowledge app ID, such as "com.endlessm.health-es"
@@ -619,19 +987,7 @@ databases_dirs_from_metadata (const gchar *flatpak_path, const gchar *app_id)
 GList *
 dm_get_extensions_dirs (const char *app_id)
 {
-  GList *list = NULL;
-  g_autofree gchar *user_path = NULL;
-
-  user_path = g_build_filename (g_get_home_dir (), ".local", "share", NULL);
-  list = databases_dirs_from_metadata (user_path, app_id);
-  if (list != NULL)
-    return list;
-
-  list = databases_dirs_from_metadata ("/var/lib", app_id);
-  if (list != NULL)
-    return list;
-
-  return databases_dirs_from_metadata ("/var/endless-extra", app_id);
+  return dm_utils_get_extensions_dirs_full (app_id, NULL);
 }
 
 /**
@@ -2,6 +2,7 @@
 
 #include "dm-video.h"
 
+#include "dm-base-private.h"
 #include "dm-utils-private.h"
 #include "dm-media-private.h"
 
@@ -149,33 +150,25 @@ dm_video_init (G_GNUC_UNUSED DmVideo *self)
 {
 }
 
-static void
-dm_video_add_json_to_params (JsonNode *node,
-                             GArray *params)
+static gpointer
+dm_video_get_private (gpointer self)
 {
-  if (!JSON_NODE_HOLDS_OBJECT (node))
-    {
-      g_critical ("Trying to instantiate a DmVideo from a non json object.");
-      return;
-    }
-
-  dm_media_add_json_to_params (node, params);
-
-  JsonObject *object = json_node_get_object (node);
-  GObjectClass *klass = g_type_class_ref (DM_TYPE_VIDEO);
-
-  dm_utils_append_gparam_from_json_node (json_object_get_member (object, "duration"),
-                                         g_object_class_find_property (klass, "duration"),
-                                         params);
-  dm_utils_append_gparam_from_json_node (json_object_get_member (object, "transcript"),
-                                         g_object_class_find_property (klass, "transcript"),
-                                         params);
-  dm_utils_append_gparam_from_json_node (json_object_get_member (object, "poster"),
-                                         g_object_class_find_property (klass, "poster-uri"),
-                                         params);
-  g_type_class_unref (klass);
+  return dm_video_get_instance_private (self);
 }
 
+static const DmJsonField video_fields[] = {
+  DM_JSON_FIELD ("duration", "duration", UINT, DmVideoPrivate, duration),
+  DM_JSON_FIELD ("transcript", "transcript", STRING, DmVideoPrivate, transcript),
+  DM_JSON_FIELD ("poster", "poster-uri", STRING, DmVideoPrivate, poster_uri),
+};
+
+const DmJsonFieldTable dm_video_json_fields = {
+  &dm_media_json_fields,
+  dm_video_get_private,
+  video_fields,
+  G_N_ELEMENTS (video_fields),
+};
+
 /**
  * dm_video_new_from_json_node:
  * @node: a json node with the model metadata
@@ -190,13 +183,6 @@ dm_video_new_from_json_node (JsonNode *node)
 {
   g_autoptr(EosProfileProbe) probe = EOS_PROFILE_PROBE ("/dmodel/object/video");
 
-G_GNUC_BEGIN_IGNORE_DEPRECATIONS
-  GArray *params = g_array_new (FALSE, TRUE, sizeof (GParameter));
-  dm_video_add_json_to_params (node, params);
-  DmVideo *model = g_object_newv (DM_TYPE_VIDEO, params->len,
-                                  (GParameter *)params->data);
-  dm_utils_free_gparam_array (params);
-G_GNUC_END_IGNORE_DEPRECATIONS
-
-  return DM_CONTENT (model);
+  return dm_utils_new_model_from_json_node (DM_TYPE_VIDEO,
+                                            &dm_video_json_fields, node);
 }
@@ -20,7 +20,9 @@ G_BEGIN_DECLS
 #include "dm-macros.h"
 #include "dm-media.h"
 #include "dm-query.h"
+#include "dm-query-cursor.h"
 #include "dm-query-results.h"
+#include "dm-search-session.h"
 #include "dm-set.h"
 #include "dm-shard.h"
 #include "dm-utils.h"
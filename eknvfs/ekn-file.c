@@ -273,9 +273,39 @@ static GFileInputStream *
 ekn_file_read_fn (GFile *self, GCancellable *cancellable, GError **error)
 {
   EknFilePrivate *priv = EKN_FILE_PRIVATE (self);
+  DmShard *shard = dm_shard_record_get_shard (priv->record);
+  g_autoptr(GInputStream) stream = NULL;
+  g_autoptr(GError) local_error = NULL;
+
+  /* Shards that can hand out their data without copying it are read from
+   * memory, which is also seekable; the rest are streamed as before so that
+   * large media isn't read in all at once */
+  if (DM_SHARD_GET_CLASS (shard)->get_data_bytes != NULL)
+    {
+      g_autoptr(GBytes) bytes = dm_shard_get_data_bytes (shard, priv->record,
+                                                         cancellable, &local_error);
+      if (bytes != NULL)
+        stream = g_memory_input_stream_new_from_bytes (bytes);
+    }
+  else
+    {
+      stream = dm_shard_stream_data (shard, priv->record, cancellable, &local_error);
+    }
+
+  if (local_error != NULL)
+    {
+      g_propagate_error (error, g_steal_pointer (&local_error));
+      return NULL;
+    }
+
+  /* Records without any data are not an error for the shard */
+  if (stream == NULL)
+    {
+      g_set_error (error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND,
+                   "%s has no data", priv->uri);
+      return NULL;
+    }
 
-  GInputStream *stream = dm_shard_stream_data (dm_shard_record_get_shard (priv->record),
-                                               priv->record, cancellable, error);
   if (g_cancellable_set_error_if_cancelled (cancellable, error))
     return NULL;
 
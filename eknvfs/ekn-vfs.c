@@ -27,6 +27,7 @@
 #include <dm-utils.h>
 #include <dm-shard.h>
 #include <dm-shard-record.h>
+#include <dm-shard-index-private.h>
 #include <eos-shard/eos-shard-shard-file.h>
 #include <eos-shard/eos-shard-record.h>
 
@@ -44,6 +45,7 @@ struct _EknVfs
 typedef struct
 {
   GSList *shards;         /* DmShard list */
+  DmShardIndex *index;    /* object ID lookups in shards */
 
   GHashTable *extensions; /* (uri, GVfs *) table */
   gchar     **schemes;    /* Schemes suported by all GVfs in extensions table */
@@ -175,6 +177,7 @@ ekn_vfs_dispose (GObject *self)
 {
   EknVfsPrivate *priv = EKN_VFS_PRIVATE (self);
 
+  g_clear_pointer (&priv->index, dm_shard_index_free);
   g_clear_pointer (&priv->shards, slist_free_and_unref);
   g_clear_object (&priv->local);
 
@@ -187,8 +190,10 @@ ekn_vfs_set_shards (EknVfs *self, GSList *shards)
   EknVfsPrivate *priv = EKN_VFS_PRIVATE (self);
 
   slist_free_and_unref (priv->shards);
+  g_clear_pointer (&priv->index, dm_shard_index_free);
 
   priv->shards = shards ? g_slist_copy_deep (shards, (GCopyFunc) g_object_ref, NULL) : NULL;
+  priv->index = dm_shard_index_new (priv->shards);
 
   g_object_notify_by_pspec (G_OBJECT (self), properties[PROP_SHARDS]);
 }
@@ -256,10 +261,10 @@ ekn_vfs_get_file_for_uri (GVfs *self, const char *uri)
 
   if (object_id)
     {
-      DmShardRecord *record = NULL;
+      g_autoptr(DmShardRecord) record = NULL;
 
-      for (GSList *l = priv->shards; l && !record; l = g_slist_next (l))
-        record = dm_shard_find_by_id (l->data, object_id);
+      if (priv->index)
+        record = dm_shard_index_find_by_id (priv->index, object_id);
 
       if (record)
         retval = _ekn_file_new (uri, record);
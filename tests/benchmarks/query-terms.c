@@ -0,0 +1,142 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+
+/* Copyright 2020 Endless Mobile, Inc. */
+
+/* Compares the single pass query term splitter against the regular
+ * expression pipeline it replaced, both for output and for speed. With
+ * --check-only, only the output is compared; that is run as a regular test.
+ *
+ * Run with: meson test --benchmark query-terms
+ */
+
+#include "dm-query-private.h"
+
+#include <string.h>
+
+#define MAX_TERM_LENGTH 245
+#define ITERATIONS 20000
+
+#define XAPIAN_SYNTAX_REGEX "\\(|\\)|\\+|\\-|\\'|\\\""
+#define XAPIAN_TERM_REGEX "AND|OR|NOT|XOR|NEAR|ADJ"
+#define XAPIAN_DELIMITER_REGEX "[\\s\\-;]+"
+
+static void
+reference_chomp_term (gchar *term)
+{
+  if (strlen (term) <= MAX_TERM_LENGTH)
+    return;
+  gchar *end = g_utf8_prev_char (term + MAX_TERM_LENGTH + 1);
+  *end = '\0';
+}
+
+/* The implementation of get_terms() before it was rewritten */
+static gchar **
+reference_split_terms (const gchar *query)
+{
+  g_autoptr(GRegex) syntax_regex = g_regex_new (XAPIAN_SYNTAX_REGEX, 0, 0, NULL);
+  g_autofree gchar *without_syntax = g_regex_replace (syntax_regex, query, -1, 0, "", 0, NULL);
+  g_autoptr(GRegex) term_regex = g_regex_new (XAPIAN_TERM_REGEX, 0, 0, NULL);
+  g_autofree gchar *without_terms = g_regex_replace (term_regex, without_syntax, -1, 0, "\\L\\0\\E", 0, NULL);
+  g_autoptr(GRegex) delimiter_regex = g_regex_new (XAPIAN_DELIMITER_REGEX, 0, 0, NULL);
+  gchar **terms = g_regex_split (delimiter_regex, without_terms, 0);
+  guint length = g_strv_length (terms);
+  for (guint i = 0; i < length; i++)
+    reference_chomp_term (terms[i]);
+  return terms;
+}
+
+static const char * const queries[] = {
+  "",
+  "a",
+  "whales",
+  "blue whale",
+  "  leading and trailing  ",
+  "Tom AND Jerry OR NOT XORcist NEAR ADJacent",
+  "ANDORNOTXOR",
+  "(parenthesised) +plus -minus 'quoted' \"double\"",
+  "semi;colon ; separated;;terms",
+  "tabs\tand\nnewlines\r\fand\vvertical",
+  "x-ray -- well-known",
+  "( )",
+  "caf\xc3\xa9 cr\xc3\xa8me br\xc3\xbbl\xc3\xa9" "e",
+  "non\xc2\xa0" "breaking\xe3\x80\x80ideographic\xe2\x80\xa8line",
+  "\xe6\x9d\xb1\xe4\xba\xac \xe3\x82\xbf\xe3\x83\xaf\xe3\x83\xbc",
+  "\xd0\x9c\xd0\xbe\xd1\x81\xd0\xba\xd0\xb2\xd0\xb0 AND \xd0\x9a\xd0\xb8\xd0\xb5\xd0\xb2",
+  "typing a longer incremental search query, one keystroke at a ti",
+};
+
+static gboolean
+strv_equal (char **a,
+            char **b)
+{
+  for (; *a != NULL && *b != NULL; a++, b++)
+    {
+      if (strcmp (*a, *b) != 0)
+        return FALSE;
+    }
+
+  return *a == NULL && *b == NULL;
+}
+
+static gboolean
+check_query (const char *query)
+{
+  g_auto(GStrv) expected = reference_split_terms (query);
+  g_auto(GStrv) actual = dm_query_split_terms (query);
+
+  if (strv_equal (expected, actual))
+    return TRUE;
+
+  g_autofree char *expected_str = g_strjoinv ("|", expected);
+  g_autofree char *actual_str = g_strjoinv ("|", actual);
+  g_printerr ("Mismatch for \"%s\":\n  expected: %s\n  actual:   %s\n",
+              query, expected_str, actual_str);
+  return FALSE;
+}
+
+static double
+time_splitter (char ** (*split) (const char *))
+{
+  gint64 start = g_get_monotonic_time ();
+
+  for (guint i = 0; i < ITERATIONS; i++)
+    {
+      for (guint j = 0; j < G_N_ELEMENTS (queries); j++)
+        g_strfreev (split (queries[j]));
+    }
+
+  return (g_get_monotonic_time () - start) / 1000.0;
+}
+
+int
+main (int argc,
+      char **argv)
+{
+  gboolean check_only = argc > 1 && strcmp (argv[1], "--check-only") == 0;
+  gboolean ok = TRUE;
+
+  for (guint i = 0; i < G_N_ELEMENTS (queries); i++)
+    ok &= check_query (queries[i]);
+
+  /* One term longer than the limit, with a multibyte character across it */
+  GString *long_query = g_string_new ("short ");
+  while (long_query->len < MAX_TERM_LENGTH + 6)
+    g_string_append (long_query, "\xc3\xa9");
+  ok &= check_query (long_query->str);
+  g_string_free (long_query, TRUE);
+
+  if (!ok)
+    return 1;
+
+  if (check_only)
+    return 0;
+
+  double reference_ms = time_splitter (reference_split_terms);
+  double split_ms = time_splitter (dm_query_split_terms);
+
+  g_print ("%u queries\n", ITERATIONS * (guint) G_N_ELEMENTS (queries));
+  g_print ("  regex pipeline: %8.1f ms\n", reference_ms);
+  g_print ("  single pass:    %8.1f ms (%.1fx)\n", split_ms, reference_ms / split_ms);
+
+  return 0;
+}
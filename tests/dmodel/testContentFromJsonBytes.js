@@ -0,0 +1,177 @@
+const {DModel, Json} = imports.gi;
+const ByteArray = imports.byteArray;
+
+const InstanceOfMatcher = imports.tests.InstanceOfMatcher;
+
+function model_from_text(text, properties = null) {
+    let bytes = ByteArray.toGBytes(ByteArray.fromString(text));
+    return DModel.model_from_json_bytes(bytes, properties);
+}
+
+// Creates a model from the same text both ways, to compare them
+function models_from_text(text) {
+    return [
+        model_from_text(text),
+        DModel.model_from_json_node(Json.from_string(text)),
+    ];
+}
+
+describe('Object model from json bytes', function () {
+    beforeEach(function () {
+        jasmine.addMatchers(InstanceOfMatcher.customMatchers);
+    });
+
+    it('creates the same type of model as from a json node', function () {
+        [
+            ['ekn://_vocab/ContentObject', DModel.Content],
+            ['ekn://_vocab/ArticleObject', DModel.Article],
+            ['ekn://_vocab/DictionaryObject', DModel.DictionaryEntry],
+            ['ekn://_vocab/SetObject', DModel.Set],
+            ['ekn://_vocab/MediaObject', DModel.Media],
+            ['ekn://_vocab/ImageObject', DModel.Image],
+            ['ekn://_vocab/VideoObject', DModel.Video],
+            ['ekn://_vocab/AudioObject', DModel.Audio],
+        ].forEach(([type, klass]) => {
+            let [from_bytes, from_node] = models_from_text(JSON.stringify({
+                '@type': type,
+                '@id': 'ekn:///abc',
+            }));
+            expect(from_bytes).toBeA(klass);
+            expect(from_bytes.constructor).toBe(from_node.constructor);
+            expect(from_bytes.id).toEqual(from_node.id);
+        });
+    });
+
+    it('decodes escapes in strings the same way', function () {
+        let [from_bytes, from_node] = models_from_text(`{
+            "@type": "ekn://_vocab/ContentObject",
+            "title": "\\"Quoted\\" \\\\ \\/ \\b\\f\\n\\r\\t \\u00e9\\u4e2d"
+        }`);
+        expect(from_bytes.title).toEqual('"Quoted" \\ / \b\f\n\r\t é中');
+        expect(from_bytes.title).toEqual(from_node.title);
+    });
+
+    it('decodes surrogate pairs the same way', function () {
+        let [from_bytes, from_node] = models_from_text(`{
+            "@type": "ekn://_vocab/ContentObject",
+            "synopsis": "Smile \\ud83d\\ude00"
+        }`);
+        expect(from_bytes.synopsis).toEqual('Smile \u{1f600}');
+        expect(from_bytes.synopsis).toEqual(from_node.synopsis);
+    });
+
+    it('errors with an unpaired surrogate', function () {
+        expect(() => model_from_text(`{
+            "@type": "ekn://_vocab/ContentObject",
+            "title": "\\ud83d alone"
+        }`)).toThrow();
+        expect(() => model_from_text(`{
+            "@type": "ekn://_vocab/ContentObject",
+            "title": "\\ude00 alone"
+        }`)).toThrow();
+    });
+
+    it('skips unknown and nested members the same way', function () {
+        let [from_bytes, from_node] = models_from_text(`{
+            "unknown": {"title": "Wrong", "nested": [1, {"x": "}]"}, null]},
+            "@type": "ekn://_vocab/ContentObject",
+            "alsoUnknown": ["title", "]"],
+            "title": "Right",
+            "tags": ["a", "", 3, {"b": "c"}, "d"],
+            "featured": true,
+            "sequenceNumber": "42",
+            "discoveryFeedContent": {"blurbs": ["e"], "title": "Feed"}
+        }`);
+        expect(from_bytes.title).toEqual('Right');
+        expect(from_bytes.title).toEqual(from_node.title);
+        expect(from_bytes.tags).toEqual(['a', 'd']);
+        expect(from_bytes.tags).toEqual(from_node.tags);
+        expect(from_bytes.featured).toBe(from_node.featured);
+        expect(from_bytes.sequence_number).toBe(42);
+        expect(from_bytes.sequence_number).toBe(from_node.sequence_number);
+        expect(from_bytes.discovery_feed_content.get_string_member('title'))
+            .toEqual(from_node.discovery_feed_content.get_string_member('title'));
+    });
+
+    it('decodes lazy fields the same way', function () {
+        let [from_bytes, from_node] = models_from_text(`{
+            "@type": "ekn://_vocab/ArticleObject",
+            "authors": ["Jane \\u00c9", "", "John"],
+            "temporalCoverage": ["1999"],
+            "outgoingLinks": ["ekn:///def"],
+            "tableOfContents": [
+                {"@id": "_:1", "hasIndex": 0, "hasLabel": "Intro \\"1\\"", "hasContent": "#intro"},
+                {"@id": "_:2", "hasIndex": 1, "hasLabel": "End", "hasParent": "_:1"}
+            ],
+            "title": "Read after the lazy fields"
+        }`);
+        expect(from_bytes.title).toEqual(from_node.title);
+        expect(from_bytes.authors).toEqual(['Jane É', 'John']);
+        expect(from_bytes.authors).toEqual(from_node.authors);
+        expect(from_bytes.temporal_coverage).toEqual(from_node.temporal_coverage);
+        expect(from_bytes.outgoing_links).toEqual(from_node.outgoing_links);
+        expect(from_bytes.table_of_contents.equal(from_node.table_of_contents))
+            .toBe(true);
+    });
+
+    it('only fills in the properties asked for', function () {
+        let model = model_from_text(JSON.stringify({
+            '@type': 'ekn://_vocab/ArticleObject',
+            '@id': 'ekn:///abc',
+            'title': 'Title',
+            'synopsis': 'Synopsis',
+            'authors': ['Author'],
+        }), ['title']);
+        let empty = DModel.model_from_json_node(Json.from_string(JSON.stringify({
+            '@type': 'ekn://_vocab/ArticleObject',
+        })));
+        expect(model.id).toEqual('ekn:///abc');
+        expect(model.title).toEqual('Title');
+        expect(model.synopsis).toEqual(empty.synopsis);
+        expect(model.authors).toEqual(empty.authors);
+    });
+
+    it('allows whitespace after the object', function () {
+        expect(() => model_from_text(`{
+            "@type": "ekn://_vocab/ContentObject"
+        }\n\t `)).not.toThrow();
+    });
+
+    it('errors with data after the object', function () {
+        let text = '{"@type": "ekn://_vocab/ContentObject"} {}';
+        expect(() => model_from_text(text)).toThrow();
+        expect(() => Json.from_string(text)).toThrow();
+    });
+
+    it('errors with malformed data', function () {
+        [
+            JSON.stringify([1, 2, 3]),
+            '{"@type": "ekn://_vocab/ContentObject", "title": "Unterminated}',
+            '{"@type": "ekn://_vocab/ContentObject" "title": "No comma"}',
+            '{"@type": "ekn://_vocab/ContentObject", "title" "No colon"}',
+            '{"@type": "ekn://_vocab/ContentObject", "tags": ["a", "b"}',
+            '{"@type": "ekn://_vocab/ContentObject", "title": "\\x"}',
+            '{"@type": "ekn://_vocab/ContentObject"',
+        ].forEach(text => {
+            expect(() => model_from_text(text)).toThrow();
+        });
+    });
+
+    it('errors with invalid UTF-8', function () {
+        let bytes = ByteArray.toGBytes(Uint8Array.from([
+            0x7b, 0x22, 0x40, 0x74, 0x79, 0x70, 0x65, 0x22, 0x3a, 0x22, 0xff, 0x22, 0x7d,
+        ]));
+        expect(() => DModel.model_from_json_bytes(bytes, null)).toThrow();
+    });
+
+    it('errors with missing @type', function () {
+        expect(() => model_from_text(JSON.stringify({}))).toThrow();
+        expect(() => model_from_text(JSON.stringify({'@type': 3}))).toThrow();
+    });
+
+    it('errors with unknown @type', function () {
+        expect(() => model_from_text(JSON.stringify({
+            '@type': 'foobar',
+        }))).toThrow();
+    });
+});
@@ -1,4 +1,5 @@
 const {DModel, Gio, GLib} = imports.gi;
+const ByteArray = imports.byteArray;
 
 const InstanceOfMatcher = imports.tests.InstanceOfMatcher;
 
@@ -47,6 +48,71 @@ describe('Domain', function () {
             });
             expect(() => { domain.init(null); }).toThrow();
         });
+
+        it('finds the same content again when initialized from its cache', function () {
+            domain.init(null);
+            let cached_domain = new DModel.Domain({
+                app_id: 'com.endlessm.fake_test_app.en',
+            });
+            cached_domain.init(null);
+            expect(cached_domain.get_subscription_ids())
+                .toEqual(domain.get_subscription_ids());
+            expect(cached_domain.get_shards().map(shard => shard.path))
+                .toEqual(domain.get_shards().map(shard => shard.path));
+        });
+
+        it('initializes from the cache instead of finding the content again', function () {
+            domain.init(null);
+            let filename = GLib.build_filenamev([GLib.get_user_cache_dir(),
+                'dmodel', 'domains', 'com.endlessm.fake_test_app.en.gvariant']);
+            try {
+                // Swap the subscriptions in the cached descriptor for ones
+                // that could only have come from it
+                let [, contents] = GLib.file_get_contents(filename);
+                let descriptor = GLib.Variant.new_from_bytes(
+                    new GLib.VariantType('(usa(sxxxx)asa(ssx))'),
+                    new GLib.Bytes(contents), false);
+                let doctored = GLib.Variant.new_tuple([
+                    descriptor.get_child_value(0),
+                    descriptor.get_child_value(1),
+                    descriptor.get_child_value(2),
+                    new GLib.Variant('as', ['from-cache']),
+                    descriptor.get_child_value(4),
+                ]);
+                GLib.file_set_contents(filename,
+                    doctored.get_data_as_bytes().toArray());
+
+                let cached_domain = new DModel.Domain({
+                    app_id: 'com.endlessm.fake_test_app.en',
+                });
+                cached_domain.init(null);
+                expect(cached_domain.get_subscription_ids()).toEqual(['from-cache']);
+            } finally {
+                GLib.unlink(filename);
+            }
+        });
+
+        it('searches ZIM content the same way when initialized from its cache', function (done) {
+            let zim_domain = new DModel.Domain({
+                app_id: 'com.endlessm.fake_zim_test_app.en',
+            });
+            zim_domain.init(null);
+            let cached_domain = new DModel.Domain({
+                app_id: 'com.endlessm.fake_zim_test_app.en',
+            });
+            cached_domain.init(null);
+
+            // ZIM search indexes have no tags, so searches only find
+            // anything if the tags are dropped for them
+            let query = new DModel.Query({
+                search_terms: 'flotacion',
+                tags_match_any: ['EknArticleObject'],
+            });
+            cached_domain.query(query, null, function (domain, result) {
+                expect(domain.query_finish(result).get_models().length).toBe(1);
+                done();
+            });
+        });
     });
 
     describe('test_link', function () {
@@ -99,9 +165,266 @@ describe('Domain', function () {
                 done();
             });
         });
+
+        it('does not return a model once cancelled', function (done) {
+            let cancellable = new Gio.Cancellable();
+            domain.get_object("ekn:///02463d24cb5690af2c8e898736ea8c80e0e77077", cancellable, function (domain, result) {
+                expect(() => domain.get_object_finish(result)).toThrow();
+                done();
+            });
+            cancellable.cancel();
+        });
+    });
+
+    describe('read_uri', function () {
+        const HEX_ID = '97f20ebedb1aaff93eb4043f0b181aa6ecd939f7';
+
+        beforeEach(function () {
+            domain.init(null);
+        });
+
+        it('reads the same content as streaming it from the shard', function () {
+            let [success, bytes] = domain.read_uri(`ekn:///${HEX_ID}`);
+            expect(success).toBe(true);
+            expect(ByteArray.toString(ByteArray.fromGBytes(bytes)))
+                .toEqual('<p>Foobar</p>');
+
+            let shard = domain.get_shards().find(shard => shard.find_by_id(HEX_ID));
+            let record = shard.find_by_id(HEX_ID);
+            let size = shard.get_data_size(record);
+            expect(bytes.get_size()).toBe(size);
+            let streamed = shard.stream_data(record, null).read_bytes(size + 1, null);
+            expect(bytes.equal(streamed)).toBe(true);
+        });
+
+        it('succeeds without content for an ID not in our database', function () {
+            let [success, bytes] = domain.read_uri('ekn:///0000000000000000000000000000000000000000');
+            expect(success).toBe(true);
+            expect(bytes).toBe(null);
+        });
+    });
+
+    describe('model cache', function () {
+        const ID = 'ekn:///02463d24cb5690af2c8e898736ea8c80e0e77077';
+
+        beforeEach(function () {
+            domain.init(null);
+        });
+
+        it('returns the same model when an object is requested again', function (done) {
+            domain.get_object(ID, null, function (domain, result) {
+                let first = domain.get_object_finish(result);
+                domain.get_object(ID, null, function (domain, result) {
+                    let second = domain.get_object_finish(result);
+                    expect(second).toBe(first);
+                    let [hits, misses] = domain.get_model_cache_stats();
+                    expect(hits).toBe(1);
+                    expect(misses).toBe(1);
+                    done();
+                });
+            });
+        });
+
+        it('can be disabled', function (done) {
+            domain.model_cache_size = 0;
+            domain.get_object(ID, null, function (domain, result) {
+                let first = domain.get_object_finish(result);
+                domain.get_object(ID, null, function (domain, result) {
+                    let second = domain.get_object_finish(result);
+                    expect(second).not.toBe(first);
+                    expect(second.id).toEqual(first.id);
+                    done();
+                });
+            });
+        });
+    });
+
+    describe('queries with fields', function () {
+        const ID = 'ekn:///97f20ebedb1aaff93eb4043f0b181aa6ecd939f7';
+
+        beforeEach(function () {
+            domain.init(null);
+        });
+
+        it('return models with only those fields filled in', function (done) {
+            let query = new DModel.Query({ids: [ID], fields: ['title']});
+            domain.query(query, null, function (domain, result) {
+                let models = domain.query_finish(result).get_models();
+                expect(models.length).toBe(1);
+                let [projected] = models;
+                domain.get_object(ID, null, function (domain, result) {
+                    let full = domain.get_object_finish(result);
+                    expect(projected).not.toBe(full);
+                    expect(projected.id).toEqual(ID);
+                    expect(projected.title).toEqual(full.title);
+                    expect(full.content_type).not.toEqual('');
+                    expect(projected.content_type).toEqual('');
+                    done();
+                });
+            });
+        });
+
+        it('keep their models out of the model cache', function (done) {
+            let query = new DModel.Query({ids: [ID], fields: ['title']});
+            domain.query(query, null, function (domain, result) {
+                domain.query_finish(result);
+                domain.get_object(ID, null, function (domain, result) {
+                    let model = domain.get_object_finish(result);
+                    expect(model.content_type).not.toEqual('');
+                    let [hits, misses] = domain.get_model_cache_stats();
+                    expect(hits).toBe(0);
+                    expect(misses).toBe(2);
+                    done();
+                });
+            });
+        });
+    });
+
+    describe('query output', function () {
+        let models_results;
+
+        beforeEach(function (done) {
+            domain.init(null);
+            let query = new DModel.Query({tags_match_any: ['EknArticleObject']});
+            domain.query(query, null, function (domain, result) {
+                models_results = domain.query_finish(result);
+                done();
+            });
+        });
+
+        function query_with_output(output, callback, props = {}) {
+            let query = new DModel.Query(Object.assign({
+                tags_match_any: ['EknArticleObject'],
+                output: output,
+            }, props));
+            domain.query(query, null, function (domain, result) {
+                callback(domain.query_finish(result));
+            });
+        }
+
+        it('returns the IDs of the models in order without the models', function (done) {
+            query_with_output(DModel.QueryOutput.IDS, function (results) {
+                let ids = models_results.get_models().map(model => model.id);
+                expect(ids.length).toBeGreaterThan(0);
+                expect(results.get_ids()).toEqual(ids);
+                expect(results.get_models()).toEqual([]);
+                expect(results.upper_bound).toBe(models_results.upper_bound);
+                done();
+            });
+        });
+
+        it('returns only the number of matches', function (done) {
+            query_with_output(DModel.QueryOutput.COUNT, function (results) {
+                expect(results.upper_bound).toBe(models_results.get_models().length);
+                expect(results.get_ids()).toBe(null);
+                expect(results.get_models()).toEqual([]);
+                done();
+            });
+        });
+
+        it('counts all the matches regardless of the limit', function (done) {
+            query_with_output(DModel.QueryOutput.COUNT, function (results) {
+                expect(results.upper_bound).toBe(models_results.get_models().length);
+                done();
+            }, {offset: 1, limit: 1});
+        });
+    });
+
+    describe('tag clause cache', function () {
+        const TAGS = ['EknArticleObject', 'EknSetObject'];
+
+        beforeEach(function () {
+            domain.init(null);
+            // Run every query against the database, not from the results cache
+            domain.query_cache_size = 0;
+        });
+
+        // Runs the queries one after the other, and passes on the sorted IDs
+        // found by each
+        function query_ids(all_props, callback, all_ids = []) {
+            if (all_props.length === 0) {
+                callback(all_ids);
+                return;
+            }
+            let [props, ...rest] = all_props;
+            let query = new DModel.Query(Object.assign({
+                limit: 1000,
+                output: DModel.QueryOutput.IDS,
+            }, props));
+            domain.query(query, null, function (domain, result) {
+                all_ids.push(domain.query_finish(result).get_ids().sort());
+                query_ids(rest, callback, all_ids);
+            });
+        }
+
+        it('finds the same when the tag clauses are reused', function (done) {
+            let queries = [
+                {tags_match_any: TAGS},
+                {tags_match_all: TAGS},
+                {excluded_tags: TAGS},
+            ];
+            query_ids(queries.concat(queries), function (all_ids) {
+                expect(all_ids.slice(3)).toEqual(all_ids.slice(0, 3));
+                done();
+            });
+        });
+
+        it('keeps apart the clauses for the same tags with different operators', function (done) {
+            query_ids([
+                {},
+                {tags_match_any: TAGS},
+                {tags_match_all: TAGS},
+                {excluded_tags: TAGS},
+                {tags_match_any: TAGS},
+            ], function ([everything, any, all, excluded, any_again]) {
+                expect(any.length).toBeGreaterThan(0);
+                expect(any_again).toEqual(any);
+                expect(all).not.toEqual(any);
+                all.forEach(id => expect(any).toContain(id));
+                excluded.forEach(id => expect(any).not.toContain(id));
+                expect(any.concat(excluded).sort()).toEqual(everything);
+                done();
+            });
+        });
+    });
+
+    describe('spelling cache', function () {
+        beforeEach(function () {
+            domain.init(null);
+        });
+
+        it('fixes the same search terms only once', function (done) {
+            let query = new DModel.Query({search_terms: 'whales'});
+            domain.get_fixed_query(query, null, function (domain, result) {
+                let first = domain.get_fixed_query_finish(result);
+                domain.get_fixed_query(query, null, function (domain, result) {
+                    let second = domain.get_fixed_query_finish(result);
+                    expect(second.corrected_terms).toEqual(first.corrected_terms);
+                    let [hits, misses] = domain.get_spelling_cache_stats();
+                    expect(hits).toBe(1);
+                    expect(misses).toBe(1);
+                    done();
+                });
+            });
+        });
+
+        it('fixes different search terms separately', function (done) {
+            let first = new DModel.Query({search_terms: 'whales'});
+            let second = new DModel.Query({search_terms: 'dolphins'});
+            domain.get_fixed_query(first, null, function (domain, result) {
+                domain.get_fixed_query_finish(result);
+                domain.get_fixed_query(second, null, function (domain, result) {
+                    domain.get_fixed_query_finish(result);
+                    let [hits, misses] = domain.get_spelling_cache_stats();
+                    expect(hits).toBe(0);
+                    expect(misses).toBe(2);
+                    done();
+                });
+            });
+        });
     });
 
-    fdescribe('get_subscription_ids', function () {
+    describe('get_subscription_ids', function () {
         beforeEach(function () {
             domain.init(null);
         });
@@ -46,6 +46,34 @@ describe('Engine', function () {
         });
     });
 
+    describe('get_domain_for_app_async', function () {
+        it('shares one domain between concurrent requests', function (done) {
+            // A new engine, so that the domain is not loaded yet
+            let engine = new DModel.Engine();
+            let first;
+            engine.get_domain_for_app_async('com.endlessm.fake_test_app.en', null,
+                                            function (engine, result) {
+                first = engine.get_domain_for_app_finish(result);
+            });
+            engine.get_domain_for_app_async('com.endlessm.fake_test_app.en', null,
+                                            function (engine, result) {
+                let second = engine.get_domain_for_app_finish(result);
+                expect(second).toBeA(DModel.Domain);
+                expect(second).toBe(first);
+                expect(second).toBe(engine.get_domain_for_app('com.endlessm.fake_test_app.en'));
+                done();
+            });
+        });
+
+        it('throws for an app id that does not exist', function (done) {
+            engine.get_domain_for_app_async('com.endlessm.invalid_app.en', null,
+                                            function (engine, result) {
+                expect(() => engine.get_domain_for_app_finish(result)).toThrow();
+                done();
+            });
+        });
+    });
+
     describe('get_object_for_app', function () {
         it('returns a model for valid (app ID, ID) pair', function (done) {
             engine.get_object_for_app('ekn:///02463d24cb5690af2c8e898736ea8c80e0e77077',
@@ -80,6 +108,86 @@ describe('Engine', function () {
         });
     });
 
+    describe('query_batch', function () {
+        it('returns no results for no queries', function (done) {
+            engine.query_batch([], null, function (engine, result) {
+                expect(engine.query_batch_finish(result)).toEqual([]);
+                done();
+            });
+        });
+
+        it('throws for an app id that does not exist', function (done) {
+            let queries = [
+                new DModel.Query({app_id: 'com.endlessm.fake_test_app.en'}),
+                new DModel.Query({app_id: 'com.endlessm.invalid_app.en'}),
+            ];
+            engine.query_batch(queries, null, function (engine, result) {
+                expect(() => engine.query_batch_finish(result)).toThrow();
+                done();
+            });
+        });
+
+        it('returns the same results as running the queries one by one', function (done) {
+            let queries = [
+                new DModel.Query({
+                    app_id: 'com.endlessm.fake_test_app.en',
+                    search_terms: 'foo',
+                }),
+                new DModel.Query({
+                    app_id: 'com.endlessm.fake_test_app.en',
+                    tags_match_any: ['EknArticleObject'],
+                }),
+                new DModel.Query({
+                    app_id: 'com.endlessm.fake_test_app.en',
+                    ids: ['ekn:///97f20ebedb1aaff93eb4043f0b181aa6ecd939f7'],
+                }),
+            ];
+            let ids_of = results => results.get_models().map(model => model.id);
+
+            // Runs the queries one after the other with query()
+            function query_each(engine, remaining, callback, all_ids = []) {
+                if (remaining.length === 0) {
+                    callback(all_ids);
+                    return;
+                }
+                let [query, ...rest] = remaining;
+                engine.query(query, null, function (engine, result) {
+                    all_ids.push(ids_of(engine.query_finish(result)));
+                    query_each(engine, rest, callback, all_ids);
+                });
+            }
+
+            // Each on an engine of its own, so that neither gets its results
+            // from the other's query cache
+            new DModel.Engine().query_batch(queries, null, function (engine, result) {
+                let batch = engine.query_batch_finish(result).map(ids_of);
+                query_each(new DModel.Engine(), queries, function (expected) {
+                    expect(expected[0].length).toBeGreaterThan(0);
+                    expect(batch).toEqual(expected);
+                    done();
+                });
+            });
+        });
+
+        it('leaves the same query twice in a batch unchanged', function (done) {
+            let query = new DModel.Query({
+                app_id: 'com.endlessm.fake_zim_test_app.en',
+                search_terms: 'flotacion',
+                tags_match_any: ['EknArticleObject'],
+            });
+            let ids_of = results => results.get_models().map(model => model.id);
+
+            // Searches of a ZIM file have their tags dropped before running
+            engine.query_batch([query, query], null, function (engine, result) {
+                let [first, second] = engine.query_batch_finish(result);
+                expect(ids_of(first).length).toBe(1);
+                expect(ids_of(second)).toEqual(ids_of(first));
+                expect(query.tags_match_any).toEqual(['EknArticleObject']);
+                done();
+            });
+        });
+    });
+
     describe('test_link_for_app', function () {
         it('returns an id for valid app id, link pair', function () {
             let id = engine.test_link_for_app('https://en.wikipedia.org/wiki/America',
@@ -39,6 +39,24 @@ describe('Query', function () {
         expect(query_obj.tags_match_any).not.toEqual(mutable_tags);
     });
 
+    it('has no field projection by default', function () {
+        let query_obj = new DModel.Query();
+        expect(query_obj.fields).toBeNull();
+
+        const FIELDS = ['id', 'title', 'thumbnail-uri'];
+        query_obj = DModel.Query.new_from_object(query_obj, {fields: FIELDS});
+        expect(query_obj.fields).toEqual(FIELDS);
+    });
+
+    it('outputs models by default', function () {
+        let query_obj = new DModel.Query();
+        expect(query_obj.output).toBe(DModel.QueryOutput.MODELS);
+
+        query_obj = DModel.Query.new_from_object(query_obj, {output: DModel.QueryOutput.COUNT});
+        expect(query_obj.output).toBe(DModel.QueryOutput.COUNT);
+        expect(query_obj.to_string()).toMatch('output: DM_QUERY_OUTPUT_COUNT');
+    });
+
     describe('new_from_object constructor', function () {
         const TERMS = 'keymaster';
         const QUERY_OBJ = new DModel.Query({
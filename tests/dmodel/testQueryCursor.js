@@ -0,0 +1,122 @@
+const {DModel, Gio, GLib} = imports.gi;
+
+describe('QueryCursor', function () {
+    let domain, tempdir;
+
+    beforeAll(function () {
+        tempdir = GLib.Dir.make_tmp('dmodel-test-domain-XXXXXX');
+        GLib.setenv('XDG_DATA_HOME', tempdir, true);
+    });
+
+    beforeEach(function () {
+        domain = new DModel.Domain({
+            app_id: 'com.endlessm.fake_test_app.en',
+        });
+        domain.init(null);
+    });
+
+    afterEach(function () {
+        function clean_out(file, cancellable) {
+            let enumerator = file.enumerate_children('standard::*',
+                Gio.FileQueryInfoFlags.NOFOLLOW_SYMLINKS, cancellable);
+            let info;
+            while ((info = enumerator.next_file(cancellable))) {
+                let child = enumerator.get_child(info);
+                if (info.get_file_type() === Gio.FileType.DIRECTORY)
+                    clean_out(child, cancellable);
+                child.delete(cancellable);
+            }
+        }
+        clean_out(Gio.File.new_for_path(tempdir), null);
+    });
+
+    afterAll(function () {
+        Gio.File.new_for_path(tempdir).delete(null);
+    });
+
+    function make_query(props = {}) {
+        return new DModel.Query(Object.assign({
+            tags_match_any: ['EknArticleObject'],
+        }, props));
+    }
+
+    // Gets the IDs of all results of a query in one go, to compare with
+    function query_ids(query, callback) {
+        query = DModel.Query.new_from_object(query, {
+            output: DModel.QueryOutput.IDS,
+        });
+        domain.query(query, null, function (domain, result) {
+            callback(domain.query_finish(result).get_ids());
+        });
+    }
+
+    // Pages through a cursor until it hands out an empty page
+    function page_through(cursor, page_size, callback, pages = []) {
+        cursor.next_page(page_size, null, function (cursor, result) {
+            let models = cursor.next_page_finish(result).get_models();
+            if (models.length === 0) {
+                callback(pages);
+                return;
+            }
+            pages.push(models.map(model => model.id));
+            page_through(cursor, page_size, callback, pages);
+        });
+    }
+
+    it('reads nothing until the first page is requested', function () {
+        let cursor = DModel.QueryCursor.new(domain, make_query());
+        expect(cursor.get_position()).toBe(0);
+        expect(cursor.is_exhausted()).toBe(false);
+    });
+
+    it('hands out all the results of the query, in order', function (done) {
+        let query = make_query();
+        query_ids(query, function (ids) {
+            expect(ids.length).toBeGreaterThan(1);
+            let cursor = DModel.QueryCursor.new(domain, query);
+            page_through(cursor, 1, function (pages) {
+                expect(pages.length).toBe(ids.length);
+                expect([].concat(...pages)).toEqual(ids);
+                expect(cursor.get_position()).toBe(ids.length);
+                expect(cursor.is_exhausted()).toBe(true);
+                done();
+            });
+        });
+    });
+
+    it('fills pages larger than what is left with the rest', function (done) {
+        let query = make_query();
+        query_ids(query, function (ids) {
+            let cursor = DModel.QueryCursor.new(domain, query);
+            page_through(cursor, ids.length + 10, function (pages) {
+                expect(pages.length).toBe(1);
+                expect(pages[0]).toEqual(ids);
+                expect(cursor.is_exhausted()).toBe(true);
+                done();
+            });
+        });
+    });
+
+    it('starts at the offset and stops at the limit of the query', function (done) {
+        query_ids(make_query(), function (ids) {
+            let query = make_query({offset: 1, limit: 1});
+            let cursor = DModel.QueryCursor.new(domain, query);
+            page_through(cursor, 1, function (pages) {
+                expect(pages).toEqual([[ids[1]]]);
+                expect(cursor.is_exhausted()).toBe(true);
+                done();
+            });
+        });
+    });
+
+    it('is exhausted right away for a query without results', function (done) {
+        let query = make_query({tags_match_any: ['NoSuchTag']});
+        let cursor = DModel.QueryCursor.new(domain, query);
+        cursor.next_page(5, null, function (cursor, result) {
+            let results = cursor.next_page_finish(result);
+            expect(results.get_models()).toEqual([]);
+            expect(cursor.is_exhausted()).toBe(true);
+            done();
+        });
+    });
+});
@@ -0,0 +1,147 @@
+const {DModel, Gio, GLib} = imports.gi;
+
+describe('SearchSession', function () {
+    let domain, tempdir;
+
+    beforeAll(function () {
+        tempdir = GLib.Dir.make_tmp('dmodel-test-domain-XXXXXX');
+        GLib.setenv('XDG_DATA_HOME', tempdir, true);
+    });
+
+    beforeEach(function () {
+        domain = new DModel.Domain({
+            app_id: 'com.endlessm.fake_test_app.en',
+        });
+        domain.init(null);
+    });
+
+    afterEach(function () {
+        function clean_out(file, cancellable) {
+            let enumerator = file.enumerate_children('standard::*',
+                Gio.FileQueryInfoFlags.NOFOLLOW_SYMLINKS, cancellable);
+            let info;
+            while ((info = enumerator.next_file(cancellable))) {
+                let child = enumerator.get_child(info);
+                if (info.get_file_type() === Gio.FileType.DIRECTORY)
+                    clean_out(child, cancellable);
+                child.delete(cancellable);
+            }
+        }
+        clean_out(Gio.File.new_for_path(tempdir), null);
+    });
+
+    afterAll(function () {
+        Gio.File.new_for_path(tempdir).delete(null);
+    });
+
+    // Runs the searches one after the other, and passes on the IDs found by
+    // the last one
+    function search_ids(session, all_terms, callback) {
+        let [terms, ...rest] = all_terms;
+        session.search(terms, null, function (session, result) {
+            let models = session.search_finish(result).get_models();
+            if (rest.length > 0)
+                search_ids(session, rest, callback);
+            else
+                callback(models.map(model => model.id));
+        });
+    }
+
+    // Checks that the last of the searches finds the same as it would in a
+    // session of its own
+    function expect_same_as_fresh(query, all_terms, done) {
+        let session = DModel.SearchSession.new(domain, query);
+        search_ids(session, all_terms, function (ids) {
+            let fresh = DModel.SearchSession.new(domain, query);
+            search_ids(fresh, all_terms.slice(-1), function (fresh_ids) {
+                expect(ids).toEqual(fresh_ids);
+                done();
+            });
+        });
+    }
+
+    it('finds something for a search in the test content', function (done) {
+        let session = DModel.SearchSession.new(domain, null);
+        search_ids(session, ['foo'], function (ids) {
+            expect(ids).toContain('ekn:///97f20ebedb1aaff93eb4043f0b181aa6ecd939f7');
+            done();
+        });
+    });
+
+    it('finds the same when narrowing down a search as a fresh search', function (done) {
+        expect_same_as_fresh(null, ['fo', 'foo'], done);
+    });
+
+    it('finds the same when adding terms to a search as a fresh search', function (done) {
+        expect_same_as_fresh(null, ['foo', 'foo bar'], done);
+    });
+
+    it('finds the same when widening a search as a fresh search', function (done) {
+        expect_same_as_fresh(null, ['foo', 'fo'], done);
+    });
+
+    it('finds the same after a search that matched nothing as a fresh search', function (done) {
+        expect_same_as_fresh(null, ['fooqqq', 'foo'], done);
+    });
+
+    it('does not narrow down from a search with spelling corrections', function (done) {
+        expect_same_as_fresh(null, ['whale', 'whales'], done);
+    });
+
+    it('does not narrow down from a search for a stop word', function (done) {
+        expect_same_as_fresh(null, ['the', 'the foo'], done);
+    });
+
+    it('does not narrow down when a term is stemmed once another follows', function (done) {
+        expect_same_as_fresh(null, ['generaliz', 'generalization foo'], done);
+    });
+
+    it('does not narrow down searches of a literal query', function (done) {
+        let query = new DModel.Query({literal_query: 'title:foo'});
+        expect_same_as_fresh(query, ['qqq', 'qqqq'], done);
+    });
+
+    it('does not narrow down when it is turned off', function (done) {
+        let session = DModel.SearchSession.new(domain, null);
+        session.max_candidates = 0;
+        search_ids(session, ['fo', 'foo'], function (ids) {
+            expect(ids).toContain('ekn:///97f20ebedb1aaff93eb4043f0b181aa6ecd939f7');
+            done();
+        });
+    });
+
+    it('cancels a search superseded by another one', function (done) {
+        let session = DModel.SearchSession.new(domain, null);
+        let pending = 2;
+        function finished() {
+            if (--pending === 0)
+                done();
+        }
+
+        session.search('fo', null, function (session, result) {
+            let error = null;
+            try {
+                session.search_finish(result);
+            } catch (e) {
+                error = e;
+            }
+            expect(error).not.toBe(null);
+            expect(error.matches(Gio.IOErrorEnum, Gio.IOErrorEnum.CANCELLED)).toBe(true);
+            finished();
+        });
+        session.search('foo', null, function (session, result) {
+            let ids = session.search_finish(result).get_models().map(model => model.id);
+            expect(ids).toContain('ekn:///97f20ebedb1aaff93eb4043f0b181aa6ecd939f7');
+            finished();
+        });
+    });
+
+    it('cancels the search in progress', function (done) {
+        let session = DModel.SearchSession.new(domain, null);
+        session.search('foo', null, function (session, result) {
+            expect(() => session.search_finish(result)).toThrow();
+            done();
+        });
+        session.cancel();
+    });
+});
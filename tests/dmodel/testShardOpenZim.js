@@ -73,6 +73,186 @@ describe('ShardOpenZim', function () {
         done();
     });
 
+    it('streams content that can be seeked into', function () {
+        let shard = domain.get_shards()[0];
+        let record = shard.find_by_id('A/lipsum.html');
+
+        let stream = shard.stream_data(record, null);
+        expect(stream.can_seek()).toBe(true);
+        stream.seek(146, GLib.SeekType.SET, null);
+        let title = ByteArray.toString(
+            ByteArray.fromGBytes(stream.read_bytes(32, null)));
+        expect(title).toBe('<title>Test ZIM document</title>');
+    });
+
+    it('reads the same bytes after seeking into a media record', function () {
+        let shard = domain.get_shards()[0];
+        let record = shard.find_by_id('A/article.pdf');
+
+        let all = shard.get_data_bytes(record, null);
+        let size = all.get_size();
+        expect(size).toBe(shard.get_data_size(record));
+
+        let stream = shard.stream_data(record, null);
+        expect(stream.can_seek()).toBe(true);
+        stream.seek(1000, GLib.SeekType.SET, null);
+        expect(stream.tell()).toBe(1000);
+        let chunk = stream.read_bytes(64, null);
+        expect(chunk.equal(all.new_from_bytes(1000, 64))).toBe(true);
+
+        stream.seek(-16, GLib.SeekType.END, null);
+        let tail = stream.read_bytes(64, null);
+        expect(tail.equal(all.new_from_bytes(size - 16, 16))).toBe(true);
+    });
+
+    it('decompresses the content of a record only once', function () {
+        let shard = domain.get_shards()[0];
+        // The HTML page is stored in an xz-compressed cluster
+        let record = shard.find_by_id('A/lipsum.html');
+
+        let first = shard.stream_data(record, null).read_bytes(4294967295, null);
+        let second = shard.stream_data(record, null).read_bytes(4294967295, null);
+        expect(second.equal(first)).toBe(true);
+
+        let [hits, misses] = domain.get_zim_cache_stats();
+        expect(misses).toBe(1);
+        expect(hits).toBe(1);
+    });
+
+    it('reads media straight from the file without caching it', function () {
+        let shard = domain.get_shards()[0];
+        let record = shard.find_by_id('A/article.pdf');
+
+        shard.stream_data(record, null).read_bytes(64, null);
+        shard.stream_data(record, null).read_bytes(64, null);
+
+        let [hits, misses] = domain.get_zim_cache_stats();
+        expect(hits).toBe(0);
+        expect(misses).toBe(0);
+    });
+
+    it('streams all of a media record', function () {
+        let shard = domain.get_shards()[0];
+        let record = shard.find_by_id('A/article.pdf');
+
+        let size = shard.get_data_size(record);
+        let stream = shard.stream_data(record, null);
+        expect(stream.read_bytes(size + 1, null).get_size()).toBe(size);
+    });
+
+    it('reads the whole content of a record at once', function () {
+        let shard = domain.get_shards()[0];
+        let record = shard.find_by_id('A/lipsum.html');
+
+        let bytes = shard.get_data_bytes(record, null);
+        expect(bytes.get_size()).toBe(shard.get_data_size(record));
+
+        let html = ByteArray.toString(ByteArray.fromGBytes(bytes));
+        expect(html.indexOf('<title>Test ZIM document</title>')).toBe(146);
+    });
+
+    describe('async requests', function () {
+        let shard;
+
+        beforeEach(function () {
+            shard = domain.get_shards()[0];
+        });
+
+        it('load a model', function (done) {
+            let record = shard.find_by_id('A/article.pdf');
+            shard.get_model_async(record, GLib.PRIORITY_DEFAULT, null, function (shard, result) {
+                let model = shard.get_model_finish(result);
+                expect(model.title).toBe('Flotación sucia');
+                expect(model.content_type).toBe('application/pdf');
+                done();
+            });
+        });
+
+        it('open a stream to the data', function (done) {
+            let record = shard.find_by_id('A/lipsum.html');
+            shard.stream_data_async(record, GLib.PRIORITY_DEFAULT, null, function (shard, result) {
+                let stream = shard.stream_data_finish(result);
+                let bytes = stream.read_bytes(4294967295, null);
+                expect(bytes.equal(shard.get_data_bytes(record, null))).toBe(true);
+                done();
+            });
+        });
+
+        function expect_cancelled(finish) {
+            let error = null;
+            try {
+                finish();
+            } catch (e) {
+                error = e;
+            }
+            expect(error).not.toBe(null);
+            expect(error.matches(Gio.IOErrorEnum, Gio.IOErrorEnum.CANCELLED)).toBe(true);
+        }
+
+        it('return cancelled if cancelled before they start', function (done) {
+            let record = shard.find_by_id('A/lipsum.html');
+            let cancellable = new Gio.Cancellable();
+            cancellable.cancel();
+
+            shard.get_model_async(record, GLib.PRIORITY_DEFAULT, cancellable, function (shard, result) {
+                expect_cancelled(() => shard.get_model_finish(result));
+                shard.stream_data_async(record, GLib.PRIORITY_DEFAULT, cancellable, function (shard, result) {
+                    expect_cancelled(() => shard.stream_data_finish(result));
+                    done();
+                });
+            });
+        });
+    });
+
+    describe('redirects', function () {
+        let shard, lipsum;
+
+        beforeEach(function () {
+            shard = domain.get_shards()[0];
+            lipsum = shard.get_data_bytes(shard.find_by_id('A/lipsum.html'), null);
+        });
+
+        it('follow a redirect to the article it leads to', function () {
+            let record = shard.find_by_id('A/redirect.html');
+            let model = shard.get_model(record, null);
+            expect(model.title).toBe('Redirect to Lorem ipsum');
+            expect(model.content_type).toBe('text/html');
+            expect(shard.get_data_bytes(record, null).equal(lipsum)).toBe(true);
+        });
+
+        it('follow a chain of redirects to the article at its end', function () {
+            let record = shard.find_by_id('A/chain.html');
+            let model = shard.get_model(record, null);
+            expect(model.title).toBe('Chain to Lorem ipsum');
+            expect(model.content_type).toBe('text/html');
+            expect(shard.get_data_bytes(record, null).equal(lipsum)).toBe(true);
+        });
+
+        it('stop being followed when they go round in a loop', function () {
+            expect(shard.find_by_id('A/loop.html')).not.toBe(null);
+        });
+
+        it('remember where a redirect leads', function () {
+            shard.find_by_id('A/redirect.html');
+            let [hits, misses] = domain.get_zim_redirect_cache_stats();
+            expect(hits).toBe(0);
+            expect(misses).toBe(1);
+
+            let record = shard.find_by_id('A/redirect.html');
+            [hits, misses] = domain.get_zim_redirect_cache_stats();
+            expect(hits).toBe(1);
+            expect(misses).toBe(1);
+            expect(shard.get_data_bytes(record, null).equal(lipsum)).toBe(true);
+        });
+
+        it('are not looked up for articles that are not redirects', function () {
+            shard.find_by_id('A/lipsum.html');
+            let [hits, misses] = domain.get_zim_redirect_cache_stats();
+            expect(hits).toBe(0);
+            expect(misses).toBe(0);
+        });
+    });
+
     it('query a document in the database', function (done) {
         let query = new DModel.Query({
             search_terms: 'flotacion',
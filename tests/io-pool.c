@@ -0,0 +1,156 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+
+/* Copyright 2020 Endless Mobile, Inc. */
+
+/* Checks the order in which the pool of threads for reading content starts
+ * the tasks queued on it. All of its threads but one are kept busy while
+ * the tasks are queued, so that they start one at a time, in the order the
+ * pool picks them. */
+
+#include "dm-utils-private.h"
+
+static GMutex lock;
+static GCond cond;
+static guint n_blocked;
+static guint n_to_release;
+static guint n_returned;
+static GPtrArray *started;
+
+static void
+blocker_thread (GTask *task,
+                G_GNUC_UNUSED gpointer source_object,
+                G_GNUC_UNUSED gpointer task_data,
+                G_GNUC_UNUSED GCancellable *cancellable)
+{
+  g_mutex_lock (&lock);
+  n_blocked++;
+  g_cond_broadcast (&cond);
+  while (n_to_release == 0)
+    g_cond_wait (&cond, &lock);
+  n_to_release--;
+  n_blocked--;
+  g_mutex_unlock (&lock);
+
+  g_task_return_boolean (task, TRUE);
+}
+
+static void
+record_thread (GTask *task,
+               G_GNUC_UNUSED gpointer source_object,
+               gpointer task_data,
+               G_GNUC_UNUSED GCancellable *cancellable)
+{
+  g_mutex_lock (&lock);
+  g_ptr_array_add (started, task_data);
+  g_cond_broadcast (&cond);
+  g_mutex_unlock (&lock);
+
+  g_task_return_boolean (task, TRUE);
+}
+
+static void
+task_returned (G_GNUC_UNUSED GObject *source_object,
+               G_GNUC_UNUSED GAsyncResult *result,
+               G_GNUC_UNUSED gpointer user_data)
+{
+  n_returned++;
+}
+
+static void
+run_task (int priority,
+          GCancellable *cancellable,
+          const char *name,
+          GTaskThreadFunc func)
+{
+  g_autoptr(GTask) task = g_task_new (NULL, cancellable, task_returned, NULL);
+  g_task_set_priority (task, priority);
+  g_task_set_task_data (task, (gpointer) name, NULL);
+  dm_utils_run_io_task (task, func);
+}
+
+/* Queues the tasks in @names with the matching @priorities while the pool is
+ * held up, and checks that the ones that run are started in the order of
+ * @expected */
+static void
+check_start_order (const int *priorities,
+                   const char * const *names,
+                   guint n_tasks,
+                   GCancellable *cancellable,
+                   const char * const *expected)
+{
+  started = g_ptr_array_new ();
+  n_returned = 0;
+
+  for (guint i = 0; i < DM_UTILS_IO_POOL_THREADS; i++)
+    run_task (G_PRIORITY_DEFAULT, NULL, "blocker", blocker_thread);
+
+  g_mutex_lock (&lock);
+  while (n_blocked < DM_UTILS_IO_POOL_THREADS)
+    g_cond_wait (&cond, &lock);
+  g_mutex_unlock (&lock);
+
+  for (guint i = 0; i < n_tasks; i++)
+    run_task (priorities[i], cancellable, names[i], record_thread);
+
+  /* Let one thread through to work the queue off on its own */
+  g_mutex_lock (&lock);
+  n_to_release = 1;
+  g_cond_broadcast (&cond);
+  guint n_expected = g_strv_length ((char **) expected);
+  while (started->len < n_expected)
+    g_cond_wait (&cond, &lock);
+  n_to_release += DM_UTILS_IO_POOL_THREADS - 1;
+  g_cond_broadcast (&cond);
+  g_mutex_unlock (&lock);
+
+  while (n_returned < n_tasks + DM_UTILS_IO_POOL_THREADS)
+    g_main_context_iteration (NULL, TRUE);
+
+  g_assert_cmpuint (started->len, ==, n_expected);
+  for (guint i = 0; i < n_expected; i++)
+    g_assert_cmpstr (g_ptr_array_index (started, i), ==, expected[i]);
+
+  g_clear_pointer (&started, g_ptr_array_unref);
+}
+
+static void
+test_priority_order (void)
+{
+  static const int priorities[] = {
+    G_PRIORITY_LOW, G_PRIORITY_DEFAULT, G_PRIORITY_HIGH, G_PRIORITY_LOW,
+    G_PRIORITY_HIGH,
+  };
+  static const char * const names[] = {
+    "low 1", "default", "high 1", "low 2", "high 2",
+  };
+  static const char * const expected[] = {
+    "high 1", "high 2", "default", "low 1", "low 2", NULL,
+  };
+
+  check_start_order (priorities, names, G_N_ELEMENTS (names), NULL, expected);
+}
+
+static void
+test_cancelled_before_start (void)
+{
+  static const int priorities[] = { G_PRIORITY_DEFAULT, G_PRIORITY_DEFAULT };
+  static const char * const names[] = { "first", "second" };
+  static const char * const expected[] = { NULL };
+
+  /* Cancelled tasks still return, but without running */
+  g_autoptr(GCancellable) cancellable = g_cancellable_new ();
+  g_cancellable_cancel (cancellable);
+  check_start_order (priorities, names, G_N_ELEMENTS (names), cancellable, expected);
+}
+
+int
+main (int argc,
+      char **argv)
+{
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/io-pool/priority-order", test_priority_order);
+  g_test_add_func ("/io-pool/cancelled-before-start", test_cancelled_before_start);
+
+  return g_test_run ();
+}